@@ -33,7 +33,28 @@
 
 #include "Adafruit_NeoPixel.h"
 
-Adafruit_NeoPixel::Adafruit_NeoPixel(uint16_t n, uint8_t p, uint8_t t) : numLEDs(n), numBytes(n * 3), pin(p), pixels(NULL)
+// Gamma correction table (gamma = 2.6), indexed by 8-bit color value.
+// Values are round(255 * pow(i / 255.0, 2.6)); the table lives in flash
+// and is only consulted when enabled with setGamma(true).
+static const uint8_t PROGMEM _NeoPixelGammaTable[256] = {
+    0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+    0,  0,  0,  0,  0,  0,  0,  0,  1,  1,  1,  1,  1,  1,  1,  1,
+    1,  1,  1,  1,  2,  2,  2,  2,  2,  2,  2,  2,  3,  3,  3,  3,
+    3,  3,  4,  4,  4,  4,  5,  5,  5,  5,  5,  6,  6,  6,  6,  7,
+    7,  7,  8,  8,  8,  9,  9,  9, 10, 10, 10, 11, 11, 11, 12, 12,
+   13, 13, 13, 14, 14, 15, 15, 16, 16, 17, 17, 18, 18, 19, 19, 20,
+   20, 21, 21, 22, 22, 23, 24, 24, 25, 25, 26, 27, 27, 28, 29, 29,
+   30, 31, 31, 32, 33, 34, 34, 35, 36, 37, 38, 38, 39, 40, 41, 42,
+   42, 43, 44, 45, 46, 47, 48, 49, 50, 51, 52, 53, 54, 55, 56, 57,
+   58, 59, 60, 61, 62, 63, 64, 65, 66, 68, 69, 70, 71, 72, 73, 75,
+   76, 77, 78, 80, 81, 82, 84, 85, 86, 88, 89, 90, 92, 93, 94, 96,
+   97, 99,100,102,103,105,106,108,109,111,112,114,115,117,119,120,
+  122,124,125,127,129,130,132,134,136,137,139,141,143,145,146,148,
+  150,152,154,156,158,160,162,164,166,168,170,172,174,176,178,180,
+  182,184,186,188,191,193,195,197,199,202,204,206,209,211,213,215,
+  218,220,223,225,227,230,232,235,237,240,242,245,247,250,252,255 };
+
+Adafruit_NeoPixel::Adafruit_NeoPixel(uint16_t n, uint8_t p, uint8_t t) : numLEDs(n), numBytes(n * 3), pin(p), brightness(0), pixels(NULL), outBuf(NULL), colorTable(NULL), skipUnchanged(false), dirty(true), pending(false), rawPixels(false), endTime(0), frameTime(0), frameSum(0), framesSent(0), framesSkipped(0)
 #if defined(NEO_RGB) || defined(NEO_KHZ400)
   ,type(t)
 #endif
@@ -49,6 +70,7 @@ Adafruit_NeoPixel::Adafruit_NeoPixel(uint16_t n, uint8_t p, uint8_t t) : numLEDs
 
 Adafruit_NeoPixel::~Adafruit_NeoPixel() {
   if(pixels) free(pixels);
+  if(outBuf) free(outBuf);
   pinMode(pin, INPUT);
 }
 
@@ -61,6 +83,42 @@ void Adafruit_NeoPixel::show(void) {
 
   if(!pixels) return;
 
+  // Optional frame skipping.  Interrupts are off for the whole transfer
+  // (about 30 microseconds per pixel at 800 KHz), which is long enough to
+  // cost other ISRs (serial, DMX, IR) their data.  A throttled call, or a
+  // frame identical to the one already latched, simply returns instead.
+  // A throttled frame is NOT sent later on its own: it stays pending
+  // (see isPending()) until show() is called again after the frame
+  // interval, so a sketch that stops calling show() must make one more
+  // call for its last frame to reach the LEDs.
+  // The first frame is never throttled, endTime only means something once
+  // a frame was issued.
+  if(frameTime && framesSent && ((micros() - endTime) < frameTime)) {
+    pending = true;
+    framesSkipped++;
+    return;
+  }
+  // setPixelColor() and the settings functions set 'dirty', so a frame
+  // changed through them is always issued.  Data edited directly through
+  // getPixels() can only be detected by comparing checksums; the pass
+  // runs with interrupts enabled, but a checksum can't catch every
+  // change, so call setDirty() after such edits to be sure.
+  uint32_t sum = 0;
+  if(skipUnchanged) {
+    if(rawPixels) sum = checksum();
+    if(!dirty && (!rawPixels || (sum == frameSum))) {
+      pending = false;
+      framesSkipped++;
+      return;
+    }
+  }
+
+  // Brightness and color correction are applied here, into a separate
+  // output buffer, rather than to the 'pixels' array itself.  This is
+  // done before the latch wait below, so the work overlaps the latch
+  // period instead of extending the interrupts-off window.
+  uint8_t *src = render();
+
   // Data latch = 50+ microsecond pause in the output stream.  Rather than
   // put a delay at the end of the function, the ending time is noted and
   // the function will simply hold off (if needed) on issuing the
@@ -89,7 +147,7 @@ void Adafruit_NeoPixel::show(void) {
   volatile uint16_t
     i   = numBytes; // Loop counter
   volatile uint8_t
-   *ptr = pixels,   // Pointer to next byte
+   *ptr = src,      // Pointer to next byte
     b   = *ptr++,   // Current byte value
     hi,             // PORT w/output bit set high
     lo;             // PORT w/output bit set low
@@ -516,7 +574,8 @@ void Adafruit_NeoPixel::show(void) {
        "mov  %[next], %[hi]"    "\n\t" // 0-1   next = hi    (T =  4)
       "rjmp .+0"                "\n\t" // 2    nop nop       (T =  6)
       "st   %a[port], %[next]"  "\n\t" // 2    PORT = next   (T =  8)
-      "rjmp .+0"                "\n\t" // 2    nop nop       (T = 10)
+      "mov  %[next] , %[lo]"    "\n\t" // 1    next = lo     (T =  9)
+      "nop"                     "\n\t" // 1    nop           (T = 10)
       "rjmp .+0"                "\n\t" // 2    nop nop       (T = 12)
       "rjmp .+0"                "\n\t" // 2    nop nop       (T = 14)
       "nop"                     "\n\t" // 1    nop           (T = 15)
@@ -672,7 +731,7 @@ void Adafruit_NeoPixel::show(void) {
 #define CYCLES_400_T1H  (F_CPU /  833333)
 #define CYCLES_400      (F_CPU /  400000)
 
-  uint8_t          *p   = pixels,
+  uint8_t          *p   = src,
                    *end = p + numBytes, pix, mask;
   volatile uint8_t *set = portSetRegister(pin),
                    *clr = portClearRegister(pin);
@@ -749,7 +808,7 @@ void Adafruit_NeoPixel::show(void) {
   portClear = &(port->PIO_CODR);            // starting timer to minimize
   timeValue = &(TC1->TC_CHANNEL[0].TC_CV);  // the initial 'while'.
   timeReset = &(TC1->TC_CHANNEL[0].TC_CCR);
-  p         =  pixels;
+  p         =  src;
   end       =  p + numBytes;
   pix       = *p++;
   mask      = 0x80;
@@ -790,6 +849,11 @@ void Adafruit_NeoPixel::show(void) {
 
   interrupts();
   endTime = micros(); // Save EOD time for latch on next call
+
+  frameSum = sum;
+  dirty    = false;
+  pending  = false;
+  framesSent++;
 }
 
 // Set the output pin number
@@ -802,16 +866,17 @@ void Adafruit_NeoPixel::setPin(uint8_t p) {
   port    = portOutputRegister(digitalPinToPort(p));
   pinMask = digitalPinToBitMask(p);
 #endif
+  dirty   = true; // New pin hasn't received the current frame
 }
 
 // Set pixel color from separate R,G,B components:
 void Adafruit_NeoPixel::setPixelColor(
  uint16_t n, uint8_t r, uint8_t g, uint8_t b) {
   if(n < numLEDs) {
-    if(brightness) { // See notes in setBrightness()
-      r = (r * brightness) >> 8;
-      g = (g * brightness) >> 8;
-      b = (b * brightness) >> 8;
+    if(!outBuf) { // Not lossless; correct the color now (see setLossless())
+      r = correct(r);
+      g = correct(g);
+      b = correct(b);
     }
     uint8_t *p = &pixels[n * 3];
 #ifdef NEO_RGB
@@ -826,6 +891,7 @@ void Adafruit_NeoPixel::setPixelColor(
     }
 #endif
     *p = b;
+    dirty = true;
   }
 }
 
@@ -836,10 +902,10 @@ void Adafruit_NeoPixel::setPixelColor(uint16_t n, uint32_t c) {
       r = (uint8_t)(c >> 16),
       g = (uint8_t)(c >>  8),
       b = (uint8_t)c;
-    if(brightness) { // See notes in setBrightness()
-      r = (r * brightness) >> 8;
-      g = (g * brightness) >> 8;
-      b = (b * brightness) >> 8;
+    if(!outBuf) { // Not lossless; correct the color now (see setLossless())
+      r = correct(r);
+      g = correct(g);
+      b = correct(b);
     }
     uint8_t *p = &pixels[n * 3];
 #ifdef NEO_RGB
@@ -854,6 +920,7 @@ void Adafruit_NeoPixel::setPixelColor(uint16_t n, uint32_t c) {
     }
 #endif
     *p = b;
+    dirty = true;
   }
 }
 
@@ -885,7 +952,10 @@ uint32_t Adafruit_NeoPixel::getPixelColor(uint16_t n) const {
   return 0; // Pixel # is out of bounds
 }
 
+// Direct access to the pixel data.  After this is called, show() with
+// setSkipUnchanged() also compares checksums to notice edits made here.
 uint8_t *Adafruit_NeoPixel::getPixels(void) const {
+  rawPixels = true;
   return pixels;
 }
 
@@ -895,16 +965,16 @@ uint16_t Adafruit_NeoPixel::numPixels(void) const {
 
 // Adjust output brightness; 0=darkest (off), 255=brightest.  This does
 // NOT immediately affect what's currently displayed on the LEDs.  The
-// next call to show() will refresh the LEDs at this level.  However,
-// this process is potentially "lossy," especially when increasing
-// brightness.  The tight timing in the WS2811/WS2812 code means there
-// aren't enough free cycles to perform this scaling on the fly as data
-// is issued.  So we make a pass through the existing color data in RAM
-// and scale it (subsequent graphics commands also work at this
-// brightness level).  If there's a significant step up in brightness,
-// the limited number of steps (quantization) in the old data will be
-// quite visible in the re-scaled version.  For a non-destructive
-// change, you'll need to re-render the full strip data.  C'est la vie.
+// next call to show() will refresh the LEDs at this level.  With
+// setLossless(true) the color data in RAM is left untouched -- scaling
+// is applied to a copy of the data as show() prepares to issue it -- so
+// brightness changes are lossless and getPixelColor() returns the values
+// originally set.  Otherwise this process is potentially "lossy,"
+// especially when increasing brightness.  The tight timing in the
+// WS2811/WS2812 code means there aren't enough free cycles to perform
+// this scaling on the fly as data is issued.  So we make a pass through
+// the existing color data in RAM and scale it (subsequent graphics
+// commands also work at this brightness level).
 void Adafruit_NeoPixel::setBrightness(uint8_t b) {
   // Stored brightness value is different than what's passed.
   // This simplifies the actual scaling math later, allowing a fast
@@ -914,18 +984,169 @@ void Adafruit_NeoPixel::setBrightness(uint8_t b) {
   // brightness (off), 255 = just below max brightness.
   uint8_t newBrightness = b + 1;
   if(newBrightness != brightness) { // Compare against prior value
-    // Brightness has changed -- re-scale existing data in RAM
-    uint8_t  c,
-            *ptr           = pixels,
-             oldBrightness = brightness - 1; // De-wrap old brightness value
-    uint16_t scale;
-    if(oldBrightness == 0) scale = 0; // Avoid /0
-    else if(b == 255) scale = 65535 / oldBrightness;
-    else scale = (((uint16_t)newBrightness << 8) - 1) / oldBrightness;
-    for(uint16_t i=0; i<numBytes; i++) {
-      c      = *ptr;
-      *ptr++ = (c * scale) >> 8;
+    if(!outBuf && pixels) {
+      // Brightness has changed -- re-scale existing data in RAM
+      uint8_t  c,
+              *ptr           = pixels,
+               oldBrightness = brightness - 1; // De-wrap old brightness value
+      uint16_t scale;
+      if(oldBrightness == 0) scale = 0; // Avoid /0
+      else if(b == 255) scale = 65535 / oldBrightness;
+      else scale = (((uint16_t)newBrightness << 8) - 1) / oldBrightness;
+      for(uint16_t i=0; i<numBytes; i++) {
+        c      = *ptr;
+        *ptr++ = (c * scale) >> 8;
+      }
     }
     brightness = newBrightness;
+    dirty      = true;
+  }
+}
+
+// Return the brightness value last passed to setBrightness()
+uint8_t Adafruit_NeoPixel::getBrightness(void) const {
+  return brightness - 1;
+}
+
+// Enable or disable the built-in gamma correction table.
+void Adafruit_NeoPixel::setGamma(boolean on) {
+  setColorTable(on ? _NeoPixelGammaTable : NULL);
+}
+
+// Install a custom 256-entry color correction table.  The table MUST be
+// declared PROGMEM; each output byte is table[value] before brightness
+// scaling.  Pass NULL to disable correction.  Unless setLossless(true)
+// is in effect the table is applied as colors are set, so it only
+// affects pixels set after this call.
+void Adafruit_NeoPixel::setColorTable(const uint8_t *table) {
+  if(table != colorTable) {
+    colorTable = table;
+    dirty      = true;
+  }
+}
+
+// Look up a single value in the built-in gamma table (e.g. for sketches
+// that want to pre-correct colors themselves).
+uint8_t Adafruit_NeoPixel::gamma8(uint8_t x) {
+  return pgm_read_byte(&_NeoPixelGammaTable[x]);
+}
+
+// Keep the colors passed to setPixelColor() unmodified in RAM and apply
+// brightness and the color table to a second buffer as show() prepares
+// to issue data.  This is lossless, but doubles the RAM used for pixel
+// data and adds a pass over the data to each frame that has brightness
+// or a table in effect.  (The bitstream loops have no spare cycles for
+// the lookup and multiply, 8 MHz 800 KHz output least of all, so the
+// correction can't be done while the data is issued.)  Off by default:
+// colors are then corrected as they are set, with no extra RAM.  Should
+// the allocation fail, lossless mode stays off.  Colors set before
+// lossless mode is turned on were stored corrected and can't be restored,
+// so turning it on clears all pixels (to black); call it in setup() before
+// setting any colors.
+void Adafruit_NeoPixel::setLossless(boolean on) {
+  if(on == (outBuf != NULL)) return;
+  if(on) {
+    if((outBuf = (uint8_t *)malloc(numBytes)) && pixels) {
+      memset(pixels, 0, numBytes);
+      dirty = true;
+    }
+  } else {
+    // Apply the correction to the stored colors, so the output is
+    // unchanged, then drop the second buffer.
+    uint8_t *ptr = pixels;
+    for(uint16_t i=0; ptr && i<numBytes; i++, ptr++) *ptr = correct(*ptr);
+    free(outBuf);
+    outBuf = NULL;
+  }
+}
+
+// Apply the color table and brightness to one color value
+uint8_t Adafruit_NeoPixel::correct(uint8_t c) const {
+  if(colorTable) c = pgm_read_byte(&colorTable[c]);
+  if(brightness) c = (c * brightness) >> 8;
+  return c;
+}
+
+// Produce the byte stream for show().  Unless setLossless(true) is in
+// effect, or neither brightness nor a color table is in effect, the
+// pixel data is issued as-is with no extra pass.  Otherwise the
+// corrected data is written to 'outBuf'.
+uint8_t *Adafruit_NeoPixel::render(void) {
+  if(!outBuf || (!brightness && !colorTable)) return pixels;
+
+  const uint8_t *in  = pixels;
+  uint8_t       *out = outBuf;
+  uint16_t       i   = numBytes;
+  uint8_t        c;
+
+  if(colorTable) {
+    if(brightness) {
+      while(i--) {
+        c      = pgm_read_byte(&colorTable[*in++]);
+        *out++ = (c * brightness) >> 8;
+      }
+    } else {
+      while(i--) *out++ = pgm_read_byte(&colorTable[*in++]);
+    }
+  } else {
+    while(i--) *out++ = (*in++ * brightness) >> 8;
+  }
+
+  return outBuf;
+}
+
+// When enabled, show() skips the transfer if nothing has changed since
+// the frame last issued (the LEDs hold their last latched values
+// indefinitely).  Changes are tracked by setPixelColor() and the
+// settings functions; once getPixels() has been called a checksum of the
+// pixel data is compared as well.  Off by default.
+void Adafruit_NeoPixel::setSkipUnchanged(boolean on) {
+  skipUnchanged = on;
+  dirty         = true;
+}
+
+// Cap the rate at which show() actually issues data; calls arriving
+// sooner than 1/fps seconds after the previous frame return immediately.
+// 0 = no limit (default).
+void Adafruit_NeoPixel::setMaxFrameRate(uint16_t fps) {
+  frameTime = fps ? (1000000UL / fps) : 0;
+}
+
+// Force the next show() to issue data even if the pixels look unchanged
+// (e.g. after power-cycling the strip).
+void Adafruit_NeoPixel::setDirty(void) {
+  dirty = true;
+}
+
+// True if the last call to show() was throttled by setMaxFrameRate()
+// and its frame hasn't been issued yet.
+boolean Adafruit_NeoPixel::isPending(void) const {
+  return pending;
+}
+
+uint32_t Adafruit_NeoPixel::getFramesSent(void) const {
+  return framesSent;
+}
+
+uint32_t Adafruit_NeoPixel::getFramesSkipped(void) const {
+  return framesSkipped;
+}
+
+// Like a new strip, the next show() is not throttled.
+void Adafruit_NeoPixel::clearFrameCounts(void) {
+  framesSent = framesSkipped = 0;
+}
+
+// Fletcher-style sum over the pixel buffer.  The running second sum makes
+// it position-sensitive, so swapped or shifted colors are also detected.
+uint32_t Adafruit_NeoPixel::checksum(void) const {
+  const uint8_t *ptr = pixels;
+  uint16_t       i   = numBytes,
+                 s1  = 0,
+                 s2  = 0;
+  while(i--) {
+    s1 += *ptr++;
+    s2 += s1;
   }
+  return ((uint32_t)s2 << 16) | s1;
 }
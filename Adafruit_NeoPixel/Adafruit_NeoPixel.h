@@ -53,15 +53,29 @@ class Adafruit_NeoPixel {
     setPin(uint8_t p),
     setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b),
     setPixelColor(uint16_t n, uint32_t c),
-    setBrightness(uint8_t);
+    setBrightness(uint8_t),
+    setGamma(boolean on),
+    setColorTable(const uint8_t *table),
+    setLossless(boolean on),
+    setSkipUnchanged(boolean on),
+    setMaxFrameRate(uint16_t fps),
+    setDirty(void),
+    clearFrameCounts(void);
   uint8_t
-   *getPixels() const;
+   *getPixels() const,
+    getBrightness(void) const;
+  boolean
+    isPending(void) const;
   uint16_t
     numPixels(void) const;
   static uint32_t
     Color(uint8_t r, uint8_t g, uint8_t b);
+  static uint8_t
+    gamma8(uint8_t x);
   uint32_t
-    getPixelColor(uint16_t n) const;
+    getPixelColor(uint16_t n) const,
+    getFramesSent(void) const,
+    getFramesSkipped(void) const;
 
  private:
 
@@ -75,9 +89,22 @@ class Adafruit_NeoPixel {
   uint8_t
     pin,           // Output pin number
     brightness,
-   *pixels;        // Holds LED color values (3 bytes each)
+   *pixels,        // Holds LED color values (3 bytes each)
+   *outBuf;        // Corrected copy issued by show(), if lossless
+  const uint8_t
+   *colorTable;    // 256-entry PROGMEM correction table, or NULL
+  boolean
+    skipUnchanged, // If set, show() skips frames identical to the last
+    dirty,         // Pixels or settings changed since last frame was issued
+    pending;       // Last show() was throttled; its frame wasn't issued
+  mutable boolean
+    rawPixels;     // getPixels() was called; compare checksums in show()
   uint32_t
-    endTime;       // Latch timing reference
+    endTime,       // Latch timing reference
+    frameTime,     // Minimum micros between issued frames (0 = no limit)
+    frameSum,      // Checksum of the pixel data last issued
+    framesSent,    // Frames issued to the LEDs
+    framesSkipped; // show() calls that were skipped (unchanged/throttled)
 #ifdef __AVR__
   const volatile uint8_t
     *port;         // Output PORT register
@@ -85,6 +112,11 @@ class Adafruit_NeoPixel {
     pinMask;       // Output PORT bitmask
 #endif
 
+  uint8_t
+   *render(void),
+    correct(uint8_t c) const;
+  uint32_t
+    checksum(void) const;
 };
 
 #endif // ADAFRUIT_NEOPIXEL_H
@@ -0,0 +1,382 @@
+/*--------------------------------------------------------------------
+  Host-side bitstream timing check for the AVR show() loops.
+
+  Rather than trusting the hand-annotated clock counts, this reads the
+  inline assembly straight out of Adafruit_NeoPixel.cpp and runs every
+  AVR variant (8/12/16 MHz, 800/400 KHz, PORTD/PORTB) through a small
+  cycle-counting interpreter for the handful of instructions those loops
+  use.  The resulting pin waveform is measured bit by bit and checked
+  against the WS2812 (800 KHz) and WS2811 (400 KHz) datasheet windows,
+  and against the timing table in README.md.
+
+  Build and run from this directory with any host C++ compiler:
+
+    g++ -O2 -o timing timing.cpp && ./timing
+
+  Optional arguments: path to Adafruit_NeoPixel.cpp, path to README.md.
+  Exit status is nonzero if any variant fails.
+  --------------------------------------------------------------------*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Datasheet windows, ns: T0H and T1H nominal, each +/- tolerance.
+static const double
+  WS2812_T0H = 350.0, WS2812_T1H =  700.0,  // 800 KHz
+  WS2811_T0H = 500.0, WS2811_T1H = 1200.0,  // 400 KHz
+  TOLERANCE  = 150.0;
+
+// The 8 MHz 800 KHz loop is a known, documented exception (README.md):
+// its T1H lands just past the nominal WS2812 window.  It is still
+// measured and reported, but does not fail the run.
+static bool knownException(int mhz, int khz) {
+  return (mhz == 8) && (khz == 800);
+}
+
+struct Insn {
+  string op, a, b;
+};
+
+struct Variant {
+  int            mhz, khz;
+  string         port;    // "PORTD", "PORTB" or "PORT" (indirect ST)
+  int            line;
+  vector<Insn>   code;
+  map<string, int> labels;
+};
+
+static string trim(const string &s) {
+  size_t a = s.find_first_not_of(" \t"), b = s.find_last_not_of(" \t");
+  return (a == string::npos) ? "" : s.substr(a, b - a + 1);
+}
+
+// Operand text -> register name: "%[byte]" -> "byte", "%a[ptr]+" -> "ptr"
+static string regName(const string &s) {
+  size_t a = s.find('['), b = s.find(']');
+  return (a == string::npos) ? s : s.substr(a + 1, b - a - 1);
+}
+
+static void addInsn(Variant &v, string text) {
+  text = trim(text);
+  if(text.empty()) return;
+  if(text[text.size() - 1] == ':') {
+    v.labels[text.substr(0, text.size() - 1)] = v.code.size();
+    return;
+  }
+  Insn   in;
+  size_t sp = text.find_first_of(" \t");
+  in.op = text.substr(0, sp);
+  if(sp != string::npos) {
+    string args = text.substr(sp), *dst = &in.a;
+    for(size_t i = 0; i < args.size(); i++) {
+      if(args[i] == ',') dst = &in.b;
+      else if(args[i] != ' ' && args[i] != '\t') *dst += args[i];
+    }
+  }
+  v.code.push_back(in);
+}
+
+// Pull every AVR asm block out of the library source, tagged with the
+// CPU speed (from the enclosing F_CPU #if) and bitstream speed.
+static vector<Variant> extract(const char *path) {
+  vector<Variant> out;
+  ifstream        f(path);
+  string          line;
+  int             n = 0, mhz = 0, khz = 800;
+  bool            inAsm = false, inOperands = false;
+  string          body;
+
+  while(getline(f, line)) {
+    n++;
+    string t = trim(line);
+    if(t.find("defined(__arm__)") != string::npos) break; // AVR code ends
+    if(t.compare(0, 3, "#if") == 0 || t.compare(0, 5, "#elif") == 0) {
+      if(t.find("F_CPU >= 7400000")  != string::npos) mhz =  8, khz = 800;
+      if(t.find("F_CPU >= 11100000") != string::npos) mhz = 12, khz = 800;
+      if(t.find("F_CPU >= 15400000") != string::npos) mhz = 16, khz = 800;
+      continue;
+    }
+    if(!inAsm && t.find("} else {") != string::npos &&
+       t.find("400") != string::npos) khz = 400;
+    if(!inAsm && t.find("asm volatile(") != string::npos) {
+      Variant v;
+      v.mhz  = mhz;
+      v.khz  = khz;
+      v.line = n;
+      out.push_back(v);
+      inAsm  = true;
+      inOperands = false;
+      body.clear();
+      continue;
+    }
+    if(!inAsm) continue;
+    if(!inOperands && t.size() && t[0] == ':') {
+      // End of instructions; split on the "\n" escapes and parse.
+      Variant &v = out.back();
+      size_t   p;
+      while((p = body.find("\\n")) != string::npos) {
+        addInsn(v, body.substr(0, p));
+        body.erase(0, p + 2);
+        if(body.compare(0, 2, "\\t") == 0) body.erase(0, 2);
+      }
+      addInsn(v, body);
+      inOperands = true;
+    }
+    if(inOperands) {
+      Variant &v = out.back();
+      if(t.find("PORTD") != string::npos)      v.port = "PORTD";
+      else if(t.find("PORTB") != string::npos) v.port = "PORTB";
+      else if(t.find("[port]") != string::npos && v.port.empty())
+        v.port = "PORT";
+      if(t.find(");") != string::npos) inAsm = false;
+      continue;
+    }
+    // Collect string literals ahead of any // comment.
+    size_t c = t.find("//");
+    if(c != string::npos) t.erase(c);
+    for(size_t i = 0; i < t.size(); i++) {
+      if(t[i] != '"') continue;
+      size_t e = t.find('"', i + 1);
+      body += t.substr(i + 1, e - i - 1);
+      i = e;
+    }
+  }
+  return out;
+}
+
+struct Edge {
+  long t;
+  int  level;
+};
+
+// Execute one variant over 'data', returning pin edges in CPU cycles.
+// Registers hold the pin in bit 0 (hi = 1, lo = 0), mirroring the
+// hi/lo/next setup done in C ahead of each block in show().
+static bool run(const Variant &v, const vector<uint8_t> &data,
+  vector<Edge> &edges, string &err) {
+  map<string, int> r;
+  size_t ptr = 0;
+  int    z = 0, pin = 0;
+  long   t = 0;
+  vector<size_t> stack;
+  bool   hasBit = false;
+
+  for(size_t i = 0; i < v.code.size(); i++)
+    if(v.code[i].a == "%[bit]") hasBit = true;
+
+  r["hi"]    = 1;
+  r["lo"]    = 0;
+  r["byte"]  = data[ptr++];
+  r["count"] = data.size();
+  r["n2"]    = 0;
+  if(hasBit) {
+    r["next"] = r["lo"];
+    r["bit"]  = 8;
+  } else {
+    r["n1"] = r["next"] = (r["byte"] & 0x80) ? r["hi"] : r["lo"];
+  }
+
+  size_t pc = 0;
+  long   limit = 1000L * data.size() * 8;
+  while(pc < v.code.size()) {
+    if(t > limit) { err = "runaway loop"; return false; }
+    const Insn &in = v.code[pc++];
+    string      ra = regName(in.a), rb = regName(in.b);
+    int         level = -1;
+
+    if(in.op == "out" || in.op == "st") {
+      t    += (in.op == "out") ? 1 : 2;
+      level = r[rb] & 1;
+    } else if(in.op == "mov") {
+      r[ra] = r[rb]; t += 1;
+    } else if(in.op == "ldi") {
+      r[ra] = atoi(in.b.c_str()); t += 1;
+    } else if(in.op == "nop") {
+      t += 1;
+    } else if(in.op == "dec") {
+      r[ra] = (r[ra] - 1) & 0xFF; z = !r[ra]; t += 1;
+    } else if(in.op == "rol") {
+      r[ra] = (r[ra] << 1) & 0xFF; z = !r[ra]; t += 1; // carry is unused
+    } else if(in.op == "sbiw") {
+      r[ra] = (r[ra] - atoi(in.b.c_str())) & 0xFFFF; z = !r[ra]; t += 2;
+    } else if(in.op == "ld") {
+      r[ra] = (ptr < data.size()) ? data[ptr] : 0; ptr++; t += 2;
+    } else if(in.op == "sbrc") {
+      if(r[ra] & (1 << atoi(in.b.c_str()))) t += 1;
+      else { pc++; t += 2; } // skipped insn is always one word here
+    } else if(in.op == "rjmp" || in.op == "rcall") {
+      t += (in.op == "rjmp") ? 2 : 3;
+      if(in.op == "rcall") stack.push_back(pc);
+      if(in.a != ".+0") {
+        if(!v.labels.count(in.a)) { err = "no label " + in.a; return false; }
+        pc = v.labels.find(in.a)->second;
+      }
+    } else if(in.op == "ret") {
+      t += 4;
+      if(stack.empty()) { err = "ret with empty stack"; return false; }
+      pc = stack.back();
+      stack.pop_back();
+    } else if(in.op == "breq" || in.op == "brne") {
+      bool take = (in.op == "breq") ? z : !z;
+      t += take ? 2 : 1;
+      if(take) {
+        if(!v.labels.count(in.a)) { err = "no label " + in.a; return false; }
+        pc = v.labels.find(in.a)->second;
+      }
+    } else {
+      err = "unhandled instruction '" + in.op + "'";
+      return false;
+    }
+    // Port write lands at the end of the instruction; only record changes.
+    if((level >= 0) && (level != pin)) {
+      Edge e = { t, level };
+      edges.push_back(e);
+      pin = level;
+    }
+  }
+  if(pin) { err = "line left high"; return false; }
+  return true;
+}
+
+struct Row {
+  int clocks;
+  double t0h, t1h;
+};
+
+// README timing table: "| 8 MHz  | 800 KHz | 10 | 250 ns | 875 ns | ..."
+static map<int, Row> readme(const char *path) {
+  map<int, Row> rows;
+  ifstream      f(path);
+  string        line;
+  while(getline(f, line)) {
+    int    mhz, khz, clocks;
+    double t0h, t1h;
+    if(sscanf(line.c_str(), "| %d MHz | %d KHz | %d | %lf ns | %lf ns",
+      &mhz, &khz, &clocks, &t0h, &t1h) == 5) {
+      Row row = { clocks, t0h, t1h };
+      rows[mhz * 1000 + khz] = row;
+    }
+  }
+  return rows;
+}
+
+int main(int argc, char *argv[]) {
+  const char *src = (argc > 1) ? argv[1] : "../../Adafruit_NeoPixel.cpp",
+             *doc = (argc > 2) ? argv[2] : "../../README.md";
+
+  vector<Variant> variants = extract(src);
+  map<int, Row>   table    = readme(doc);
+  if(variants.empty()) {
+    fprintf(stderr, "no asm blocks found in %s\n", src);
+    return 1;
+  }
+
+  // Test pattern exercises every bit position in both states, runs of
+  // 0s and 1s, and the byte-reload path between unlike bytes.
+  vector<uint8_t> data;
+  const uint8_t fixed[] = { 0x00, 0xFF, 0xAA, 0x55, 0x80, 0x01, 0x7F, 0xFE,
+                            0xF0, 0x0F, 0xFF, 0x00 };
+  data.assign(fixed, fixed + sizeof(fixed));
+  uint32_t seed = 12345;
+  for(int i = 0; i < 60; i++) {
+    seed = seed * 1103515245 + 12345;
+    data.push_back(seed >> 24);
+  }
+
+  int failures = 0;
+  printf("%-6s %-7s %-5s %6s %10s %10s %9s %10s  %s\n", "CPU", "Stream",
+    "Port", "Clocks", "T0H", "T1H", "Period", "Pixels/s", "Result");
+
+  for(size_t k = 0; k < variants.size(); k++) {
+    const Variant &v = variants[k];
+    vector<Edge>   edges;
+    string         err;
+    bool           ok = run(v, data, edges, err);
+
+    // Pair edges into bits: rise..fall is the high time, rise..rise
+    // is the period (the final bit has no following rise).
+    vector<long> t0h, t1h, period;
+    size_t       bits = 0;
+    for(size_t i = 0; ok && (i + 1 < edges.size()); i += 2) {
+      if(!edges[i].level || edges[i + 1].level) {
+        err = "edges out of order"; ok = false; break;
+      }
+      long high = edges[i + 1].t - edges[i].t;
+      int  want = (data[bits / 8] >> (7 - (bits % 8))) & 1;
+      (want ? t1h : t0h).push_back(high);
+      if(i + 2 < edges.size()) period.push_back(edges[i + 2].t - edges[i].t);
+      bits++;
+    }
+    if(ok && (bits != data.size() * 8)) {
+      char buf[64];
+      sprintf(buf, "%u bits out, expected %u", (unsigned)bits,
+        (unsigned)(data.size() * 8));
+      err = buf; ok = false;
+    }
+
+    // Every path through the loop must take the same number of clocks.
+    // High times may differ slightly from bit to bit (the 12 MHz 800 KHz
+    // loop stretches T0H on bit 0 to fit the byte load), so each value's
+    // full range is checked against the window.
+    for(size_t i = 1; ok && (i < period.size()); i++)
+      if(period[i] != period[0]) { err = "bit period varies"; ok = false; }
+    if(ok && (t0h.empty() || t1h.empty())) {
+      err = "test pattern lacks 0 or 1 bits"; ok = false;
+    }
+
+    double ns = 1000.0 / v.mhz, T0H[2] = { 0, 0 }, T1H[2] = { 0, 0 },
+           P = 0, pps = 0;
+    string note;
+    if(ok) {
+      T0H[0] = *min_element(t0h.begin(), t0h.end()) * ns;
+      T0H[1] = *max_element(t0h.begin(), t0h.end()) * ns;
+      T1H[0] = *min_element(t1h.begin(), t1h.end()) * ns;
+      T1H[1] = *max_element(t1h.begin(), t1h.end()) * ns;
+      P      = period[0] * ns;
+      pps    = 1e9 / (P * 24.0);
+
+      double n0 = (v.khz == 800) ? WS2812_T0H : WS2811_T0H,
+             n1 = (v.khz == 800) ? WS2812_T1H : WS2811_T1H;
+      bool inWindow = (fabs(P - 1e6 / v.khz) <= 2 * TOLERANCE);
+      for(int j = 0; j < 2; j++)
+        inWindow &= (fabs(T0H[j] - n0) <= TOLERANCE) &&
+                    (fabs(T1H[j] - n1) <= TOLERANCE);
+      if(!inWindow) {
+        if(knownException(v.mhz, v.khz)) note = "outside nominal (known)";
+        else { err = "outside datasheet window"; ok = false; }
+      }
+
+      // README lists the typical (shortest) high time for each bit value.
+      map<int, Row>::const_iterator row = table.find(v.mhz * 1000 + v.khz);
+      if(ok && (row == table.end())) {
+        err = "no README row"; ok = false;
+      } else if(ok && ((row->second.clocks != period[0]) ||
+        (fabs(row->second.t0h - T0H[0]) > 1.0) ||
+        (fabs(row->second.t1h - T1H[0]) > 1.0))) {
+        err = "README table disagrees"; ok = false;
+      }
+    }
+
+    char t0[16], t1[16];
+    sprintf(t0, (T0H[1] > T0H[0]) ? "%.0f-%.0f" : "%.0f", T0H[0], T0H[1]);
+    sprintf(t1, (T1H[1] > T1H[0]) ? "%.0f-%.0f" : "%.0f", T1H[0], T1H[1]);
+    printf("%-6d %-7d %-5s %6ld %7s ns %7s ns %6.2f us %10.0f  %s",
+      v.mhz, v.khz, v.port.c_str(), ok ? period[0] : 0L, t0, t1,
+      P / 1000.0, pps, ok ? "ok" : "FAIL");
+    if(!ok)               printf(" (line %d: %s)", v.line, err.c_str());
+    else if(note.size())  printf(" (%s)", note.c_str());
+    printf("\n");
+    if(!ok) failures++;
+  }
+
+  printf("%u variants, %d failed\n", (unsigned)variants.size(), failures);
+  return failures ? 1 : 0;
+}
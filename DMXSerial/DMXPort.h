@@ -0,0 +1,902 @@
+// - - - - -
+// DMXSerial - A hardware supported interface to DMX.
+// DMXPort.h: DMX on any hardware USART, one universe per port.
+//
+// Copyright (c) 2011 by Matthias Hertel, http://www.mathertel.de
+// This work is licensed under a BSD style license. See http://www.mathertel.de/License.aspx
+//
+// Documentation and samples are available at http://www.mathertel.de/Arduino
+// 19.10.2026 creation of DMXPort: the DMXSerial state machine as a template,
+//            with all state inside the object, so boards with several USARTs
+//            (like the Arduino MEGA 2560) can run several universes at once.
+// 19.10.2026 DMXPort is the only implementation of the state machine: double buffering,
+//            change detection, transmit scheduling and the receiver statistics moved here
+//            from DMXSerial.cpp, and the DMXSerial object is a DMXPort on the default USART.
+// - - - - -
+//
+// A DMXPort<N> uses USART N and keeps its state in the object, so every USART can have its own.
+// The interrupt routines are generated for each port by the DMXPORT_ISR macro:
+//
+//   #include <DMXPort.h>
+//   DMXPort<1> dmxA(22);    // USART1, data direction on pin 22
+//   DMXPort<2> dmxB(23);    // USART2, data direction on pin 23
+//   DMXPORT_ISR(1, dmxA)
+//   DMXPORT_ISR(2, dmxB)
+//
+// Don't use a USART that is also used by HardwareSerial (Serial, Serial1, ...) or, when the
+// sketch includes DMXSerial.h, by the DMXSerial object. The ISRs would be defined twice.
+
+#ifndef DmxPort_h
+#define DmxPort_h
+
+#include "Arduino.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+// ----- Debugging -----
+
+// to debug on an oscilloscope, enable this
+#undef SCOPEDEBUG
+//#define SCOPEDEBUG
+#ifdef SCOPEDEBUG
+#define DmxTriggerPin 4	// low spike at beginning of start byte
+#define DmxISRPin 3	// low during interrupt service routines
+#define DmxTxTrigPin  8 // JVS: added high spike at end of last channel stop bit
+#endif
+
+// ----- Constants -----
+
+#define DMXSERIAL_MAX 512 // max. number of supported DMX data channels
+
+#define DmxModeOut HIGH  // set the level to HIGH for outgoing data direction
+#define DmxModeIn  LOW   // set the level to LOW  for incomming data direction
+
+// the break timing is 10 bits (start + 8 data + parity) of this speed
+// the mark-after-break is 1 bit of this speed plus approx 6 usec
+// 100000 bit/sec is good: gives 100 usec break and 16 usec MAB
+// 1990 spec says transmitter must send >= 92 usec break and >= 12 usec MAB
+// receiver must accept 88 us break and 8 us MAB
+#define DMXPORT_BREAKSPEED 100000
+#define DMXPORT_DMXSPEED   250000
+
+// calculate prescaler from baud rate and cpu clock rate at compile time
+// nb implements rounding of ((clock / 16) / baud) - 1 per atmega datasheet
+#define DMXPORT_PRESCALE(B) ( ( (((F_CPU)/8)/(B)) - 1 ) / 2 )
+
+// ----- Enumerations -----
+
+// Mode of Operation
+typedef enum {
+  DMXNone, // unspecified
+  DMXController, // always sending
+  DMXReceiver    // always listening
+} DMXMode;
+
+// Number of channels sent in each frame (DMXController mode)
+typedef enum {
+  DMXSendMax,   // up to maxChannel(), automatically increased by write() (default)
+  DMXSendFixed, // exactly maxChannel() channels
+  DMXSendUsed   // up to the highest channel with a non-zero value
+} DMXSendMode;
+
+// ----- USART register access -----
+
+// DMXUsart<N> gives access to the registers of USART N.
+// n is the number in the register names, empty on chips with a single USART (ATmega8).
+// The bit names are lower case, the upper case ones are macros on some chips.
+template <uint8_t N> struct DMXUsart;
+
+#define DMXPORT_USART(N, n) \
+template <> struct DMXUsart<N> { \
+  static uint8_t ucsra()        { return UCSR##n##A; } \
+  static void ucsra(uint8_t v)  { UCSR##n##A = v; } \
+  static void ucsrb(uint8_t v)  { UCSR##n##B = v; } \
+  static void ucsrc(uint8_t v)  { UCSR##n##C = v; } \
+  static void ubrr(uint16_t v)  { UBRR##n##H = v >> 8; UBRR##n##L = v; } \
+  static uint8_t udr()          { return UDR##n; } \
+  static void udr(uint8_t v)    { UDR##n = v; } \
+  enum { \
+    rxcie = RXCIE##n, txcie = TXCIE##n, udrie = UDRIE##n, rxen = RXEN##n, txen = TXEN##n, \
+    usbs = USBS##n, ucsz0 = UCSZ##n##0, upm0 = UPM##n##0, fe = FE##n, dor = DOR##n \
+  }; \
+};
+
+#if defined(UCSR0A)
+DMXPORT_USART(0, 0)
+#elif defined(UCSRA)
+DMXPORT_USART(0, )
+#endif
+#if defined(UCSR1A)
+DMXPORT_USART(1, 1)
+#endif
+#if defined(UCSR2A)
+DMXPORT_USART(2, 2)
+#endif
+#if defined(UCSR3A)
+DMXPORT_USART(3, 3)
+#endif
+
+// Interrupt vector names of each USART.
+// The first USART has no number in them on chips that have only one.
+#if defined(USART_RXC_vect)
+// ATmega8
+#define DMXPORT_RX_VECT0   USART_RXC_vect
+#define DMXPORT_TX_VECT0   USART_TXC_vect
+#define DMXPORT_UDRE_VECT0 USART_UDRE_vect
+#elif defined(USART_RX_vect)
+// ATmega168p and ATmega328p, like the Arduino Diecimila, Duemilanove, 2009, Uno
+#define DMXPORT_RX_VECT0   USART_RX_vect
+#define DMXPORT_TX_VECT0   USART_TX_vect
+#define DMXPORT_UDRE_VECT0 USART_UDRE_vect
+#else
+// ATmega1280 and ATmega2560, like the Arduino MEGA boards
+#define DMXPORT_RX_VECT0   USART0_RX_vect
+#define DMXPORT_TX_VECT0   USART0_TX_vect
+#define DMXPORT_UDRE_VECT0 USART0_UDRE_vect
+#endif
+#define DMXPORT_RX_VECT1   USART1_RX_vect
+#define DMXPORT_TX_VECT1   USART1_TX_vect
+#define DMXPORT_UDRE_VECT1 USART1_UDRE_vect
+#define DMXPORT_RX_VECT2   USART2_RX_vect
+#define DMXPORT_TX_VECT2   USART2_TX_vect
+#define DMXPORT_UDRE_VECT2 USART2_UDRE_vect
+#define DMXPORT_RX_VECT3   USART3_RX_vect
+#define DMXPORT_TX_VECT3   USART3_TX_vect
+#define DMXPORT_UDRE_VECT3 USART3_UDRE_vect
+
+// Generate the interrupt routines of USART N for the DMXPort object port.
+// N may be a macro, like DMXSERIAL_USART.
+#define DMXPORT_ISR(N, port) _DMXPORT_ISR(N, port)
+#define _DMXPORT_ISR(N, port) \
+ISR(DMXPORT_RX_VECT##N)   { port.rxISR(); } \
+ISR(DMXPORT_TX_VECT##N)   { port.txISR(); } \
+ISR(DMXPORT_UDRE_VECT##N) { port.udreISR(); }
+
+// ----- TIMER0 COMPB tick -----
+
+// Waiting between frames for refreshRate() is timed by the TIMER0 compare B interrupt.
+// So that the library doesn't claim that vector for every sketch, the handler
+// is only compiled in when the sketch asks for it, in one source file only:
+//   #define DMX_TIMER0_COMPB
+//   #include <DMXSerial.h>   (or <DMXPort.h>)
+// It ticks all ports that were initialized; see DMXSerial.cpp.
+void _DMXSerialTimerTick();
+bool _DMXSerialTimerHandler();
+
+// The part of a port the timer tick sees.
+class DMXPortBase
+{
+  public:
+    // Called on every TIMER0 COMPB interrupt. Returns true while the port waits for it.
+    virtual bool timerTick() { return(false); }
+
+    static DMXPortBase *_ports; // all initialized ports
+    DMXPortBase *_nextPort;
+
+  protected:
+    // Add this port to _ports, once. Interrupts must be disabled.
+    void join()
+    {
+      DMXPortBase **p = &_ports;
+      while (*p && (*p != this)) p = &(*p)->_nextPort;
+      if (! *p) {
+        _nextPort = NULL;
+        *p = this;
+      } // if
+    } // join()
+}; // class DMXPortBase
+
+// ----- Library Class -----
+
+template <uint8_t N>
+class DMXPort : public DMXPortBase
+{
+  typedef DMXUsart<N> U;
+
+  public:
+    // Create a port on USART N. modePin controls the data direction of the line driver, -1 if none.
+    DMXPort(int modePin = -1) :
+      _modePin(modePin), _mode(DMXNone), _recvState(IDLE), _channel(0),
+      _maxChannel(32), _usedChannel(1), _usedHigh(0), _sendMode(DMXSendMax),
+      _breakSetting(DMXPORT_PRESCALE(DMXPORT_BREAKSPEED)), _breakFormat(FORMAT_8E1),
+      _frameInterval(0), _idleInterval(0), _written(true), _gotLastPacket(0),
+      _buffer(_data), _appData(_data), _swap(0), _recvDiff(0),
+      _pending(NULL), _changeBits(_changed),
+      _frameCount(0), _otherStartCodes(0), _overruns(0), _frameDone(false), _onFrame(NULL) { }
+
+    // (Re)Initialize the specified mode.
+    // The mode parameter should be a value from enum DMXMode.
+    void init(int mode)
+    {
+#ifdef SCOPEDEBUG
+      pinMode(DmxTriggerPin, OUTPUT);
+      pinMode(DmxISRPin, OUTPUT);
+      pinMode(DmxTxTrigPin, OUTPUT);
+#endif
+
+      // initialize the state
+      U::ucsrb(0);
+      uint8_t oldSREG = SREG;
+      cli();
+      join();
+      SREG = oldSREG;
+      _mode = DMXNone;
+      _recvState = IDLE; // initial state
+      _channel = 0;
+      _gotLastPacket = millis(); // remember current (relative) time in msecs.
+
+      // initialize the DMX buffer
+      _swap = 0;
+      _recvDiff = 0;
+      for (int n = 0; n < DMXSERIAL_MAX+1; n++)
+        _buffer[n] = _appData[n] = 0;
+      memset(_changed, 0, sizeof(_changed));
+      if (_pending) memset(_pending, 0, sizeof(_changed));
+      _usedChannel = 1;
+      _usedHigh = 0;
+      _frameCount = 0;
+      _frameDone = false;
+      _otherStartCodes = 0;
+      _overruns = 0;
+
+      // now start
+      _mode = (DMXMode)mode;
+
+      if (_mode == DMXController) {
+        // Setup external mode signal
+        if (_modePin >= 0) {
+          pinMode(_modePin, OUTPUT);
+          digitalWrite(_modePin, DmxModeOut); // data Out direction
+        } // if
+
+        // Start sending a BREAK and loop (forever) in UDRE ISR
+        startFrame();
+
+      } else if (_mode == DMXReceiver) {
+        // Setup external mode signal
+        if (_modePin >= 0) {
+          pinMode(_modePin, OUTPUT);
+          digitalWrite(_modePin, DmxModeIn); // data in direction
+        } // if
+
+        // Enable receiver and Receive interrupt
+        U::ucsrb((1<<U::rxen) | (1<<U::rxcie));
+        baud(DMXPORT_PRESCALE(DMXPORT_DMXSPEED), FORMAT_8N2); // Enable serial reception with a 250k rate
+      } // if
+    } // init()
+
+    // Set the maximum used channel for DMXController mode.
+    // This method can be called any time before or after the init() method.
+    void maxChannel(int channel)
+    {
+      if (channel < 1) channel = 1;
+      if (channel > DMXSERIAL_MAX) channel = DMXSERIAL_MAX;
+      _maxChannel = channel;
+    } // maxChannel()
+
+    // Read the last known value of a channel.
+    uint8_t read(int channel)
+    {
+      if (channel < 1) channel = 1;
+      if (channel > DMXSERIAL_MAX) channel = DMXSERIAL_MAX;
+      return(_appData[channel]);
+    } // read()
+
+    // Write a new value of a channel.
+    // The value is just stored in the sending buffer and will be picked up
+    // by the DMX sending interrupt routine.
+    void write(int channel, uint8_t value)
+    {
+      if (channel < 1) channel = 1;
+      if (channel > DMXSERIAL_MAX) channel = DMXSERIAL_MAX;
+
+      // store value for later sending
+      if (_swap) syncAppData();
+      _appData[channel] = value;
+      _written = true;
+
+      // Make sure we transmit enough channels for the ones used
+      if ((_sendMode == DMXSendMax) && (channel > _maxChannel))
+        _maxChannel = channel;
+
+      // Track the highest channel in use
+      if (value) {
+        if (channel > _usedChannel) _usedChannel = channel;
+      } else if (channel == _usedChannel) {
+        while ((channel > 1) && (_appData[channel] == 0)) channel--;
+        usedChannel(channel);
+      } // if
+    } // write()
+
+    // Copy a block of channel values, starting at channel start.
+    // Returns the number of channels actually copied.
+    // With double buffering all values are guaranteed to come from the same frame.
+    int readRange(int start, uint8_t *values, int count)
+    {
+      count = clip(start, count);
+      if (count <= 0) return(0);
+
+      // Only the receive ISR swaps on its own, so HOLD is only needed there.
+      // The ISRs also write _swap, so set and clear it with interrupts off.
+      bool hold = (_mode == DMXReceiver) && (_appData != _buffer);
+      uint8_t oldSREG;
+      if (hold) {
+        oldSREG = SREG;
+        cli();
+        _swap |= SWAP_HOLD;
+        SREG = oldSREG;
+      } // if
+      memcpy(values, _appData + start, count);
+      if (hold) {
+        oldSREG = SREG;
+        cli();
+        _swap &= ~SWAP_HOLD;
+        SREG = oldSREG;
+      } // if
+      return(count);
+    } // readRange()
+
+    int writeRange(int start, const uint8_t *values, int count)
+    {
+      count = clip(start, count);
+      if (count <= 0) return(0);
+
+      // store values for later sending
+      if (_swap) syncAppData();
+      memcpy(_appData + start, values, count);
+      _written = true;
+
+      int last = start + count - 1;
+
+      // Make sure we transmit enough channels for the ones used
+      if ((_sendMode == DMXSendMax) && (last > _maxChannel))
+        _maxChannel = last;
+
+      // Track the highest channel in use
+      if (_usedChannel <= last) {
+        // the range reaches the old top: search down from its end
+        int used = last;
+        while ((used > 1) && (_appData[used] == 0)) used--;
+        usedChannel(used);
+      } // if
+      return(count);
+    } // writeRange()
+
+    // Use a second buffer so the interrupt routines never see a half-updated universe.
+    // This costs another DMXSERIAL_MAX+1 bytes of RAM from the heap,
+    // plus DMXSERIAL_MAX/8 for the change bits of the frame being received.
+    // Returns false if the buffer can't be allocated.
+    //
+    // _buffer is the array the interrupt routines send from or receive into,
+    // _appData the one behind read() and write(). Both point to _data
+    // unless doubleBuffer(true) was called, in which case _appData gets its own array
+    // and the two are swapped at a BREAK:
+    // DMXController: when commit() was called; the application side then re-syncs
+    //   from the new ISR buffer before its next write.
+    // DMXReceiver: whenever a complete frame was received, unless readRange() is busy copying.
+    bool doubleBuffer(bool enable)
+    {
+      if (enable && (_appData == _buffer)) {
+        uint8_t *spare = (uint8_t *)malloc(DMXSERIAL_MAX+1 + sizeof(_changed));
+        if (! spare) return(false);
+        memcpy(spare, _data, DMXSERIAL_MAX+1);
+        memset(spare + DMXSERIAL_MAX+1, 0, sizeof(_changed));
+        uint8_t oldSREG = SREG;
+        cli();
+        _buffer  = _data;
+        _appData = spare;
+        _pending = _changeBits = spare + DMXSERIAL_MAX+1;
+        _swap    = 0;
+        _recvDiff = 0;
+        SREG = oldSREG;
+
+      } else if (!enable && (_appData != _buffer)) {
+        uint8_t oldSREG = SREG;
+        cli();
+        // keep the application's view of the data
+        uint8_t *spare = (_appData == _data) ? _buffer : _appData;
+        if (_appData != _data)
+          memcpy(_data, _appData, DMXSERIAL_MAX+1);
+        _buffer = _appData = _data;
+        _swap   = 0;
+        _changeBits = _changed; // bits of the unpublished frame are dropped with it
+        _pending = NULL;
+        SREG = oldSREG;
+        free(spare);
+      } // if
+      return(true);
+    } // doubleBuffer()
+
+    // DMXController with double buffering: send everything written so far,
+    // starting with the next frame. Without double buffering, writes are
+    // sent immediately anyway and this does nothing.
+    void commit(void)
+    {
+      if ((_mode == DMXController) && (_appData != _buffer)) {
+        if (_swap) syncAppData();
+        _swap = SWAP_PENDING;
+        _written = true;
+      } // if
+    } // commit()
+
+    // DMXController: limit the refresh rate to hz frames per second (0 = as fast as possible).
+    // When idleHz is given, frames are sent at that lower rate while no values are written.
+    // DMX requires at least one frame per second, so idleHz should be 1 or more.
+    // Returns false unless the sketch defines DMX_TIMER0_COMPB (see above);
+    // without it the frame intervals stay 0, so the timer interrupt is never enabled.
+    bool refreshRate(uint16_t hz, uint16_t idleHz = 0)
+    {
+      if (! _DMXSerialTimerHandler()) return(false);
+      uint8_t oldSREG = SREG;
+      cli();
+      _frameInterval = hz ? 1000 / hz : 0;
+      _idleInterval = idleHz ? 1000 / idleHz : 0;
+      SREG = oldSREG;
+      return(true);
+    } // refreshRate()
+
+    // DMXController: set the length of the BREAK and MARK after BREAK in microseconds.
+    // The BREAK is sent as a 0 byte with even parity (10 low bits) at a lower baud rate,
+    // so the BREAK length sets that rate. The MAB is made of the stop bits of that byte:
+    // one or two bit times (a tenth or fifth of the BREAK) plus about 6 usec,
+    // whichever is the shortest that is not less than mabUsec.
+    // The 1990 spec requires >= 92 usec break and >= 12 usec MAB from a transmitter.
+    void breakTiming(uint16_t breakUsec, uint16_t mabUsec)
+    {
+      if (breakUsec < 92) breakUsec = 92;
+      if (breakUsec > 1000) breakUsec = 1000;
+      unsigned long baud = 10000000UL / breakUsec;
+      uint16_t bitUsec = breakUsec / 10;
+
+      uint8_t oldSREG = SREG;
+      cli();
+      _breakSetting = ((F_CPU / 8) / baud - 1) / 2;
+      _breakFormat = (mabUsec > bitUsec + 6) ? FORMAT_8E2 : FORMAT_8E1;
+      SREG = oldSREG;
+    } // breakTiming()
+
+    // DMXController: choose how many channels are sent in each frame.
+    void sendMode(DMXSendMode mode)
+    {
+      _sendMode = mode;
+    } // sendMode()
+
+    // Calculate how long no data packet was received.
+    unsigned long noDataSince()
+    {
+      uint8_t oldSREG = SREG;
+      cli();
+      unsigned long last = _gotLastPacket;
+      SREG = oldSREG;
+      return(millis() - last);
+    } // noDataSince()
+
+    // DMXReceiver: return the next channel after the given one whose value changed
+    // since it was last returned, or 0 if there is none. Start with channel 0.
+    //
+    // The receive ISR compares each byte with the value the application currently sees
+    // and sets bit (channel-1) when it differs. nextChanged() clears the bits again.
+    // With double buffering the application doesn't see the new values until the swap,
+    // so the ISR collects the bits in _pending (behind the spare buffer) instead
+    // and frameDone() moves them into _changed when it swaps.
+    int nextChanged(int channel)
+    {
+      if (channel < 0) channel = 0;
+
+      // channel n is bit (n-1), so the search starts at bit 'channel'
+      for (int n = channel; n < DMXSERIAL_MAX; n++) {
+        uint8_t *p = &_changed[n >> 3];
+        if (*p == 0) {
+          n |= 7; // skip the rest of this byte
+        } else if (*p & (1 << (n & 7))) {
+          uint8_t oldSREG = SREG;
+          cli();
+          *p &= ~(1 << (n & 7));
+          SREG = oldSREG;
+          return(n + 1);
+        } // if
+      } // for
+      return(0);
+    } // nextChanged()
+
+    // DMXReceiver: true if any channel changed since nextChanged() last returned it.
+    bool dataUpdated(void)
+    {
+      for (uint8_t n = 0; n < sizeof(_changed); n++)
+        if (_changed[n]) return(true);
+      return(false);
+    } // dataUpdated()
+
+    // DMXReceiver: true once for every frame that was completely received.
+    bool frameComplete(void)
+    {
+      bool ret = _frameDone;
+      _frameDone = false;
+      return(ret);
+    } // frameComplete()
+
+    // DMXReceiver: number of complete frames received (wraps around).
+    unsigned int frameCount(void)
+    {
+      uint8_t oldSREG = SREG;
+      cli();
+      unsigned int ret = _frameCount;
+      SREG = oldSREG;
+      return(ret);
+    } // frameCount()
+
+    // DMXReceiver: frames ignored because of a start code other than 0 (e.g. RDM).
+    unsigned int otherStartCodes(void)
+    {
+      uint8_t oldSREG = SREG;
+      cli();
+      unsigned int ret = _otherStartCodes;
+      SREG = oldSREG;
+      return(ret);
+    } // otherStartCodes()
+
+    // DMXReceiver: bytes lost because the receive ISR was held off for longer
+    // than two byte times (88 usec) by other interrupts.
+    unsigned int overrunErrors(void)
+    {
+      uint8_t oldSREG = SREG;
+      cli();
+      unsigned int ret = _overruns;
+      SREG = oldSREG;
+      return(ret);
+    } // overrunErrors()
+
+    // DMXReceiver: function called from the receive ISR at the end of every frame, or NULL.
+    // Keep it short; interrupts are disabled while it runs.
+    void attachOnFrame(void (*onFrame)(void))
+    {
+      _onFrame = onFrame;
+    } // attachOnFrame()
+
+    // Terminate operation.
+    // A port waiting for the timer tick stops at the next one.
+    void term(void)
+    {
+      // Disable all USART Features, including Interrupts
+      U::ucsrb(0);
+      _mode = DMXNone;
+    } // term()
+
+    // ----- interrupt handlers, called by the ISRs from DMXPORT_ISR -----
+
+    // A byte or frame error was received.
+    // In DMXController mode this interrupt is disabled and will not occur.
+    // In DMXReceiver mode when a byte was received it is stored to the buffer.
+    inline void rxISR()
+    {
+      uint8_t USARTstate = U::ucsra(); // get state before data!
+      uint8_t DmxByte    = U::udr();   // get data
+      uint8_t DmxState   = _recvState; // just load once from SRAM to increase speed
+
+#ifdef SCOPEDEBUG
+      digitalWrite(DmxISRPin, LOW);
+#endif
+
+      if (USARTstate & (1<<U::dor))
+        _overruns++;
+
+      if (USARTstate & (1<<U::fe)) { // check for break
+        if (DmxState == DATA)
+          frameDone(); // short frame is complete
+        _recvState = BREAK; // break condition detected.
+        _channel = 0;       // The next data byte is the start byte
+
+      } else if (DmxState == BREAK) {
+        if (DmxByte == 0) {
+#ifdef SCOPEDEBUG
+          digitalWrite(DmxTriggerPin, LOW);
+          digitalWrite(DmxTriggerPin, HIGH);
+#endif
+          _recvState = DATA;  // normal DMX start code detected
+          _channel = 1;       // start with channel # 1
+          _gotLastPacket = millis(); // remember current (relative) time in msecs.
+
+        } else {
+          // This might be a RDM command -> not implemented so wait for next BREAK !
+          _recvState = IDLE;
+          _otherStartCodes++;
+        } // if
+
+      } else if (DmxState == DATA) {
+        int ch = _channel;
+        if (DmxByte != _appData[ch]) // remember the change
+          _changeBits[(ch - 1) >> 3] |= 1 << ((ch - 1) & 7);
+        _buffer[ch] = DmxByte; // store received data into dmx data buffer.
+        _channel = ++ch;
+        if (ch > DMXSERIAL_MAX) { // all channels done.
+          _recvState = IDLE; // wait for next break
+          frameDone();
+        } // if
+      } // if
+
+#ifdef SCOPEDEBUG
+      digitalWrite(DmxISRPin, HIGH);
+#endif
+    } // rxISR()
+
+    // The last byte was sent completely (BREAK or last channel).
+    // When changing speed (for sending break and sending start code) we use TX finished interrupt
+    // which occurs shortly after the last stop bit is sent
+    // When staying at the same speed (sending data bytes) we use data register empty interrupt
+    // which occurs shortly after the start bit of the *previous* byte
+    // In DMXController mode when the buffer was sent completely the DMX sequence will resent,
+    // starting with a BREAK pattern.
+    // In DMXReceiver mode this interrupt is disabled and will not occur.
+    inline void txISR()
+    {
+#ifdef SCOPEDEBUG
+      digitalWrite(DmxISRPin, LOW);
+#endif
+      if ((_mode == DMXController) && (_channel == -1)) {
+        // this interrupt occurs after the stop bits of the last data byte
+        // start sending a BREAK and loop forever in ISR
+#ifdef SCOPEDEBUG
+        digitalWrite(DmxTxTrigPin, HIGH);
+#endif
+#if defined(OCIE0B)
+        if (! frameDue()) {
+          // too early: leave the line at MARK and check again on every TIMER0 COMPB interrupt
+          U::ucsrb(1<<U::txen);
+          _channel = -2;
+          if (! (TIMSK0 & (1<<OCIE0B))) {
+            TIFR0 = (1<<OCF0B);
+            TIMSK0 |= (1<<OCIE0B);
+          } // if
+        } else
+#endif
+        startFrame();
+
+      } else if (_channel == 0) {
+        // this interrupt occurs after the stop bits of the break byte
+        // now back to DMX speed: 250000baud
+#ifdef SCOPEDEBUG
+        digitalWrite(DmxTxTrigPin, LOW);
+#endif
+        baud(DMXPORT_PRESCALE(DMXPORT_DMXSPEED), FORMAT_8N2);
+        // take next interrupt when data register empty (early)
+        U::ucsrb((1<<U::txen) | (1<<U::udrie));
+        // write start code
+        U::udr(0);
+        _channel = 1;
+      } // if
+
+#ifdef SCOPEDEBUG
+      digitalWrite(DmxISRPin, HIGH);
+#endif
+    } // txISR()
+
+    // The data register is empty: send the next channel.
+    // This interrupt occurs after the start bit of the previous data byte.
+    inline void udreISR()
+    {
+#ifdef SCOPEDEBUG
+      digitalWrite(DmxISRPin, LOW);
+#endif
+      U::udr(_buffer[_channel++]);
+
+      if (_channel > _sendChannel) {
+        _channel = -1; // this series is done. Next time: restart with break.
+        // get interrupt after this byte is actually transmitted
+        U::ucsrb((1<<U::txen) | (1<<U::txcie));
+      } // if
+#ifdef SCOPEDEBUG
+      digitalWrite(DmxISRPin, HIGH);
+#endif
+    } // udreISR()
+
+    // Waiting between frames (_channel == -2): start the next frame when it is due.
+    // Called by _DMXSerialTimerTick() on every TIMER0 COMPB interrupt.
+    virtual bool timerTick()
+    {
+      if ((_mode != DMXController) || (_channel != -2))
+        return(false);
+      if (! frameDue())
+        return(true);
+      startFrame();
+      return(false);
+    } // timerTick()
+
+  private:
+    // formats for serial transmission
+    enum {
+      FORMAT_8N2 = (1<<U::usbs) | (0<<U::upm0) | (3<<U::ucsz0), // channel data
+      FORMAT_8E1 = (0<<U::usbs) | (2<<U::upm0) | (3<<U::ucsz0), // BREAK, 1 bit MAB
+      FORMAT_8E2 = (1<<U::usbs) | (2<<U::upm0) | (3<<U::ucsz0)  // BREAK, 2 bit MAB
+    };
+
+    // State of receiving DMX Bytes
+    enum { IDLE, BREAK, DATA };
+
+    // _swap flags
+    enum {
+      SWAP_PENDING = 0x01, // commit() called, swap at the next BREAK
+      SWAP_DONE    = 0x02, // swapped; application buffer is one frame behind
+      SWAP_HOLD    = 0x04  // application is reading; don't swap
+    };
+
+    // Initialize the USART with the given baud rate setting and format.
+    static void baud(uint16_t setting, uint8_t format)
+    {
+      U::ucsra(0); // 04.06.2012: use normal speed operation
+      U::ubrr(setting);
+      U::ucsrc(format);
+    } // baud()
+
+    // Limit count so that channels start..start+count-1 are valid.
+    static int clip(int &start, int count)
+    {
+      if (start < 1) start = 1;
+      if (start > DMXSERIAL_MAX) return(0);
+      if (count > DMXSERIAL_MAX + 1 - start) count = DMXSERIAL_MAX + 1 - start;
+      return(count);
+    } // clip()
+
+    // Make the application buffer writable again after a commit().
+    // Waits for a pending swap (at most one frame), then copies the frame
+    // now being sent so the application continues from its own latest values.
+    void syncAppData()
+    {
+      while (_swap & SWAP_PENDING)
+        ;
+      if (_swap & SWAP_DONE) {
+        memcpy(_appData, _buffer, DMXSERIAL_MAX+1);
+        _swap &= ~SWAP_DONE;
+      } // if
+    } // syncAppData()
+
+    // Set the highest used channel after a write.
+    // When it goes down, the zeros above it still have to be sent: frames keep
+    // the old length until one was started with them (see startFrame()).
+    void usedChannel(int channel)
+    {
+      uint8_t oldSREG = SREG;
+      cli();
+      if (_usedChannel > _usedHigh) _usedHigh = _usedChannel;
+      _usedChannel = channel;
+      SREG = oldSREG;
+    } // usedChannel()
+
+    // Swap the ISR and application buffers. Only called from the ISRs.
+    void swap()
+    {
+      uint8_t *tmp = _buffer;
+      _buffer  = _appData;
+      _appData = tmp;
+    } // swap()
+
+    // A frame was received completely: publish it. Only called from the receive ISR.
+    // The end of a frame is only known at the following BREAK, unless all 512 channels were sent.
+    //
+    // With double buffering the two buffers only differ up to _recvDiff. A frame shorter
+    // than that would leave older values above its end in the buffer it is received into,
+    // so they are copied from the published buffer first.
+    void frameDone()
+    {
+      int last = _channel - 1; // the last channel received
+      if (last > DMXSERIAL_MAX) last = DMXSERIAL_MAX;
+
+      if ((_appData != _buffer) && !(_swap & SWAP_HOLD)) {
+        // channels beyond a short frame keep the values the application sees now.
+        // Only the part that still differs is copied, nothing while the frame length stays the same.
+        if (_recvDiff > last)
+          memcpy(_buffer + last + 1, _appData + last + 1, _recvDiff - last);
+        _recvDiff = last;
+        swap();
+        // publish the changes of the frame the application now sees
+        for (uint8_t n = 0; n < sizeof(_changed); n++) {
+          _changed[n] |= _pending[n];
+          _pending[n] = 0;
+        } // for
+      } else if (_appData != _buffer) {
+        // The swap is held off: the bits stay pending, the next frame is
+        // compared against the same application data again.
+        if (last > _recvDiff) _recvDiff = last;
+      } // if
+      _frameCount++;
+      _frameDone = true;
+      if (_onFrame) _onFrame();
+    } // frameDone()
+
+    // Start a new frame by sending a BREAK.
+    // Called from init() and, when the previous frame is done, from the ISRs.
+    void startFrame()
+    {
+      bool current = (_appData == _buffer); // this frame has the values written so far
+      if (_swap & SWAP_PENDING) {
+        // commit() was called: the next frame goes out from the application's buffer
+        swap();
+        _swap = SWAP_DONE;
+        current = true;
+      } // if
+
+      // fix the length of this frame
+      int last = _maxChannel;
+      if (_sendMode == DMXSendUsed) {
+        last = _usedChannel;
+        if (_usedHigh > last) last = _usedHigh;
+        if (current) _usedHigh = 0; // the zeros written are sent with this frame
+      } // if
+      _sendChannel = (last < 1) ? 1 : last;
+
+      _frameStart = millis();
+      _written = false;
+
+      // get interrupt after the break byte is actually transmitted
+      U::ucsrb((1<<U::txen) | (1<<U::txcie));
+      baud(_breakSetting, _breakFormat);
+      U::udr(0);
+      _channel = 0;
+    } // startFrame()
+
+    // Check whether the next frame is due.
+    // While idle (nothing written) the longer idle interval applies, but a write ends it.
+    bool frameDue()
+    {
+      uint16_t interval = _frameInterval;
+      if (_idleInterval && !_written) interval = _idleInterval;
+      return((interval == 0) || (millis() - _frameStart >= interval));
+    } // frameDue()
+
+    int8_t   _modePin;
+    DMXMode  _mode;           // Mode of Operation
+    uint8_t  _recvState;      // Current State of receiving DMX Bytes
+    int      _channel;        // the next channel byte to be sent or received,
+                              // -1 after the last one was sent, -2 while waiting for the next frame
+
+    volatile int _maxChannel;  // the last channel used for sending
+    volatile int _usedChannel; // the highest channel with a non-zero value (DMXSendUsed)
+    int      _usedHigh;       // the highest used channel since a frame with the current values was started
+    int      _sendChannel;    // the last channel sent in the current frame
+    DMXSendMode _sendMode;
+
+    // Transmit scheduling (DMXController mode).
+    uint16_t _breakSetting;   // baud rate setting for the BREAK byte
+    uint8_t  _breakFormat;    // 1 or 2 stop bits, giving the MAB
+    uint16_t _frameInterval;  // minimum msecs from BREAK to BREAK, 0 = back to back
+    uint16_t _idleInterval;   // same while nothing was written, 0 = like _frameInterval
+    unsigned long _frameStart; // millis() at the start of the current frame
+    volatile bool _written;   // values were written since the current frame started
+    volatile unsigned long _gotLastPacket; // the last time (using the millis function) a packet was received
+
+    // Double buffering, see doubleBuffer().
+    uint8_t * volatile _buffer;
+    uint8_t * volatile _appData;
+    volatile uint8_t _swap;
+    int      _recvDiff;
+
+    // Change detection, see nextChanged().
+    uint8_t  _changed[DMXSERIAL_MAX/8];
+    uint8_t *_pending;
+    uint8_t * volatile _changeBits; // where the receive ISR sets bits
+
+    volatile unsigned int _frameCount;      // number of complete frames received
+    volatile unsigned int _otherStartCodes; // frames skipped because of a start code other than 0
+    volatile unsigned int _overruns;        // bytes lost because the receive ISR was too late
+    volatile bool _frameDone;               // set at the end of each frame, cleared by frameComplete()
+    void (*_onFrame)(void);                 // called from the ISR at the end of each frame
+
+    // Array of DMX values (raw).
+    // Entry 0 will never be used for DMX data but will store the startbyte (0 for DMX mode).
+    uint8_t  _data[DMXSERIAL_MAX+1];
+}; // class DMXPort
+
+
+// The TIMER0 COMPB handler, see above.
+#if defined(DMX_TIMER0_COMPB) && defined(TIMER0_COMPB_vect)
+ISR(TIMER0_COMPB_vect)
+{
+  _DMXSerialTimerTick();
+}
+// tells refreshRate() that the handler is there
+bool _DMXSerialTimerHandler()
+{
+  return(true);
+}
+#endif
+
+#endif
@@ -9,55 +9,57 @@
 // 25.07.2011 creation of the DMXSerial library.
 // 01.12.2011 include file changed to work with the Arduino 1.0 environment
 // 10.05.2012 added method noDataSince to check how long no packet was received
+// 19.10.2026 double buffering with commit(), writeRange() and readRange()
+// 19.10.2026 change detection for DMXReceiver mode: nextChanged(), frameComplete(), attachOnFrame()
+// 19.10.2026 transmit scheduling for DMXController mode: refreshRate(), breakTiming(), sendMode()
+// 19.10.2026 receiver statistics otherStartCodes() and overrunErrors()
+// 19.10.2026 DMXSerialClass is a DMXPort (see DMXPort.h) on the default USART;
+//            the DMXSerial object and its interrupt routines are compiled into the sketch
 // - - - - -
 
 #ifndef DmxSerial_h
 #define DmxSerial_h
 
-#include <avr/io.h>
+#include "DMXPort.h"
 
 // ----- Constants -----
 
-#define DMXSERIAL_MAX 512 // max. number of supported DMX data channels
-
 #define DmxModePin 2     // Arduino pin 2 for controlling the data direction
-#define DmxModeOut HIGH  // set the level to HIGH for outgoing data direction
-#define DmxModeIn  LOW   // set the level to LOW  for incomming data direction
 
-// ----- Enumerations -----
+// The library works unchanged with the Arduino 2009, UNO, MGEA 2560 and Leonardo boards.
+// The Arduino MGEA 2560 boards use the serial port 0 on pins 0 an 1.
+// The Arduino Leonardo will use serial port 1, also on pins 0 an 1. (on the 32u4 boards the first USART is USART1)
+// This is consistent to the Layout of the Arduino DMX Shield http://www.mathertel.de/Arduino/DMXShield.aspx.
+
+// For using the serial port 1 on a Arduino MEGA 2560 board, enable the following DMX_USE_PORT1 definition.
+// #define DMX_USE_PORT1
 
-// Mode of Operation
-typedef enum { 
-  DMXNone, // unspecified
-  DMXController, // always sending
-  DMXReceiver    // always listening
-} DMXMode;
+#if defined(DMX_USE_PORT1) || !(defined(UCSR0A) || defined(UCSRA))
+#define DMXSERIAL_USART 1
+#else
+#define DMXSERIAL_USART 0
+#endif
 
 // ----- Library Class -----
 
-class DMXSerialClass
+// The DMXSerial interface: init(), read(), write() and the rest of DMXPort (see DMXPort.h)
+// on the USART above, with the data direction on DmxModePin.
+class DMXSerialClass : public DMXPort<DMXSERIAL_USART>
 {
   public:
-    // Initialize for specific mode.
-    void    init       (int mode);
-
-    // Set the maximum used channel for DMXController mode.
-    void    maxChannel (int channel);
-
-    // Read the last known value of a channel.
-    uint8_t read       (int channel);
-
-    // Write a new value of a channel.
-    void    write      (int channel, uint8_t value);
-
-    // Calculate how long no data backet was received
-    unsigned long noDataSince();
-
-    // Terminate operation.
-    void    term       (void);
+    DMXSerialClass() : DMXPort<DMXSERIAL_USART>(DmxModePin) { }
 };
 
 // Use the DMXSerial library through the DMXSerial object.
 extern DMXSerialClass DMXSerial;
 
+// The DMXSerial object and the interrupt routines of its USART are compiled into the
+// source file that includes DMXSerial.h, so a sketch that only uses DMXPort objects doesn't
+// claim USART0 and its RAM. In a sketch or library with more than one source file using
+// DMXSerial, define DMXSERIAL_EXTERN before including DMXSerial.h in all but one of them.
+#if !defined(DMXSERIAL_EXTERN)
+DMXSerialClass DMXSerial;
+DMXPORT_ISR(DMXSERIAL_USART, DMXSerial)
+#endif
+
 #endif
@@ -0,0 +1,44 @@
+// - - - - -
+// DmxSerial - A hardware supported interface to DMX.
+// DmxMultiUniverse.ino: Sample DMX application for an Arduino MEGA 2560
+// using three more USARTs: one universe is received on USART1
+// and forwarded to two universes sent on USART2 and USART3,
+// the second one with the channels in reverse order.
+//
+// Copyright (c) 2011 by Matthias Hertel, http://www.mathertel.de
+// This work is licensed under a BSD style license. See http://www.mathertel.de/License.aspx
+//
+// Documentation and samples are available at http://www.mathertel.de/Arduino
+// 19.10.2026 creation of the example.
+// - - - - -
+
+#include <DMXPort.h>
+
+// Each port needs its own line driver with its own data direction pin.
+DMXPort<1> dmxIn(22);
+DMXPort<2> dmxOutA(23);
+DMXPort<3> dmxOutB(24);
+
+DMXPORT_ISR(1, dmxIn)
+DMXPORT_ISR(2, dmxOutA)
+DMXPORT_ISR(3, dmxOutB)
+
+const int Channels = 64;
+uint8_t values[Channels];
+
+void setup() {
+  dmxIn.init(DMXReceiver);
+  dmxOutA.init(DMXController);
+  dmxOutB.init(DMXController);
+  dmxOutA.maxChannel(Channels);
+  dmxOutB.maxChannel(Channels);
+}
+
+void loop() {
+  if (dmxIn.noDataSince() < 1000) {
+    dmxIn.readRange(1, values, Channels);
+    dmxOutA.writeRange(1, values, Channels);
+    for (int n = 0; n < Channels; n++)
+      dmxOutB.write(Channels - n, values[n]);
+  } // if
+} // loop()
@@ -0,0 +1,32 @@
+// Host build shim for the DMXSerial line simulator (see dmxsim.cpp).
+// Only what DMXSerial.cpp uses is declared here.
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+#define LOW    0
+#define HIGH   1
+#define INPUT  0
+#define OUTPUT 1
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+// provided by the simulator
+unsigned long millis(void);
+unsigned long micros(void);
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+
+#endif
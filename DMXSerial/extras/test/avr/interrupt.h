@@ -0,0 +1,12 @@
+// Host build shim for the DMXSerial line simulator (see dmxsim.cpp).
+// The simulator calls the "interrupt routines" itself, between calls into
+// the library, so interrupts never need to be masked.
+
+#ifndef _AVR_INTERRUPT_H_
+#define _AVR_INTERRUPT_H_
+
+#define ISR(vector) extern "C" void vector(void)
+#define cli()
+#define sei()
+
+#endif
@@ -0,0 +1,55 @@
+// Host build shim for the DMXSerial line simulator (see dmxsim.cpp).
+// The ATmega328P registers used by DMXSerial, backed by the simulated UART.
+
+#ifndef _AVR_IO_H_
+#define _AVR_IO_H_
+
+#include <stdint.h>
+
+#define _BV(bit) (1 << (bit))
+
+// USART data register: reads return the byte being received,
+// writes hand a byte to the simulated transmitter.
+struct SimUDR {
+  operator uint8_t() const;
+  SimUDR &operator=(uint8_t data);
+};
+
+extern SimUDR UDR0;
+extern volatile uint8_t UCSR0A, UCSR0B, UCSR0C, UBRR0H, UBRR0L;
+#define UCSR0A UCSR0A // DMXPort.h looks for the USARTs with #if defined
+extern volatile uint8_t TIMSK0, TIFR0, SREG;
+
+// UCSR0A
+#define RXC0   7
+#define TXC0   6
+#define UDRE0  5
+#define FE0    4
+#define DOR0   3
+#define UPE0   2
+#define U2X0   1
+
+// UCSR0B
+#define RXCIE0 7
+#define TXCIE0 6
+#define UDRIE0 5
+#define RXEN0  4
+#define TXEN0  3
+
+// UCSR0C
+#define UPM01  5
+#define UPM00  4
+#define USBS0  3
+#define UCSZ01 2
+#define UCSZ00 1
+
+// TIMSK0, TIFR0
+#define OCIE0B 2
+#define OCF0B  2
+
+#define USART_RX_vect     sim_USART_RX_vect
+#define USART_TX_vect     sim_USART_TX_vect
+#define USART_UDRE_vect   sim_USART_UDRE_vect
+#define TIMER0_COMPB_vect sim_TIMER0_COMPB_vect
+
+#endif
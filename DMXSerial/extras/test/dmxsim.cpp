@@ -0,0 +1,656 @@
+// - - - - -
+// DMXSerial - host-side DMX512 line simulator and regression test.
+//
+// Builds DMXSerial.cpp for the host against a simulated ATmega328P USART
+// (avr/io.h in this directory) and drives its interrupt routines directly:
+// - receive: real DMX byte streams (BREAK, start code, channels) go through the
+//   RX ISR, including short, truncated and overlong frames, non-zero start codes,
+//   data overruns and framing errors in the middle of a frame.
+// - transmit: a UART model with a data register and a shift register clocks out
+//   whatever the TX/UDRE ISRs write, with the baud rate and format in effect for
+//   each byte. The resulting line is decoded into frames again and checked for
+//   BREAK/MAB timing, start code, length and channel values.
+// It reports frames per second on both sides, host time per byte spent in the
+// ISRs (a relative figure for comparing ISR changes, not AVR cycles) and the
+// number of integrity errors. The exit status is nonzero if any check fails.
+//
+// Build and run from this directory:
+//   g++ -O2 -I. -I../.. -o dmxsim dmxsim.cpp ../../DMXSerial.cpp && ./dmxsim
+// - - - - -
+
+#define DMX_TIMER0_COMPB // compile in the refreshRate() handler
+
+#include "Arduino.h"
+#include "DMXSerial.h"
+
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+
+// the library's interrupt routines
+extern "C" void USART_RX_vect(void);
+extern "C" void USART_TX_vect(void);
+extern "C" void USART_UDRE_vect(void);
+
+// ----- simulated hardware -----
+
+SimUDR UDR0;
+volatile uint8_t UCSR0A, UCSR0B, UCSR0C, UBRR0H, UBRR0L;
+volatile uint8_t TIMSK0, TIFR0, SREG;
+
+// Time from the TX complete condition to the ISR's first register write,
+// about 64 cycles at 16 MHz. It adds to the MARK after BREAK, as on the device.
+#define TXC_LATENCY_US 4.0
+
+#define TIMER0_TICK_US 1024.0 // TIMER0 overflow (and COMPB match) period for millis()
+
+static double  now;       // simulated time in usec
+static uint8_t rxData;    // byte returned by the next UDR0 read
+
+// one byte on the transmit line
+struct TxByte {
+  double   start, end;
+  uint8_t  data;
+  uint32_t baud;
+  uint8_t  format;   // UCSR0C at the start of the byte
+};
+
+static std::vector<TxByte> txLine;
+static bool    shiftBusy, udrFull, txc, tickDue;
+static uint8_t udrData;
+static double  shiftEnd, nextTick;
+static int     txLost;   // bytes written to a full data register
+
+unsigned long millis(void) { return((unsigned long)(now / 1000)); }
+unsigned long micros(void) { return((unsigned long)now); }
+void pinMode(uint8_t pin, uint8_t mode) { }
+void digitalWrite(uint8_t pin, uint8_t val) { }
+
+static uint32_t uartBaud()
+{
+  return(F_CPU / 16 / (((UBRR0H << 8) | UBRR0L) + 1));
+}
+
+static int frameBits(uint8_t format)
+{
+  return(1 + 8 + ((format & _BV(UPM01)) ? 1 : 0) + ((format & _BV(USBS0)) ? 2 : 1));
+}
+
+static void startShift(uint8_t data)
+{
+  TxByte b;
+  b.start  = now;
+  b.baud   = uartBaud();
+  b.format = UCSR0C;
+  b.end    = now + frameBits(b.format) * 1e6 / b.baud;
+  b.data   = data;
+  txLine.push_back(b);
+  shiftBusy = true;
+  shiftEnd  = b.end;
+}
+
+SimUDR::operator uint8_t() const
+{
+  return(rxData);
+}
+
+SimUDR &SimUDR::operator=(uint8_t data)
+{
+  if (!(UCSR0B & _BV(TXEN0))) return(*this); // transmitter off
+  if (!shiftBusy) {
+    startShift(data);
+  } else if (udrFull) {
+    txLost++;
+  } else {
+    udrData = data;
+    udrFull = true;
+  } // if
+  return(*this);
+}
+
+static double isrNanos;     // host time spent in the ISRs
+static unsigned long isrBytes;
+
+static void timed(void (*isr)(void))
+{
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+  isr();
+  isrNanos += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+}
+
+// Run the transmitter and the TIMER0 tick until the given time.
+static void runTx(double until)
+{
+  for (;;) {
+    if ((UCSR0B & _BV(TXEN0)) && (UCSR0B & _BV(UDRIE0)) && !udrFull) {
+      timed(USART_UDRE_vect);
+      isrBytes++;
+      continue;
+    }
+    if ((UCSR0B & _BV(TXCIE0)) && txc) {
+      txc = false;
+      now += TXC_LATENCY_US;
+      timed(USART_TX_vect);
+      continue;
+    }
+    if ((TIMSK0 & _BV(OCIE0B)) && tickDue) {
+      tickDue = false;
+      TIMER0_COMPB_vect();
+      continue;
+    }
+
+    double next = nextTick;
+    if (shiftBusy && (shiftEnd < next)) next = shiftEnd;
+    if (next > until) {
+      now = until;
+      return;
+    }
+    now = next;
+    if (shiftBusy && (shiftEnd <= now)) {
+      shiftBusy = false;
+      if (udrFull) {
+        udrFull = false;
+        startShift(udrData);
+      } else {
+        txc = true;
+      } // if
+    } // if
+    if (nextTick <= now) {
+      // the library clears OCF0B before enabling the interrupt
+      if (TIMSK0 & _BV(OCIE0B)) tickDue = true;
+      nextTick += TIMER0_TICK_US;
+    } // if
+  } // for
+}
+
+// Stop the library and bring the simulated hardware back to reset state.
+static void simReset()
+{
+  DMXSerial.doubleBuffer(false);
+  DMXSerial.refreshRate(0);
+  DMXSerial.term();
+  shiftBusy = udrFull = txc = tickDue = false;
+  txLine.clear();
+  txLost = 0;
+  UCSR0A = UCSR0B = UCSR0C = 0;
+  nextTick = now + TIMER0_TICK_US;
+}
+
+// ----- checks -----
+
+static int failures;
+static int integrityErrors;
+
+#define CHECK(cond, ...) do { if (!(cond)) { \
+  failures++; printf("    FAIL (line %d): ", __LINE__); printf(__VA_ARGS__); printf("\n"); \
+} } while (0)
+
+static uint8_t pattern(int frame, int channel)
+{
+  return((uint8_t)(frame * 7 + channel * 13 + 1));
+}
+
+// ----- transmit line decoder -----
+
+struct Frame {
+  double  start, breakUs, mabUs;
+  int     startCode;
+  std::vector<uint8_t> data;
+};
+
+// Split the transmit line into frames at each BREAK. Only frames followed by
+// another BREAK are returned, so their length is known. Bytes that can't be
+// part of a valid frame count as integrity errors.
+static std::vector<Frame> decodeTx()
+{
+  std::vector<Frame> frames;
+  Frame cur;
+  bool  open = false;
+
+  for (size_t i = 0; i < txLine.size(); i++) {
+    const TxByte &b = txLine[i];
+    if (b.baud != 250000) {
+      // BREAK: a 0 byte at a lower rate, low for start + data (+ parity) bits
+      if (b.data != 0) integrityErrors++;
+      if (open) frames.push_back(cur);
+      double bitUs = 1e6 / b.baud;
+      cur = Frame();
+      cur.start     = b.start;
+      cur.breakUs   = (1 + 8 + ((b.format & _BV(UPM01)) ? 1 : 0)) * bitUs;
+      cur.mabUs     = (i + 1 < txLine.size()) ? txLine[i + 1].start - b.start - cur.breakUs : 0;
+      cur.startCode = -1;
+      open = true;
+    } else if (!open || (frameBits(b.format) != 11)) {
+      integrityErrors++; // data before the first BREAK, or not 8N2
+    } else if (cur.startCode < 0) {
+      cur.startCode = b.data;
+    } else {
+      cur.data.push_back(b.data);
+    } // if
+  } // for
+  integrityErrors += txLost;
+  return(frames);
+}
+
+static double framesPerSecond(const std::vector<Frame> &frames)
+{
+  if (frames.size() < 2) return(0);
+  return((frames.size() - 1) * 1e6 / (frames.back().start - frames.front().start));
+}
+
+// Check BREAK/MAB timing and start code of every frame.
+static void checkFraming(const std::vector<Frame> &frames, double minBreak)
+{
+  for (size_t f = 0; f < frames.size(); f++) {
+    if ((frames[f].breakUs < minBreak) || (frames[f].mabUs < 12) || (frames[f].startCode != 0)) {
+      integrityErrors++;
+      CHECK(false, "frame %u: break %.0f us, MAB %.0f us, start code %d",
+        (unsigned)f, frames[f].breakUs, frames[f].mabUs, frames[f].startCode);
+      return;
+    } // if
+  } // for
+}
+
+// ----- receive line generator -----
+
+static unsigned long rxBytes;
+
+// One byte on the receive line: 11 bits at 250 kbaud.
+static void rxByte(uint8_t data, uint8_t flags = 0)
+{
+  now += 44;
+  rxData = data;
+  UCSR0A = flags;
+  USART_RX_vect();
+  rxBytes++;
+}
+
+// BREAK (100 usec) and MAB (12 usec). The USART reports it as a 0 byte
+// with a framing error once the missing stop bit is due.
+static void rxBreak()
+{
+  now += 100 + 12 - 44;
+  rxByte(0, _BV(FE0));
+}
+
+static void rxFrame(uint8_t startCode, const uint8_t *values, int count)
+{
+  rxBreak();
+  rxByte(startCode);
+  for (int n = 0; n < count; n++)
+    rxByte(values[n]);
+}
+
+static bool rxMatches(int first, int last, int frame)
+{
+  for (int ch = first; ch <= last; ch++)
+    if (DMXSerial.read(ch) != pattern(frame, ch)) return(false);
+  return(true);
+}
+
+static void fill(uint8_t *values, int count, int frame)
+{
+  for (int n = 0; n < count; n++)
+    values[n] = pattern(frame, n + 1);
+}
+
+// ----- scenarios -----
+
+static void testReceive()
+{
+  uint8_t values[DMXSERIAL_MAX + 8];
+  printf("receive\n");
+
+  simReset();
+  DMXSerial.init(DMXReceiver);
+
+  // full frames complete after channel 512, without waiting for the next BREAK
+  for (int f = 1; f <= 3; f++) {
+    fill(values, DMXSERIAL_MAX, f);
+    rxFrame(0, values, DMXSERIAL_MAX);
+    CHECK(DMXSerial.frameComplete(), "512 channel frame %d not complete", f);
+    CHECK(rxMatches(1, DMXSERIAL_MAX, f), "512 channel frame %d values", f);
+  } // for
+  CHECK(DMXSerial.frameCount() == 3, "frameCount %u, expected 3", DMXSerial.frameCount());
+
+  // short frames end at the next BREAK
+  fill(values, 24, 10);
+  rxFrame(0, values, 24);
+  CHECK(!DMXSerial.frameComplete(), "short frame complete before the next BREAK");
+  rxBreak();
+  CHECK(DMXSerial.frameComplete(), "short frame not complete at the next BREAK");
+  CHECK(rxMatches(1, 24, 10), "short frame values");
+  CHECK(rxMatches(25, DMXSERIAL_MAX, 3), "channels beyond a short frame changed");
+
+  // a non-zero start code (e.g. RDM) is skipped and counted
+  fill(values, 24, 11);
+  rxByte(0xCC);
+  for (int n = 0; n < 24; n++) rxByte(values[n]);
+  rxBreak();
+  CHECK(DMXSerial.otherStartCodes() == 1, "otherStartCodes %u, expected 1", DMXSerial.otherStartCodes());
+  CHECK(rxMatches(1, 24, 10), "RDM packet changed channel values");
+  CHECK(DMXSerial.frameCount() == 4, "RDM packet counted as a frame");
+
+  // truncated frame: the BREAK ends it early, later channels keep their values
+  fill(values, 24, 12);
+  rxByte(0);
+  for (int n = 0; n < 10; n++) rxByte(values[n]);
+  rxBreak();
+  CHECK(DMXSerial.frameCount() == 5, "truncated frame not counted");
+  CHECK(rxMatches(1, 10, 12) && rxMatches(11, 24, 10), "truncated frame values");
+
+  // two BREAKs in a row make no frame
+  rxBreak();
+  CHECK(DMXSerial.frameCount() == 5, "empty BREAK counted as a frame");
+
+  // overlong frame: bytes after channel 512 are ignored until the next BREAK
+  fill(values, DMXSERIAL_MAX + 8, 13);
+  rxByte(0);
+  for (int n = 0; n < DMXSERIAL_MAX + 8; n++) rxByte(values[n]);
+  CHECK(DMXSerial.frameCount() == 6, "overlong frame counted %u times", DMXSerial.frameCount() - 5);
+  CHECK(rxMatches(1, DMXSERIAL_MAX, 13), "overlong frame values");
+
+  // data overrun is counted, the byte that was read is still stored
+  fill(values, 24, 14);
+  rxBreak();
+  rxByte(0);
+  for (int n = 0; n < 24; n++) rxByte(values[n], (n == 5) ? _BV(DOR0) : 0);
+  CHECK(DMXSerial.overrunErrors() == 1, "overrunErrors %u, expected 1", DMXSerial.overrunErrors());
+
+  // a framing error inside a frame is taken as a BREAK: the frame ends there and
+  // the next byte is read as a start code
+  fill(values, 24, 15);
+  rxBreak();
+  rxByte(0);
+  for (int n = 0; n < 8; n++) rxByte(values[n]);
+  rxByte(0x55, _BV(FE0));
+  rxByte(0x55);
+  for (int n = 10; n < 24; n++) rxByte(values[n]);
+  rxBreak();
+  CHECK(DMXSerial.otherStartCodes() == 2, "byte after a framing error not taken as a start code");
+  CHECK(rxMatches(1, 8, 15) && rxMatches(9, 24, 14), "values around a framing error");
+
+  // change detection reports exactly the channels that changed
+  fill(values, 24, 15);
+  rxByte(0);
+  for (int n = 0; n < 24; n++) rxByte(values[n]);
+  rxBreak();
+  while (DMXSerial.nextChanged(0)) ;
+  values[2] ^= 0x40;
+  values[19] ^= 0x40;
+  rxByte(0);
+  for (int n = 0; n < 24; n++) rxByte(values[n]);
+  rxBreak();
+  int c1 = DMXSerial.nextChanged(0), c2 = DMXSerial.nextChanged(c1), c3 = DMXSerial.nextChanged(c2);
+  CHECK((c1 == 3) && (c2 == 20) && (c3 == 0), "changed channels %d %d %d, expected 3 20 0", c1, c2, c3);
+
+  // throughput: back to back 512 channel frames
+  unsigned int count0 = DMXSerial.frameCount();
+  unsigned long bytes0 = rxBytes;
+  double t0 = now;
+  std::chrono::steady_clock::time_point h0 = std::chrono::steady_clock::now();
+  const int frames = 2000;
+  for (int f = 0; f < frames; f++) {
+    fill(values, DMXSERIAL_MAX, f);
+    rxFrame(0, values, DMXSERIAL_MAX);
+  } // for
+  double hostNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - h0).count();
+  unsigned int received = DMXSerial.frameCount() - count0;
+  CHECK(received == frames, "%u of %d frames received", received, frames);
+  CHECK(rxMatches(1, DMXSERIAL_MAX, frames - 1), "values after %d frames", frames);
+  integrityErrors += frames - received;
+  printf("  512 channels: %.1f frames/s on the line, %.1f received, %.1f ns/byte host time (incl. line model)\n",
+    frames * 1e6 / (now - t0), received * 1e6 / (now - t0), hostNs / (rxBytes - bytes0));
+}
+
+
+static void testReceiveDoubleBuffer()
+{
+  uint8_t values[DMXSERIAL_MAX];
+  printf("receive, double buffered\n");
+
+  simReset();
+  DMXSerial.init(DMXReceiver);
+  CHECK(DMXSerial.doubleBuffer(true), "doubleBuffer(true) failed");
+
+  fill(values, 24, 1);
+  rxFrame(0, values, 24);
+  rxBreak();
+  CHECK(rxMatches(1, 24, 1), "first frame values");
+  while (DMXSerial.nextChanged(0)) ;
+
+  // half a frame with new values: nothing may show yet, neither values nor change bits
+  fill(values, 24, 2);
+  rxByte(0);
+  for (int n = 0; n < 12; n++) rxByte(values[n]);
+  CHECK(rxMatches(1, 24, 1), "values of an incomplete frame visible");
+  CHECK(DMXSerial.nextChanged(0) == 0, "change reported before the frame was published");
+
+  // complete it: values and change bits appear together
+  for (int n = 12; n < 24; n++) rxByte(values[n]);
+  rxBreak();
+  CHECK(rxMatches(1, 24, 2), "values after the swap");
+  int changed = 0;
+  for (int ch = DMXSerial.nextChanged(0); ch; ch = DMXSerial.nextChanged(ch)) changed++;
+  CHECK(changed == 24, "%d changed channels after the swap, expected 24", changed);
+
+  uint8_t range[24];
+  CHECK(DMXSerial.readRange(1, range, 24) == 24, "readRange count");
+  CHECK(memcmp(range, values, 24) == 0, "readRange values");
+
+  // shorter frames after longer ones: the channels above their end keep the last
+  // received values in both buffers, without change bits
+  fill(values, DMXSERIAL_MAX, 3);
+  rxFrame(0, values, DMXSERIAL_MAX);
+  while (DMXSerial.nextChanged(0)) ;
+  for (int f = 4; f <= 7; f++) {
+    int len = (f == 6) ? 100 : 24;
+    fill(values, len, f);
+    rxFrame(0, values, len);
+    rxBreak();
+    CHECK(rxMatches(1, len, f), "short frame %d values", f);
+    if (f == 7)
+      CHECK(rxMatches(25, 100, 6), "channels of frame 6 beyond short frame 7");
+    CHECK(rxMatches((f == 7) ? 101 : len + 1, DMXSERIAL_MAX, 3), "channels beyond short frame %d", f);
+    int ch = DMXSerial.nextChanged(len);
+    CHECK(ch == 0, "channel %d beyond short frame %d reported as changed", ch, f);
+    while (DMXSerial.nextChanged(0)) ;
+  } // for
+}
+
+
+static void testTransmit()
+{
+  printf("transmit\n");
+
+  // back to back frames with all 512 channels
+  simReset();
+  DMXSerial.maxChannel(DMXSERIAL_MAX);
+  DMXSerial.sendMode(DMXSendMax);
+  DMXSerial.init(DMXController);
+  for (int ch = 1; ch <= DMXSERIAL_MAX; ch++) DMXSerial.write(ch, pattern(1, ch));
+  isrNanos = 0;
+  isrBytes = 0;
+  runTx(now + 1e6);
+  std::vector<Frame> frames = decodeTx();
+  checkFraming(frames, 92);
+  int bad = 0;
+  for (size_t f = 0; f < frames.size(); f++) {
+    bool ok = (frames[f].data.size() == DMXSERIAL_MAX);
+    for (size_t n = 0; ok && (n < frames[f].data.size()); n++)
+      ok = (frames[f].data[n] == pattern(1, n + 1));
+    if (!ok) bad++;
+  } // for
+  integrityErrors += bad;
+  CHECK(bad == 0, "%d of %u frames with wrong length or values", bad, (unsigned)frames.size());
+  double fps = framesPerSecond(frames);
+  CHECK((fps > 43) && (fps < 45), "%.1f frames/s, expected about 44", fps);
+  printf("  512 channels back to back: %.1f frames/s, BREAK %.0f us, MAB %.0f us, %.1f ns/byte host time in the ISRs\n",
+    fps, frames.size() ? frames[0].breakUs : 0, frames.size() ? frames[0].mabUs : 0, isrNanos / isrBytes);
+
+  // DMXSendUsed: frames stop at the highest non-zero channel
+  simReset();
+  DMXSerial.maxChannel(DMXSERIAL_MAX);
+  DMXSerial.sendMode(DMXSendUsed);
+  DMXSerial.init(DMXController);
+  for (int ch = 1; ch <= 24; ch++) DMXSerial.write(ch, pattern(2, ch));
+  runTx(now + 1e6);
+  frames = decodeTx();
+  checkFraming(frames, 92);
+  bad = 0;
+  for (size_t f = 1; f < frames.size(); f++) // the first one started before the writes
+    if (frames[f].data.size() != 24) bad++;
+  integrityErrors += bad;
+  CHECK(bad == 0, "%d frames not 24 channels long with DMXSendUsed", bad);
+  printf("  24 used channels: %.1f frames/s\n", framesPerSecond(frames));
+
+  // a 0 written to the top channel goes out before the frames get shorter,
+  // also when a frame is running and when the 0 waits for a commit()
+  for (int db = 0; db <= 1; db++) {
+    runTx(now + 1500);
+    size_t first = txLine.size();
+    if (db) CHECK(DMXSerial.doubleBuffer(true), "doubleBuffer(true) failed");
+    DMXSerial.write(24, 0);
+    uint8_t zeros[4] = { 0, 0, 0, 0 };
+    DMXSerial.writeRange(20, zeros, 4);
+    runTx(now + 5000);
+    if (db) DMXSerial.commit();
+    runTx(now + 5000);
+    frames = decodeTx();
+    bool sent = false, early = false;
+    for (size_t f = 0; f < frames.size(); f++) {
+      if (txLine[first].start > frames[f].start) continue;
+      size_t len = frames[f].data.size();
+      if ((len >= 24) && !frames[f].data[19] && !frames[f].data[23]) sent = true;
+      if ((len < 24) && !sent) early = true;
+      if (sent && (len != 24)) CHECK(len == 19, "%u channels after the zeros were sent, expected 19", (unsigned)len);
+    } // for
+    CHECK(sent && !early, "zeros at the top %s before the frames got shorter", db ? "(double buffered) not sent" : "not sent");
+    DMXSerial.doubleBuffer(false);
+    for (int ch = 20; ch <= 24; ch++) DMXSerial.write(ch, pattern(2, ch));
+  } // for
+
+  // breakTiming(): longer BREAK, two stop bits for the MAB
+  simReset();
+  DMXSerial.sendMode(DMXSendMax);
+  DMXSerial.breakTiming(176, 30);
+  DMXSerial.init(DMXController);
+  runTx(now + 100000);
+  frames = decodeTx();
+  checkFraming(frames, 176);
+  CHECK(frames.size() && (frames[0].mabUs >= 30), "MAB %.0f us, expected >= 30", frames.size() ? frames[0].mabUs : 0);
+  DMXSerial.breakTiming(100, 12);
+}
+
+
+static void testRefreshRate()
+{
+  printf("transmit, refreshRate()\n");
+
+  simReset();
+  DMXSerial.maxChannel(DMXSERIAL_MAX);
+  DMXSerial.sendMode(DMXSendMax);
+  CHECK(DMXSerial.refreshRate(30), "refreshRate() not available with DMX_TIMER0_COMPB");
+  DMXSerial.init(DMXController);
+  for (int t = 0; t < 200; t++) { // keep writing so the idle rate never applies
+    DMXSerial.write(1, t);
+    runTx(now + 10000);
+  } // for
+  std::vector<Frame> frames = decodeTx();
+  checkFraming(frames, 92);
+  double fps = framesPerSecond(frames);
+  CHECK((fps > 28) && (fps <= 30.5), "%.1f frames/s at refreshRate(30)", fps);
+  printf("  refreshRate(30): %.1f frames/s\n", fps);
+
+  // idle rate while nothing is written, back to the full rate on the next write
+  simReset();
+  DMXSerial.refreshRate(30, 1);
+  DMXSerial.init(DMXController);
+  runTx(now + 3500000);
+  frames = decodeTx();
+  CHECK(frames.size() >= 3, "%u frames in 3.5 s idle", (unsigned)frames.size());
+  double gap = (frames.size() >= 3) ? (frames.back().start - frames[frames.size() - 2].start) / 1000 : 0;
+  CHECK((gap > 999) && (gap < 1003), "idle frame gap %.1f ms, expected 1000", gap);
+  double last = txLine.size() ? txLine.back().end : now;
+  if (now < last + 500000) runTx(last + 500000);
+  double written = now;
+  DMXSerial.write(1, 99);
+  runTx(now + 10000);
+  frames = decodeTx();
+  double delay = -1;
+  for (size_t i = 0; i < txLine.size(); i++)
+    if ((txLine[i].baud != 250000) && (txLine[i].start >= written)) {
+      delay = (txLine[i].start - written) / 1000;
+      break;
+    } // if
+  CHECK((delay >= 0) && (delay < 1.1), "frame started %.2f ms after a write while idle", delay);
+  printf("  refreshRate(30, 1): %.0f ms between idle frames, next frame %.2f ms after a write\n", gap, delay);
+}
+
+
+// Writes a new pattern in the middle of a frame and checks whether any frame on the
+// line mixes old and new values. Returns the number of mixed frames.
+static int tornFrames(bool doubleBuffered)
+{
+  simReset();
+  DMXSerial.maxChannel(DMXSERIAL_MAX);
+  DMXSerial.sendMode(DMXSendMax);
+  DMXSerial.init(DMXController);
+  if (doubleBuffered) CHECK(DMXSerial.doubleBuffer(true), "doubleBuffer(true) failed");
+
+  uint8_t values[DMXSERIAL_MAX];
+  fill(values, DMXSERIAL_MAX, 1);
+  DMXSerial.writeRange(1, values, DMXSERIAL_MAX);
+  DMXSerial.commit();
+  runTx(now + 100000);
+
+  // new values in the middle of a frame, committed a frame later
+  runTx(now + 11000);
+  fill(values, DMXSERIAL_MAX, 2);
+  DMXSerial.writeRange(1, values, DMXSERIAL_MAX);
+  runTx(now + 30000);
+  DMXSerial.commit();
+  runTx(now + 100000);
+
+  std::vector<Frame> frames = decodeTx();
+  int mixed = 0, old = 0, fresh = 0;
+  for (size_t f = 0; f < frames.size(); f++) {
+    int a = 0, b = 0;
+    for (size_t n = 0; n < frames[f].data.size(); n++) {
+      if (frames[f].data[n] == pattern(1, n + 1)) a++;
+      if (frames[f].data[n] == pattern(2, n + 1)) b++;
+    } // for
+    if (a == DMXSERIAL_MAX) old++;
+    else if (b == DMXSERIAL_MAX) fresh++;
+    else if (a && b && (a + b == DMXSERIAL_MAX)) mixed++;
+  } // for
+  CHECK(old && fresh, "old pattern in %d frames, new in %d", old, fresh);
+  return(mixed);
+}
+
+static void testTransmitDoubleBuffer()
+{
+  printf("transmit, double buffered\n");
+  int plain = tornFrames(false);
+  int doubled = tornFrames(true);
+  // the single buffer case shows the test can see tearing at all
+  CHECK(plain > 0, "no torn frame without double buffering");
+  CHECK(doubled == 0, "%d torn frames with double buffering", doubled);
+  integrityErrors += doubled;
+  printf("  torn frames after a write mid-frame: %d single buffered, %d double buffered\n", plain, doubled);
+}
+
+
+int main()
+{
+  printf("DMXSerial line simulator\n");
+  testReceive();
+  testReceiveDoubleBuffer();
+  testTransmit();
+  testRefreshRate();
+  testTransmitDoubleBuffer();
+  simReset();
+
+  printf("%d integrity errors, %d failed checks\n", integrityErrors, failures);
+  return((failures || integrityErrors) ? 1 : 0);
+}
@@ -0,0 +1,96 @@
+// Sample RFM69 sketch using the asynchronous send queue
+// Sends a message to each of several nodes without waiting for the ACKs in loop(),
+// results are reported by the onSendDone() callback
+// **********************************************************************************
+// License
+// **********************************************************************************
+// This program is free software; you can redistribute it 
+// and/or modify it under the terms of the GNU General    
+// Public License as published by the Free Software       
+// Foundation; either version 3 of the License, or        
+// (at your option) any later version.                    
+//                                                        
+// This program is distributed in the hope that it will   
+// be useful, but WITHOUT ANY WARRANTY; without even the  
+// implied warranty of MERCHANTABILITY or FITNESS FOR A   
+// PARTICULAR PURPOSE. See the GNU General Public        
+// License for more details.                              
+//                                                        
+// Licence can be viewed at                               
+// http://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Please maintain this license information along with authorship
+// and copyright notices in any redistribution of this code
+// **********************************************************************************
+#include <RFM69.h>         //get it here: https://www.github.com/lowpowerlab/rfm69
+#include <SPI.h>           //included with Arduino IDE install (www.arduino.cc)
+
+#if !RF69_TXQUEUE_LEN
+#error "The send queue is off: set RF69_TXQUEUE_LEN to 2 or more in RFM69.h"
+#endif
+
+//*********************************************************************************************
+//************ IMPORTANT SETTINGS - YOU MUST CHANGE/CONFIGURE TO FIT YOUR HARDWARE ************
+//*********************************************************************************************
+#define NODEID        1    //unique for each node on same network
+#define NETWORKID     100  //the same on all nodes that talk to each other
+#define FIRSTNODE     2    //nodes FIRSTNODE..LASTNODE get a message every TRANSMITPERIOD
+#define LASTNODE      9
+//Match frequency to the hardware version of the radio on your Moteino (uncomment one):
+#define FREQUENCY   RF69_433MHZ
+//#define FREQUENCY   RF69_868MHZ
+//#define FREQUENCY     RF69_915MHZ
+#define ENCRYPTKEY    "sampleEncryptKey" //exactly the same 16 characters/bytes on all nodes!
+#define IS_RFM69HW_HCW  //uncomment only for RFM69HW/HCW! Leave out if you have RFM69W/CW!
+//*********************************************************************************************
+
+#define SERIAL_BAUD     115200
+#define TRANSMITPERIOD  1000
+
+RFM69 radio;
+byte nextNode = FIRSTNODE;
+unsigned long lastPeriod = 0;
+
+void sendDone(uint8_t ticket, uint8_t toAddress, bool acked)
+{
+  Serial.print('[');Serial.print(toAddress);Serial.print("] #");
+  Serial.print(ticket);
+  Serial.println(acked ? " ok!" : " nothing...");
+}
+
+void setup() {
+  Serial.begin(SERIAL_BAUD);
+  radio.initialize(FREQUENCY,NODEID,NETWORKID);
+#ifdef IS_RFM69HW_HCW
+  radio.setHighPower(); //must include this only for RFM69HW/HCW!
+#endif
+  radio.encrypt(ENCRYPTKEY);
+  radio.onSendDone(sendDone);
+}
+
+void loop() {
+  // queue one message per node per period, as long as the queue has room
+  if (nextNode > LASTNODE && millis() - lastPeriod >= TRANSMITPERIOD)
+  {
+    nextNode = FIRSTNODE;
+    lastPeriod = millis();
+  }
+  if (nextNode <= LASTNODE && radio.sendAsync(nextNode, "Hello", 5, true))
+    nextNode++;
+
+  // keep the queue moving
+  radio.sendPoll();
+
+  // incoming data; ACKs for our frames show up here too
+  if (radio.receiveDone() && !radio.ACK_RECEIVED)
+  {
+    Serial.print('[');Serial.print(radio.SENDERID, DEC);Serial.print("] ");
+    for (byte i = 0; i < radio.DATALEN; i++)
+      Serial.print((char)radio.DATA[i]);
+    Serial.println();
+    if (radio.ACKRequested())
+      radio.sendACK();
+  }
+
+  // ... sensors, serial etc. are serviced here while frames are on the air
+}
@@ -39,6 +39,14 @@ volatile int16_t RFM69::RSSI;          // most accurate RSSI during reception (c
 volatile bool RFM69::_inISR;
 RFM69* RFM69::selfPointer;
 
+// states of the frame at the head of the asynchronous send queue
+#define RF69_TX_IDLE     0 // not started yet (or to be retried)
+#define RF69_TX_CSMA     1 // waiting for a free channel
+#define RF69_TX_SENDING  2 // in the FIFO, waiting for PACKETSENT
+#define RF69_TX_WAITACK  3 // sent, waiting for the ACK
+#define RF69_TX_ACKED    4 // ACK received
+#define RF69_TX_SENT     5 // sent, no ACK requested
+
 RFM69::RFM69(uint8_t slaveSelectPin, uint8_t interruptPin, bool isRFM69HW)
 {
   _slaveSelectPin = slaveSelectPin;
@@ -47,6 +55,25 @@ RFM69::RFM69(uint8_t slaveSelectPin, uint8_t interruptPin, bool isRFM69HW)
   _promiscuousMode = false;
   _powerLevel = 31;
   _isRFM69HW = isRFM69HW;
+#if RF69_RXQUEUE
+  _rxQueue = &_rxSlot;
+  _rxSize = 1;
+  _rxHead = 0;
+  _rxCount = 0;
+  _rxOverflows = 0;
+  _rxHighWater = 0;
+  _ackPending = false;
+#endif
+  _rxLen = 0;
+  _lastCTL = 0;
+#if RF69_TXQUEUE_LEN
+  _txHead = 0;
+  _txCount = 0;
+  _txTicket = 0;
+  _txTries = 0;
+  _txState = RF69_TX_IDLE;
+  _txCallback = 0;
+#endif
 #if defined(RF69_LISTENMODE_ENABLE)
   _isHighSpeed = true;
   _haveEncryptKey = false;
@@ -230,7 +257,7 @@ void RFM69::setPowerLevel(uint8_t powerLevel)
 
 bool RFM69::canSend()
 {
-  if (_mode == RF69_MODE_RX && PAYLOADLEN == 0 && readRSSI() < CSMA_LIMIT) // if signal stronger than -100dBm is detected assume channel activity
+  if (_mode == RF69_MODE_RX && readRSSI() < CSMA_LIMIT) // if signal stronger than -100dBm is detected assume channel activity
   {
     setMode(RF69_MODE_STANDBY);
     return true;
@@ -242,7 +269,7 @@ void RFM69::send(uint8_t toAddress, const void* buffer, uint8_t bufferSize, bool
 {
   writeReg(REG_PACKETCONFIG2, (readReg(REG_PACKETCONFIG2) & 0xFB) | RF_PACKET2_RXRESTART); // avoid RX deadlocks
   uint32_t now = millis();
-  while (!canSend() && millis() - now < RF69_CSMA_LIMIT_MS) receiveDone();
+  while (!canSend() && millis() - now < RF69_CSMA_LIMIT_MS) receiveListen();
   sendFrame(toAddress, buffer, bufferSize, requestACK, false);
 }
 
@@ -272,10 +299,36 @@ bool RFM69::sendWithRetry(uint8_t toAddress, const void* buffer, uint8_t bufferS
 }
 
 // should be polled immediately after sending a packet with ACK request
+// frames queued before the ACK stay in the queue for receiveDone()/receive()
 bool RFM69::ACKReceived(uint8_t fromNodeID) {
+#if RF69_RXQUEUE
+  uint8_t count = _rxCount;
+  for (uint8_t i = 0; i < count; i++)
+  {
+    Frame &frame = _rxQueue[(_rxHead + i) % _rxSize];
+    if ((frame.ctl & RFM69_CTL_SENDACK) && (frame.senderID == fromNodeID || fromNodeID == RF69_BROADCAST_ADDR))
+    {
+      // move the ACK to the head, keeping the order of the frames before it
+      Frame ack = frame;
+      for (uint8_t j = i; j > 0; j--)
+        _rxQueue[(_rxHead + j) % _rxSize] = _rxQueue[(_rxHead + j - 1) % _rxSize];
+      _rxQueue[_rxHead] = ack;
+      return receiveDone();
+    }
+  }
+  if (_ackPending && (_ackSlot.senderID == fromNodeID || fromNodeID == RF69_BROADCAST_ADDR))
+  {
+    receiveCopy(_ackSlot);
+    _ackPending = false;
+    return true;
+  }
+  receiveListen();
+  return false;
+#else
   if (receiveDone())
     return (SENDERID == fromNodeID || fromNodeID == RF69_BROADCAST_ADDR) && ACK_RECEIVED;
   return false;
+#endif
 }
 
 // check whether an ACK was requested in the last received packet (non-broadcasted packet)
@@ -290,12 +343,22 @@ void RFM69::sendACK(const void* buffer, uint8_t bufferSize) {
   int16_t _RSSI = RSSI; // save payload received RSSI value
   writeReg(REG_PACKETCONFIG2, (readReg(REG_PACKETCONFIG2) & 0xFB) | RF_PACKET2_RXRESTART); // avoid RX deadlocks
   uint32_t now = millis();
-  while (!canSend() && millis() - now < RF69_CSMA_LIMIT_MS) receiveDone();
+  while (!canSend() && millis() - now < RF69_CSMA_LIMIT_MS) receiveListen();
   SENDERID = sender;    // TWS: Restore SenderID after it gets wiped out by receiveDone()
   sendFrame(sender, buffer, bufferSize, false, true);
   RSSI = _RSSI; // restore payload RSSI
 }
 
+#if RF69_RXQUEUE
+// the same for a frame taken with receive(): SENDERID, ACK_REQUESTED and RSSI belong to receiveDone()
+void RFM69::sendACK(const Frame& frame, const void* buffer, uint8_t bufferSize) {
+  writeReg(REG_PACKETCONFIG2, (readReg(REG_PACKETCONFIG2) & 0xFB) | RF_PACKET2_RXRESTART); // avoid RX deadlocks
+  uint32_t now = millis();
+  while (!canSend() && millis() - now < RF69_CSMA_LIMIT_MS) receiveListen();
+  sendFrame(frame.senderID, buffer, bufferSize, false, true);
+}
+#endif
+
 // internal function
 void RFM69::sendFrame(uint8_t toAddress, const void* buffer, uint8_t bufferSize, bool requestACK, bool sendACK)
 {
@@ -335,46 +398,210 @@ void RFM69::sendFrame(uint8_t toAddress, const void* buffer, uint8_t bufferSize,
 void RFM69::interruptHandler() {
   //pinMode(4, OUTPUT);
   //digitalWrite(4, 1);
+#if RF69_TXQUEUE_LEN
+  if (_mode == RF69_MODE_TX && _txState == RF69_TX_SENDING) // PACKETSENT of a queued frame
+  {
+    setMode(RF69_MODE_STANDBY);
+    _txState = _txQueue[_txHead].requestACK ? RF69_TX_WAITACK : RF69_TX_SENT;
+    _txTimer = millis();
+    receiveRestart(); // listen for the ACK
+    return;
+  }
+#endif
   if (_mode == RF69_MODE_RX && (readReg(REG_IRQFLAGS2) & RF_IRQFLAGS2_PAYLOADREADY))
   {
-    //RSSI = readRSSI();
+    int16_t rssi = readRSSI();
     setMode(RF69_MODE_STANDBY);
     select();
     SPI.transfer(REG_FIFO & 0x7F);
-    PAYLOADLEN = SPI.transfer(0);
-    PAYLOADLEN = PAYLOADLEN > 66 ? 66 : PAYLOADLEN; // precaution
-    TARGETID = SPI.transfer(0);
-    if(!(_promiscuousMode || TARGETID == _address || TARGETID == RF69_BROADCAST_ADDR) // match this node's address, or broadcast address or anything in promiscuous mode
-       || PAYLOADLEN < 3) // address situation could receive packets that are malformed and don't fit this libraries extra fields
+    uint8_t payloadLen = SPI.transfer(0);
+    payloadLen = payloadLen > 66 ? 66 : payloadLen; // precaution
+    uint8_t targetID = SPI.transfer(0);
+    if(!(_promiscuousMode || targetID == _address || targetID == RF69_BROADCAST_ADDR) // match this node's address, or broadcast address or anything in promiscuous mode
+       || payloadLen < 3) // address situation could receive packets that are malformed and don't fit this libraries extra fields
     {
-      PAYLOADLEN = 0;
       unselect();
-      receiveBegin();
+      receiveRestart();
       //digitalWrite(4, 0);
       return;
     }
+    uint8_t senderID = SPI.transfer(0);
+    uint8_t ctl = SPI.transfer(0);
+    RSSI = rssi;
+#if RF69_TXQUEUE_LEN
+    if (_txState == RF69_TX_WAITACK && (ctl & RFM69_CTL_SENDACK) &&
+        (senderID == _txQueue[_txHead].toAddress || _txQueue[_txHead].toAddress == RF69_BROADCAST_ADDR))
+      _txState = RF69_TX_ACKED;
+#endif
 
-    DATALEN = PAYLOADLEN - 3;
-    SENDERID = SPI.transfer(0);
-    uint8_t CTLbyte = SPI.transfer(0);
+#if RF69_RXQUEUE
+    // read the rest of the frame straight into the free slot; with the queue full,
+    // the frames already queued are kept, and only an ACK is taken (into _ackSlot)
+    bool queued = _rxCount < _rxSize;
+    if (!queued && !((ctl & RFM69_CTL_SENDACK) && !_ackPending))
+    {
+      _rxOverflows++;
+      unselect();
+      receiveRestart();
+      return;
+    }
+    Frame &frame = queued ? _rxQueue[(_rxHead + _rxCount) % _rxSize] : _ackSlot;
+    uint8_t* data = frame.data;
+#else
+    // no queue: the frame goes to DATA, SENDERID etc. for receiveDone()
+    uint8_t* data = (uint8_t*) DATA;
+#endif
+    _rxLen = payloadLen - 3;
+    if (_rxLen > RF69_MAX_DATA_LEN) _rxLen = RF69_MAX_DATA_LEN;
+    interruptHook(ctl);     // TWS: hook to derived class interrupt function, may read bytes and lower _rxLen
 
-    ACK_RECEIVED = CTLbyte & RFM69_CTL_SENDACK; // extract ACK-received flag
-    ACK_REQUESTED = CTLbyte & RFM69_CTL_REQACK; // extract ACK-requested flag
-    
-    interruptHook(CTLbyte);     // TWS: hook to derived class interrupt function
+    for (uint8_t i = 0; i < _rxLen; i++)
+      data[i] = SPI.transfer(0);
+    unselect();
 
-    for (uint8_t i = 0; i < DATALEN; i++)
+#if RF69_RXQUEUE
+    frame.senderID = senderID;
+    frame.targetID = targetID;
+    frame.ctl = ctl;
+    frame.rssi = rssi;
+    frame.dataLen = _rxLen;
+    if (queued)
     {
-      DATA[i] = SPI.transfer(0);
+      _rxCount++;
+      if (_rxCount > _rxHighWater) _rxHighWater = _rxCount;
     }
+    else
+      _ackPending = true;
+#else
+    SENDERID = senderID;
+    TARGETID = targetID;
+    ACK_RECEIVED = ctl & RFM69_CTL_SENDACK; // extract ACK-received flag
+    ACK_REQUESTED = ctl & RFM69_CTL_REQACK; // extract ACK-requested flag
+    _lastCTL = ctl;
+    DATALEN = _rxLen;
     if (DATALEN < RF69_MAX_DATA_LEN) DATA[DATALEN] = 0; // add null at end of string
-    unselect();
+    PAYLOADLEN = payloadLen;
+#endif
     setMode(RF69_MODE_RX);
   }
-  RSSI = readRSSI();
   //digitalWrite(4, 0);
 }
 
+#if RF69_TXQUEUE_LEN
+// queue a frame for sendPoll() to transmit; returns 0 if the queue is full, otherwise a ticket
+// that identifies the frame in the onSendDone() callback
+uint8_t RFM69::sendAsync(uint8_t toAddress, const void* buffer, uint8_t bufferSize, bool requestACK, uint8_t retries, uint8_t retryWaitTime)
+{
+  if (_txCount >= RF69_TXQUEUE_LEN) return 0;
+  if (bufferSize > RF69_MAX_DATA_LEN) bufferSize = RF69_MAX_DATA_LEN;
+
+  TxFrame &frame = _txQueue[(_txHead + _txCount) % RF69_TXQUEUE_LEN];
+  frame.toAddress = toAddress;
+  frame.size = bufferSize;
+  frame.requestACK = requestACK;
+  frame.retries = requestACK ? retries : 0;
+  frame.retryWaitTime = retryWaitTime;
+  if (++_txTicket == 0) _txTicket = 1;
+  frame.ticket = _txTicket;
+  memcpy(frame.data, buffer, bufferSize);
+  _txCount++;
+  sendPoll(); // start right away if the channel is free
+  return frame.ticket;
+}
+
+// advance the asynchronous send queue, call this often from loop()
+void RFM69::sendPoll()
+{
+  if (_txCount == 0) return;
+  TxFrame &frame = _txQueue[_txHead];
+
+  switch (_txState)
+  {
+    case RF69_TX_IDLE:
+      writeReg(REG_PACKETCONFIG2, (readReg(REG_PACKETCONFIG2) & 0xFB) | RF_PACKET2_RXRESTART); // avoid RX deadlocks
+      _txTimer = millis();
+      _txState = RF69_TX_CSMA;
+      // fall through
+    case RF69_TX_CSMA:
+      if (canSend() || millis() - _txTimer >= RF69_CSMA_LIMIT_MS)
+      {
+        _txTries++;
+        sendFrameStart(frame.toAddress, frame.data, frame.size, frame.requestACK);
+      }
+      else if (_mode != RF69_MODE_RX)
+        receiveRestart(); // canSend() needs RX mode
+      break;
+    case RF69_TX_SENDING:
+    {
+      noInterrupts();
+      bool timeout = _txState == RF69_TX_SENDING && millis() - _txTimer >= RF69_TX_LIMIT_MS; // PACKETSENT never came
+      if (timeout)
+      {
+        _txState = frame.requestACK ? RF69_TX_WAITACK : RF69_TX_SENT;
+        _txTimer = millis();
+      }
+      interrupts();
+      if (timeout)
+      {
+        setMode(RF69_MODE_STANDBY);
+        receiveRestart();
+      }
+      break;
+    }
+    case RF69_TX_WAITACK:
+      if (millis() - _txTimer >= frame.retryWaitTime)
+      {
+        if (_txTries <= frame.retries)
+          _txState = RF69_TX_IDLE; // retry on the next call
+        else
+          sendFinish(false);
+      }
+      break;
+    case RF69_TX_ACKED:
+    case RF69_TX_SENT:
+      sendFinish(true);
+      break;
+  }
+}
+
+// internal function - load the FIFO and start the transmitter, PACKETSENT ends up in interruptHandler()
+void RFM69::sendFrameStart(uint8_t toAddress, const void* buffer, uint8_t bufferSize, bool requestACK)
+{
+  setMode(RF69_MODE_STANDBY); // turn off receiver to prevent reception while filling fifo
+  while ((readReg(REG_IRQFLAGS1) & RF_IRQFLAGS1_MODEREADY) == 0x00); // wait for ModeReady
+  writeReg(REG_DIOMAPPING1, RF_DIOMAPPING1_DIO0_00); // DIO0 is "Packet Sent"
+
+  select();
+  SPI.transfer(REG_FIFO | 0x80);
+  SPI.transfer(bufferSize + 3);
+  SPI.transfer(toAddress);
+  SPI.transfer(_address);
+  SPI.transfer(requestACK ? RFM69_CTL_REQACK : 0x00);
+  for (uint8_t i = 0; i < bufferSize; i++)
+    SPI.transfer(((uint8_t*) buffer)[i]);
+  unselect();
+
+  noInterrupts();
+  _txTimer = millis();
+  _txState = RF69_TX_SENDING;
+  interrupts();
+  setMode(RF69_MODE_TX);
+}
+
+// internal function - remove the head of the queue and report the result
+void RFM69::sendFinish(bool acked)
+{
+  TxFrame &frame = _txQueue[_txHead];
+  uint8_t ticket = frame.ticket;
+  uint8_t toAddress = frame.toAddress;
+  _txHead = (_txHead + 1) % RF69_TXQUEUE_LEN;
+  _txCount--;
+  _txTries = 0;
+  _txState = RF69_TX_IDLE;
+  if (_txCallback) _txCallback(ticket, toAddress, acked); // may queue the next frame
+}
+#endif
+
 // internal function
 void RFM69::isr0() { _inISR = true; selfPointer->interruptHandler(); _inISR = false; }
 
@@ -390,31 +617,133 @@ void RFM69::receiveBegin() {
   RF69_LISTEN_BURST_REMAINING_MS = 0;
 #endif
   RSSI = 0;
+  receiveRestart();
+}
+
+// internal function - (re)enter RX mode, leaves DATA, SENDERID etc. alone
+void RFM69::receiveRestart() {
   if (readReg(REG_IRQFLAGS2) & RF_IRQFLAGS2_PAYLOADREADY)
     writeReg(REG_PACKETCONFIG2, (readReg(REG_PACKETCONFIG2) & 0xFB) | RF_PACKET2_RXRESTART); // avoid RX deadlocks
   writeReg(REG_DIOMAPPING1, RF_DIOMAPPING1_DIO0_01); // set DIO0 to "PAYLOADREADY" in receive mode
   setMode(RF69_MODE_RX);
 }
 
+// internal function - make sure the receiver runs, unless a queued frame is being transmitted
+void RFM69::receiveListen() {
+  if (_mode != RF69_MODE_RX && _mode != RF69_MODE_TX)
+    receiveRestart();
+}
+
+#if RF69_RXQUEUE
+// internal function - free the slot at the head of the receive queue
+// (the interrupt handler adds at _rxHead + _rxCount, so both change together)
+void RFM69::receiveRelease() {
+  noInterrupts();
+  _rxHead = (_rxHead + 1) % _rxSize;
+  _rxCount--;
+  interrupts();
+}
+
+// internal function - copy a received frame to DATA, DATALEN, SENDERID, TARGETID, ACK_RECEIVED, ACK_REQUESTED and RSSI
+void RFM69::receiveCopy(const Frame& frame) {
+  SENDERID = frame.senderID;
+  TARGETID = frame.targetID;
+  PAYLOADLEN = frame.dataLen + 3;
+  DATALEN = frame.dataLen;
+  ACK_RECEIVED = frame.ctl & RFM69_CTL_SENDACK; // extract ACK-received flag
+  ACK_REQUESTED = frame.ctl & RFM69_CTL_REQACK; // extract ACK-requested flag
+  RSSI = frame.rssi;
+  _lastCTL = frame.ctl;
+  memcpy((uint8_t*) DATA, frame.data, DATALEN);
+  if (DATALEN < RF69_MAX_DATA_LEN) DATA[DATALEN] = 0; // add null at end of string
+}
+
+#endif
+
 // checks if a packet was received and/or puts transceiver in receive (ie RX or listen) mode
+// the received frame is in DATA, DATALEN, SENDERID, TARGETID, ACK_RECEIVED, ACK_REQUESTED and RSSI
+// (with RF69_RXQUEUE the oldest queued frame is copied there)
 bool RFM69::receiveDone() {
-//ATOMIC_BLOCK(ATOMIC_FORCEON)
-//{
+#if RF69_RXQUEUE
+  if (_rxCount > 0)
+  {
+    receiveCopy(_rxQueue[_rxHead]);
+    receiveRelease();
+    return true;
+  }
+  if (_ackPending) // an ACK that came in while the queue was full, after all queued frames
+  {
+    receiveCopy(_ackSlot);
+    _ackPending = false;
+    return true;
+  }
+  if (_mode == RF69_MODE_RX || _mode == RF69_MODE_TX) // already in RX no payload yet, or sending a queued frame
+    return false;
+  receiveBegin();
+  return false;
+#else
   noInterrupts(); // re-enabled in unselect() via setMode() or via receiveBegin()
   if (_mode == RF69_MODE_RX && PAYLOADLEN > 0)
   {
     setMode(RF69_MODE_STANDBY); // enables interrupts
     return true;
   }
-  else if (_mode == RF69_MODE_RX) // already in RX no payload yet
+  else if (_mode == RF69_MODE_RX || _mode == RF69_MODE_TX) // already in RX no payload yet, or sending a queued frame
   {
     interrupts(); // explicitly re-enable interrupts
     return false;
   }
   receiveBegin();
   return false;
-//}
+#endif
+}
+
+#if RF69_RXQUEUE
+// takes the oldest queued frame, unlike receiveDone() DATA, SENDERID etc. are not changed
+bool RFM69::receive(Frame& frame) {
+  if (_rxCount == 0)
+  {
+    if (_ackPending)
+    {
+      frame = _ackSlot;
+      _ackPending = false;
+      return true;
+    }
+    receiveListen();
+    return false;
+  }
+  frame = _rxQueue[_rxHead];
+  receiveRelease();
+  return true;
+}
+
+// use count frames at slots for the receive queue (slots = 0 goes back to the single built-in slot)
+// frames still queued are dropped
+void RFM69::receiveQueue(Frame* slots, uint8_t count) {
+  noInterrupts();
+  if (slots && count)
+  {
+    _rxQueue = slots;
+    _rxSize = count;
+  }
+  else
+  {
+    _rxQueue = &_rxSlot;
+    _rxSize = 1;
+  }
+  _rxHead = 0;
+  _rxCount = 0;
+  _ackPending = false;
+  interrupts();
+}
+
+void RFM69::clearReceiveStats() {
+  noInterrupts();
+  _rxOverflows = 0;
+  _rxHighWater = _rxCount;
+  interrupts();
 }
+#endif
 
 // To enable encryption: radio.encrypt("ABCDEFGHIJKLMNOP");
 // To disable encryption: radio.encrypt(null) or radio.encrypt(0)
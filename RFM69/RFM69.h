@@ -150,6 +150,21 @@
 #define RFM69_CTL_SENDACK   0x80
 #define RFM69_CTL_REQACK    0x40
 
+// frames the asynchronous send queue (sendAsync) can hold, each takes 66 bytes of RAM
+// 0 compiles without the queue; set it to 2 or more to use sendAsync()
+// (the library and the sketch must agree, so change it here)
+#ifndef RF69_TXQUEUE_LEN
+#define RF69_TXQUEUE_LEN        0
+#endif
+
+// 1 compiles the receive queue: the interrupt handler keeps received frames in Frame slots
+// until receiveDone() or receive() takes them, instead of writing them to DATA, SENDERID etc.
+// The built-in slot and a spare slot for ACKs take 134 bytes of RAM per RFM69 object
+// (the library and the sketch must agree, so change it here)
+#ifndef RF69_RXQUEUE
+#define RF69_RXQUEUE            0
+#endif
+
 //#define RF69_LISTENMODE_ENABLE  //comment this line out to compile sketches without the ListenMode (saves ~2k)
 
 #if defined(RF69_LISTENMODE_ENABLE)
@@ -160,6 +175,20 @@
 
 class RFM69 {
   public:
+    // a received frame, as queued by the interrupt handler and returned by receive() (RF69_RXQUEUE)
+    struct Frame {
+      uint8_t senderID;
+      uint8_t targetID;
+      uint8_t ctl;       // RFM69_CTL_SENDACK, RFM69_CTL_REQACK, ...
+      int16_t rssi;      // dBm, sampled at the end of the reception
+      uint8_t dataLen;
+      uint8_t data[RF69_MAX_DATA_LEN];
+
+      bool ACKReceived() const { return ctl & RFM69_CTL_SENDACK; }
+      bool ACKRequested() const { return (ctl & RFM69_CTL_REQACK) && (targetID != RF69_BROADCAST_ADDR); } // answer with sendACK(frame)
+    };
+
+    // the last frame received, or with RF69_RXQUEUE the last one returned by receiveDone() (receive() doesn't touch them)
     static volatile uint8_t DATA[RF69_MAX_DATA_LEN]; // recv/xmit buf, including header & crc bytes
     static volatile uint8_t DATALEN;
     static volatile uint8_t SENDERID;
@@ -167,7 +196,7 @@ class RFM69 {
     static volatile uint8_t PAYLOADLEN;
     static volatile uint8_t ACK_REQUESTED;
     static volatile uint8_t ACK_RECEIVED; // should be polled immediately after sending a packet with ACK request
-    static volatile int16_t RSSI; // most accurate RSSI during reception (closest to the reception)
+    static volatile int16_t RSSI; // RSSI of the last frame received (set again by receiveDone() for the frame it returns)
     static volatile uint8_t _mode; // should be protected?
 
     RFM69(uint8_t slaveSelectPin=RF69_SPI_CS, uint8_t interruptPin=RF69_IRQ_PIN, bool isRFM69HW=false);
@@ -182,9 +211,20 @@ class RFM69 {
     virtual void send(uint8_t toAddress, const void* buffer, uint8_t bufferSize, bool requestACK=false);
     virtual bool sendWithRetry(uint8_t toAddress, const void* buffer, uint8_t bufferSize, uint8_t retries=2, uint8_t retryWaitTime=40); // 40ms roundtrip req for 61byte packets
     virtual bool receiveDone();
+#if RF69_RXQUEUE
+    bool receive(Frame& frame); // take the oldest received frame, false if there is none
+    void receiveQueue(Frame* slots, uint8_t count); // use count frames at slots to queue received frames (default: 1)
+    uint8_t receiveQueued() { return _rxCount; }
+    uint16_t receiveOverflows() { return _rxOverflows; } // frames dropped because the queue was full
+    uint8_t receiveHighWater() { return _rxHighWater; }   // most frames queued at once
+    void clearReceiveStats();
+#endif
     bool ACKReceived(uint8_t fromNodeID);
     bool ACKRequested();
     virtual void sendACK(const void* buffer = "", uint8_t bufferSize=0);
+#if RF69_RXQUEUE
+    virtual void sendACK(const Frame& frame, const void* buffer = "", uint8_t bufferSize=0); // ACK a frame taken with receive()
+#endif
     uint32_t getFrequency();
     void setFrequency(uint32_t freqHz);
     void encrypt(const char* key);
@@ -211,6 +251,23 @@ class RFM69 {
     virtual void sendFrame(uint8_t toAddress, const void* buffer, uint8_t size, bool requestACK=false, bool sendACK=false);
 
     static RFM69* selfPointer;
+
+#if RF69_RXQUEUE
+    // received frames: the interrupt handler adds at _rxHead + _rxCount, receive()/receiveDone() take at _rxHead
+    Frame _rxSlot;
+    Frame* _rxQueue;
+    uint8_t _rxSize;
+    volatile uint8_t _rxHead;
+    volatile uint8_t _rxCount;
+    // an ACK that arrived while the queue was full, so sendWithRetry() doesn't miss it
+    Frame _ackSlot;
+    volatile bool _ackPending;
+    volatile uint16_t _rxOverflows;
+    uint8_t _rxHighWater;
+#endif
+    uint8_t _rxLen; // data bytes still to be read of the frame being received, for interruptHook()
+    uint8_t _lastCTL; // CTL byte of the frame last returned by receiveDone()
+
     uint8_t _slaveSelectPin;
     uint8_t _interruptPin;
     uint8_t _interruptNum;
@@ -224,12 +281,63 @@ class RFM69 {
 #endif
 
     virtual void receiveBegin();
+    void receiveRestart();
+    void receiveListen();
+#if RF69_RXQUEUE
+    void receiveRelease();
+    void receiveCopy(const Frame& frame);
+#endif
     virtual void setMode(uint8_t mode);
     virtual void setHighPowerRegs(bool onOff);
     virtual void select();
     virtual void unselect();
     inline void maybeInterrupts();
 
+#if RF69_TXQUEUE_LEN
+  //=============================================================================
+  //                     Asynchronous send queue declarations
+  //=============================================================================
+  // sendAsync() copies the frame into the queue and returns right away. sendPoll(), called
+  // from loop(), waits for a free channel, loads the FIFO and starts the transmitter; the
+  // PACKETSENT interrupt on DIO0 then switches back to RX to listen for the ACK.
+  // ACK timeouts and retries are handled in sendPoll() as well, and the result is reported
+  // through the callback set with onSendDone(). The received ACK also remains available
+  // through receiveDone() as with sendWithRetry().
+  // Don't call send()/sendWithRetry() while sendBusy() is true, they would abort the frame.
+  // RFM69_ATC: queued frames are sent without the ACK-RSSI request, so they don't adjust power.
+  public:
+    typedef void (*SendCallback)(uint8_t ticket, uint8_t toAddress, bool acked);
+
+    // returns a ticket (1..255) passed to the callback, or 0 if the queue is full
+    uint8_t sendAsync(uint8_t toAddress, const void* buffer, uint8_t bufferSize, bool requestACK=false, uint8_t retries=2, uint8_t retryWaitTime=40);
+    void sendPoll();
+    void onSendDone(SendCallback callback) { _txCallback = callback; }
+    uint8_t sendQueued() { return _txCount; } // frames in the queue, including the one being sent
+    bool sendBusy() { return _txCount != 0; }
+
+  protected:
+    struct TxFrame {
+      uint8_t toAddress;
+      uint8_t size;
+      bool requestACK;
+      uint8_t retries;
+      uint8_t retryWaitTime;
+      uint8_t ticket;
+      uint8_t data[RF69_MAX_DATA_LEN];
+    };
+    TxFrame _txQueue[RF69_TXQUEUE_LEN];
+    uint8_t _txHead;
+    uint8_t _txCount;
+    uint8_t _txTicket;
+    uint8_t _txTries;
+    volatile uint8_t _txState;
+    volatile uint32_t _txTimer;
+    SendCallback _txCallback;
+
+    void sendFrameStart(uint8_t toAddress, const void* buffer, uint8_t size, bool requestACK);
+    void sendFinish(bool acked);
+#endif
+
 #if defined(RF69_LISTENMODE_ENABLE)
   //=============================================================================
   //                     ListenMode specific declarations  
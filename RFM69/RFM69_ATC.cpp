@@ -71,12 +71,22 @@ void RFM69_ATC::sendACK(const void* buffer, uint8_t bufferSize) {
   bool sendRSSI = ACK_RSSI_REQUESTED;  
   writeReg(REG_PACKETCONFIG2, (readReg(REG_PACKETCONFIG2) & 0xFB) | RF_PACKET2_RXRESTART); // avoid RX deadlocks
   uint32_t now = millis();
-  while (!canSend() && millis() - now < RF69_CSMA_LIMIT_MS) receiveDone();
+  while (!canSend() && millis() - now < RF69_CSMA_LIMIT_MS) receiveListen();
   SENDERID = sender;    // TomWS1: Restore SenderID after it gets wiped out by receiveDone()
   sendFrame(sender, buffer, bufferSize, false, true, sendRSSI, _RSSI);   // TomWS1: Special override on sendFrame with extra params
   RSSI = _RSSI; // restore payload RSSI
 }
 
+#if RF69_RXQUEUE
+// the same for a frame taken with receive(), with the RSSI it was received at
+void RFM69_ATC::sendACK(const Frame& frame, const void* buffer, uint8_t bufferSize) {
+  writeReg(REG_PACKETCONFIG2, (readReg(REG_PACKETCONFIG2) & 0xFB) | RF_PACKET2_RXRESTART); // avoid RX deadlocks
+  uint32_t now = millis();
+  while (!canSend() && millis() - now < RF69_CSMA_LIMIT_MS) receiveListen();
+  sendFrame(frame.senderID, buffer, bufferSize, false, true, frame.ctl & RFM69_CTL_RESERVE1, frame.rssi);
+}
+#endif
+
 //=============================================================================
 // sendFrame() - the basic version is used to match the RFM69 prototype so we can extend it
 //=============================================================================
@@ -131,14 +141,14 @@ void RFM69_ATC::sendFrame(uint8_t toAddress, const void* buffer, uint8_t bufferS
 //=============================================================================
 // interruptHook() - gets called by the base class interrupt handler right after the header is fetched.
 //=============================================================================
+// _rxLen is the number of data bytes left to read; ACK_RSSI_REQUESTED is set when the frame is returned by receiveDone()
 void RFM69_ATC::interruptHook(uint8_t CTLbyte) {
-  ACK_RSSI_REQUESTED = CTLbyte & RFM69_CTL_RESERVE1; // TomWS1: extract the ACK RSSI request bit (could potentially merge with ACK_REQUESTED)
   // TomWS1: now see if this was an ACK with an ACK_RSSI response
-  if (ACK_RECEIVED && ACK_RSSI_REQUESTED) {
+  if ((CTLbyte & RFM69_CTL_SENDACK) && (CTLbyte & RFM69_CTL_RESERVE1)) {
     // the next two bytes contain the ACK_RSSI (assuming the datalength is valid)
-    if (DATALEN >= 1) {
+    if (_rxLen >= 1) {
       _ackRSSI = -1 * SPI.transfer(0); //rssi was sent as single byte positive value, get the real value by * -1
-      DATALEN -= 1;   // and compensate data length accordingly
+      _rxLen -= 1;   // and compensate data length accordingly
       // TomWS1: Now dither transmitLevel value (register update occurs later when transmitting);
       if (_targetRSSI != 0) {
         // if (_isRFM69HW) {
@@ -174,6 +184,15 @@ bool RFM69_ATC::sendWithRetry(uint8_t toAddress, const void* buffer, uint8_t buf
   return false;
 }
 
+//=============================================================================
+//  receiveDone() - extract the ACK RSSI request bit of the frame taken from the queue
+//=============================================================================
+bool RFM69_ATC::receiveDone() {
+  if (!RFM69::receiveDone()) return false;
+  ACK_RSSI_REQUESTED = _lastCTL & RFM69_CTL_RESERVE1; // TomWS1: extract the ACK RSSI request bit (could potentially merge with ACK_REQUESTED)
+  return true;
+}
+
 //=============================================================================
 //  receiveBegin() - need to clear out our flag before calling base class.
 //=============================================================================
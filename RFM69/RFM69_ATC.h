@@ -42,6 +42,10 @@ class RFM69_ATC: public RFM69 {
 
     bool initialize(uint8_t freqBand, uint8_t ID, uint8_t networkID=1);
     void sendACK(const void* buffer = "", uint8_t bufferSize=0);
+#if RF69_RXQUEUE
+    void sendACK(const Frame& frame, const void* buffer = "", uint8_t bufferSize=0);
+#endif
+    bool receiveDone();
     //void setHighPower(bool onOFF=true, uint8_t PA_ctl=0x60); //have to call it after initialize for RFM69HW
     //void setPowerLevel(uint8_t level); // reduce/increase transmit power level
     bool sendWithRetry(uint8_t toAddress, const void* buffer, uint8_t bufferSize, uint8_t retries=2, uint8_t retryWaitTime=40); // 40ms roundtrip req for 61byte packets
@@ -34,6 +34,7 @@
 #include <RFM69_OTA.h>
 #include <RFM69registers.h>
 #include <avr/wdt.h>
+#include <util/crc16.h>
 
 
 //===================================================================================================================
@@ -51,7 +52,15 @@ void CheckForWirelessHEX(RFM69& radio, SPIFlash& flash, uint8_t DEBUG, uint8_t L
     uint8_t remoteID = radio.SENDERID;
     if (radio.DATALEN == 7 && radio.DATA[4]=='E' && radio.DATA[5]=='O' && radio.DATA[6]=='F')
     { //sender must have not received EOF ACK so just resend
-      radio.send(remoteID, "FLX?OK",6);
+      radio.sendACK("FLX?OK",6);
+    }
+    else if (radio.DATALEN == 13 && radio.DATA[4]=='B' && radio.DATA[5]=='I' && radio.DATA[6]=='N') //FLX?BIN + length + CRC
+    {
+      if (HandleWirelessBINData(radio, remoteID, flash, DEBUG, LEDpin))
+      {
+        if (DEBUG) Serial.print(F("FLASH IMG TRANSMISSION SUCCESS!\n"));
+        resetUsingWatchdog(DEBUG);
+      }
     }
 #ifdef SHIFTCHANNEL
     else if (HandleWirelessHEXDataWrapper(radio, remoteID, flash, DEBUG, LEDpin))
@@ -233,6 +242,202 @@ uint8_t HandleWirelessHEXData(RFM69& radio, uint8_t remoteID, SPIFlash& flash, u
 }
 
 
+//===================================================================================================================
+// Binary OTA transfer
+// The image is sent in OTA_CHUNK byte packets, each with its own CRC, several packets (a window) at a time.
+// Only the last packet of a window requests an ACK, which tells which packets arrived (selective ACK),
+// so lost packets are sent again in the next window without waiting for each ACK in turn.
+// Packets (multi byte numbers are little endian):
+//   handshake  FLX?BIN <length:4> <image CRC:2>   ACK: FLX?OK <first missing SEQ:2> <bitmap:2>  or  FLX?NOK:<reason>
+//   data       FLB: <SEQ:2> <data> <CRC of SEQ and data:2>
+//   ACK        FLB: <first missing SEQ:2> <bitmap:2>   bit i set: packet first+1+i was received
+//   EOF        FLX?EOF                           ACK: FLX?OK  or  FLX?NOK:CRC
+// The node writes each packet into the FLASH image as it arrives and clears its bit in a map in the
+// OTA_STATE_ADDR sector (FLASH bits can be cleared without an erase). A new handshake for the same
+// image (same length and CRC) resumes with the packets still missing; one that arrives during the
+// transfer (the sender missed the FLX?OK) is answered again. With SHIFTCHANNEL the node moves to the
+// shifted channel after its FLX?OK, so the sender repeats the handshake on both channels in turn.
+// The FLXIMG header for the bootloader is only written once the whole image checked out.
+//===================================================================================================================
+#define OTA_STATE_MAP 16 //offset of the received-packets bitmap in the state sector, a cleared bit means received
+
+static uint16_t otaCRC(uint16_t crc, const uint8_t* data, uint8_t len)
+{
+  while (len--) crc = _crc_ccitt_update(crc, *data++);
+  return crc;
+}
+
+static uint8_t otaChunkLen(uint32_t length, uint16_t seq)
+{
+  uint32_t left = length - (uint32_t)seq * OTA_CHUNK;
+  return left > OTA_CHUNK ? OTA_CHUNK : left;
+}
+
+static uint8_t otaChunkDone(SPIFlash& flash, uint16_t seq)
+{
+  return !(flash.readByte(OTA_STATE_ADDR + OTA_STATE_MAP + (seq >> 3)) & (1 << (seq & 7)));
+}
+
+//first missing packet at or after base, and the bitmap of the 16 packets after it
+static uint16_t otaNextMissing(SPIFlash& flash, uint16_t base, uint16_t chunks, uint16_t* map)
+{
+  while (base < chunks && otaChunkDone(flash, base)) base++;
+  *map = 0;
+  for (uint8_t i = 0; i < 16 && base + 1 + i < chunks; i++)
+    if (otaChunkDone(flash, base + 1 + i)) *map |= 1 << i;
+  return base;
+}
+
+//ACK with the first missing packet and the bitmap after it, tag is "FLX?OK" (handshake) or "FLB:" (data)
+static void otaSendACK(RFM69& radio, const char* tag, uint8_t tagLen, uint16_t base, uint16_t map)
+{
+  uint8_t buffer[10];
+  memcpy(buffer, tag, tagLen);
+  buffer[tagLen] = base; buffer[tagLen+1] = base >> 8;
+  buffer[tagLen+2] = map; buffer[tagLen+3] = map >> 8;
+  radio.sendACK(buffer, tagLen + 4);
+}
+
+//===================================================================================================================
+// HandleWirelessBINData() - handles a binary OTA transfer at the OTA programmed node side
+// radio.DATA must hold the FLX?BIN handshake; returns true when the complete image is in FLASH
+//===================================================================================================================
+uint8_t HandleWirelessBINData(RFM69& radio, uint8_t remoteID, SPIFlash& flash, uint8_t DEBUG, uint8_t LEDpin) {
+  uint8_t buffer[OTA_STATE_MAP];
+  uint8_t header[10];
+  uint16_t timeout = 3000; //3s for flash data
+  uint16_t base, map;
+
+  //state sector header: FLB: <length:4> <image CRC:2>, as in the handshake
+  memcpy(header, "FLB:", 4);
+  for (uint8_t i = 0; i < 6; i++) header[4+i] = radio.DATA[7+i];
+  uint32_t length = header[4] | ((uint32_t)header[5]<<8) | ((uint32_t)header[6]<<16) | ((uint32_t)header[7]<<24);
+  uint16_t crc = header[8] | (header[9]<<8);
+  uint16_t chunks = (length + OTA_CHUNK - 1) / OTA_CHUNK;
+
+  if (!flash.initialize())
+  {
+    radio.sendACK("FLX?NOK:NOFLASH",15);
+    if (DEBUG) Serial.println(F("FAIL:NO FLASH MEM"));
+    return false;
+  }
+#ifdef __AVR_ATmega1284P__
+  if (length > 65526 || length == 0) { //max 65536 - 10 bytes (signature)
+    radio.sendACK("FLX?NOK:HEX>64k",15);
+#else //assuming atmega328p
+  if (length > 31744 || length == 0) {
+    radio.sendACK("FLX?NOK:HEX>31k",15);
+#endif
+    if (DEBUG) Serial.println(F("IMG too big"));
+    return false;
+  }
+
+  //resume if the state sector was written for this same image
+  flash.readBytes(OTA_STATE_ADDR, buffer, 10);
+  uint8_t resume = memcmp(buffer, header, 10) == 0;
+  base = resume ? otaNextMissing(flash, 0, chunks, &map) : 0;
+  if (!resume) map = 0;
+
+  otaSendACK(radio, "FLX?OK", 6, base, map);
+  if (DEBUG) { Serial.print(resume ? F("FLX?OK resuming at ") : F("FLX?OK new image, packets: ")); Serial.println(resume ? base : chunks); }
+
+  if (!resume)
+  {
+    //erase the image area (the header is only written at the end) and start a new state
+    flash.eraseRange(0, length + 10);
+    flash.blockErase4K(OTA_STATE_ADDR);
+    flash.writeBytes(OTA_STATE_ADDR, header, 10);
+  }
+
+#ifdef SHIFTCHANNEL
+  radio.setFrequency(radio.getFrequency() + SHIFTCHANNEL); //shift center freq by SHIFTCHANNEL amount
+#endif
+  uint8_t result = false;
+  uint32_t now = millis();
+
+  while (1)
+  {
+    if (millis()-now > timeout) //abort if no valid packet received for a long time
+    {
+      if (DEBUG) Serial.println(F("Timeout, transfer can be resumed"));
+      break;
+    }
+    if (!(radio.receiveDone() && radio.SENDERID == remoteID)) continue;
+    uint8_t dataLen = radio.DATALEN;
+    uint8_t* data = (uint8_t*)radio.DATA;
+
+    if (dataLen >= 9 && data[0]=='F' && data[1]=='L' && data[2]=='B' && data[3]==':')
+    {
+      uint16_t seq = data[4] | (data[5]<<8);
+      uint8_t len = dataLen - 8;
+      uint16_t packetCRC = data[dataLen-2] | (data[dataLen-1]<<8);
+      if (seq < chunks && len == otaChunkLen(length, seq) && otaCRC(0xFFFF, data+4, len+2) == packetCRC)
+      {
+        now = millis(); //got "good" packet
+        if (!otaChunkDone(flash, seq))
+        {
+          flash.writeBytes(10 + (uint32_t)seq * OTA_CHUNK, data+6, len); //split at page boundaries by writeBytes
+          flash.writeByte(OTA_STATE_ADDR + OTA_STATE_MAP + (seq >> 3), ~(1 << (seq & 7)));
+        }
+        if (seq == base) base = otaNextMissing(flash, base, chunks, &map);
+      }
+      else if (DEBUG) { Serial.print(F("BAD PACKET ")); Serial.println(seq); }
+
+      if (radio.ACKRequested())
+      {
+        base = otaNextMissing(flash, base, chunks, &map);
+        otaSendACK(radio, "FLB:", 4, base, map);
+        if (DEBUG) { Serial.print(F("FLB:")); Serial.print(base); Serial.print(':'); Serial.println(map, BIN); }
+      }
+      #ifdef LED //blink!
+      pinMode(LEDpin,OUTPUT); digitalWrite(LEDpin,HIGH); delay(1); digitalWrite(LEDpin,LOW);
+      #endif
+    }
+    else if (dataLen == 13 && memcmp(data, "FLX?BIN", 7) == 0 && memcmp(data+7, header+4, 6) == 0)
+    {
+      //same handshake again: the sender missed the FLX?OK, tell it again where to start
+      now = millis();
+      base = otaNextMissing(flash, base, chunks, &map);
+      otaSendACK(radio, "FLX?OK", 6, base, map);
+      if (DEBUG) { Serial.print(F("FLX?OK resend, resuming at ")); Serial.println(base); }
+    }
+    else if (dataLen == 7 && data[0]=='F' && data[1]=='L' && data[2]=='X' && data[3]=='?' && data[4]=='E' && data[5]=='O' && data[6]=='F')
+    {
+      //check the complete image against its CRC before handing it to the bootloader
+      uint16_t imageCRC = 0xFFFF;
+      base = otaNextMissing(flash, 0, chunks, &map);
+      for (uint32_t offset = 0; base >= chunks && offset < length; offset += sizeof(buffer))
+      {
+        uint8_t n = length - offset > sizeof(buffer) ? sizeof(buffer) : length - offset;
+        flash.readBytes(10 + offset, buffer, n);
+        imageCRC = otaCRC(imageCRC, buffer, n);
+      }
+      if (base < chunks || imageCRC != crc)
+      {
+        radio.sendACK("FLX?NOK:CRC",11);
+        if (DEBUG) Serial.println(F("FLX?NOK:CRC"));
+        flash.blockErase4K(OTA_STATE_ADDR); //start over with the next handshake
+        break;
+      }
+      flash.writeBytes(0, "FLXIMG:", 7);
+      flash.writeByte(7, length >> 8);
+      flash.writeByte(8, length);
+      flash.writeByte(9, ':');
+      flash.blockErase4K(OTA_STATE_ADDR);
+      radio.sendACK("FLX?OK",6);
+      if (DEBUG) Serial.println(F("FLX?OK"));
+      result = true;
+      break;
+    }
+  }
+
+#ifdef SHIFTCHANNEL
+  radio.setFrequency(radio.getFrequency() - SHIFTCHANNEL); //restore center freq
+#endif
+  return result;
+}
+
+
 //===================================================================================================================
 // readSerialLine() - reads a line feed (\n) terminated line from the serial stream
 // returns # of bytes read, up to 254
@@ -398,6 +603,139 @@ timeoutcheck:
 }
 
 
+//===================================================================================================================
+// SendBINImage() - sends a length bytes image with the binary OTA protocol to targetID
+// read() gets the image data, e.g. from a FLASH chip where the image was stored before
+// window packets are sent before an ACK is requested; a node that was interrupted before resumes
+// where it stopped. Returns true when the node confirmed the complete image.
+// this is called at the OTA programmer side
+//===================================================================================================================
+uint8_t SendBINImage(RFM69& radio, uint8_t targetID, uint32_t length, OTAReadFunc read, uint8_t window, uint16_t TIMEOUT, uint16_t ACKTIMEOUT, uint8_t DEBUG)
+{
+  uint8_t buf[RF69_MAX_DATA_LEN];
+  uint16_t chunks = (length + OTA_CHUNK - 1) / OTA_CHUNK;
+  uint16_t base = 0, map = 0, seq;
+  uint8_t len, result = false;
+  if (window < 1) window = 1;
+  if (window > OTA_MAX_WINDOW) window = OTA_MAX_WINDOW;
+
+  //CRC of the complete image, checked by the node before it accepts the image
+  uint16_t crc = 0xFFFF;
+  for (seq = 0; seq < chunks; seq++)
+  {
+    len = otaChunkLen(length, seq);
+    if (read((uint32_t)seq * OTA_CHUNK, buf, len) != len) return false;
+    crc = otaCRC(crc, buf, len);
+  }
+
+  //handshake, the ACK tells where to start
+  memcpy(buf, "FLX?BIN", 7);
+  for (uint8_t i = 0; i < 4; i++) buf[7+i] = length >> (i*8);
+  buf[11] = crc; buf[12] = crc >> 8;
+  uint8_t ok, shifted = false;
+  uint32_t now = millis();
+  while (1)
+  {
+    if (radio.sendWithRetry(targetID, buf, 13, 2, ACKTIMEOUT) &&
+        radio.DATALEN >= 6 && radio.DATA[0]=='F' && radio.DATA[1]=='L' && radio.DATA[2]=='X' && radio.DATA[3]=='?')
+    {
+      ok = radio.DATALEN == 10 && radio.DATA[4] == 'O';
+      if (!ok && DEBUG) Serial.println((char*)radio.DATA);
+      base = radio.DATA[6] | (radio.DATA[7]<<8);
+      map = radio.DATA[8] | (radio.DATA[9]<<8);
+      break;
+    }
+    if (millis()-now > TIMEOUT)
+    {
+      if (DEBUG) Serial.println(F("Handshake fail"));
+      ok = false;
+      break;
+    }
+#ifdef SHIFTCHANNEL
+    //the node moves to the shifted channel right after its FLX?OK; if that ACK was lost, the node
+    //only hears the handshake there, so try both channels in turn
+    radio.setFrequency(shifted ? radio.getFrequency() - SHIFTCHANNEL : radio.getFrequency() + SHIFTCHANNEL);
+    shifted = !shifted;
+#endif
+  }
+#ifdef SHIFTCHANNEL
+  //the transfer runs on the shifted channel
+  if (ok && !shifted) radio.setFrequency(radio.getFrequency() + SHIFTCHANNEL);
+  if (!ok && shifted) radio.setFrequency(radio.getFrequency() - SHIFTCHANNEL);
+#endif
+  if (!ok) return false;
+  if (DEBUG) { Serial.print(F("BIN OTA starting at packet ")); Serial.print(base); Serial.print('/'); Serial.println(chunks); }
+
+  now = millis();
+  while (base < chunks)
+  {
+    //send the packets of the window the node doesn't have yet, only the last one requests the ACK
+    uint16_t end = base + window < chunks ? base + window : chunks;
+    uint16_t last = base;
+    for (seq = base; seq < end; seq++)
+      if (seq == base || !(map & (1 << (seq - base - 1)))) last = seq;
+    for (seq = base; seq < end; seq++)
+    {
+      if (seq != base && (map & (1 << (seq - base - 1)))) continue;
+      len = otaChunkLen(length, seq);
+      memcpy(buf, "FLB:", 4);
+      buf[4] = seq; buf[5] = seq >> 8;
+      if (read((uint32_t)seq * OTA_CHUNK, buf+6, len) != len) goto done;
+      uint16_t packetCRC = otaCRC(0xFFFF, buf+4, len+2);
+      buf[6+len] = packetCRC; buf[7+len] = packetCRC >> 8;
+      delay(OTA_PACKET_GAP);
+      radio.send(targetID, buf, len+8, seq == last);
+    }
+
+    //selective ACK: everything before base arrived, and the packets flagged in map
+    uint32_t sentTime = millis();
+    while (millis()-sentTime < ACKTIMEOUT)
+    {
+      if (radio.ACKReceived(targetID))
+      {
+        if (radio.DATALEN == 8 && radio.DATA[0]=='F' && radio.DATA[1]=='L' && radio.DATA[2]=='B' && radio.DATA[3]==':')
+        {
+          uint16_t ackBase = radio.DATA[4] | (radio.DATA[5]<<8);
+          if (ackBase >= base)
+          {
+            if (ackBase > base) now = millis(); //progress
+            base = ackBase;
+            map = radio.DATA[6] | (radio.DATA[7]<<8);
+          }
+          if (DEBUG) { Serial.print(F("FLB:")); Serial.print(base); Serial.print(':'); Serial.println(map, BIN); }
+        }
+        break;
+      }
+    }
+
+    if (millis()-now > TIMEOUT)
+    {
+      Serial.println(F("Timeout waiting for packet ACK, aborting FLASH operation ..."));
+      goto done;
+    }
+  }
+
+  //EOF, the node checks the image CRC before it answers
+  now = millis();
+  while (millis()-now < TIMEOUT)
+  {
+    if (radio.sendWithRetry(targetID, "FLX?EOF", 7, 2, ACKTIMEOUT) &&
+        radio.DATALEN >= 6 && radio.DATA[0]=='F' && radio.DATA[1]=='L' && radio.DATA[2]=='X' && radio.DATA[3]=='?')
+    {
+      result = radio.DATA[4] == 'O';
+      if (DEBUG) Serial.println(result ? F("FLX?OK") : F("FLX?NOK:CRC"));
+      break;
+    }
+  }
+
+done:
+#ifdef SHIFTCHANNEL
+  radio.setFrequency(radio.getFrequency() - SHIFTCHANNEL); //restore center freq
+#endif
+  return result;
+}
+
+
 //===================================================================================================================
 // validateHEXData() - returns length of HEX data bytes if everything is valid
 //returns 0 if any validation failed
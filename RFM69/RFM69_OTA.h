@@ -52,12 +52,35 @@
 #include <RFM69.h>
 #include <SPIFlash.h>
 
+//binary OTA transfer (SendBINImage() -> HandleWirelessBINData())
+#ifndef OTA_CHUNK
+  #define OTA_CHUNK 48 //image bytes per packet, at most RF69_MAX_DATA_LEN-8 (4 bytes header, 2 bytes SEQ, 2 bytes CRC)
+#endif
+#ifndef OTA_WINDOW
+  #define OTA_WINDOW 8 //packets sent before waiting for a selective ACK, at most OTA_MAX_WINDOW
+#endif
+#define OTA_MAX_WINDOW 17 //the ACK carries the first missing SEQ and a bitmap of the 16 after it
+#ifndef OTA_PACKET_GAP
+  #define OTA_PACKET_GAP 3 //ms before each packet, so the node has written the one before to FLASH and listens again
+#endif
+#ifndef OTA_STATE_ADDR
+  #define OTA_STATE_ADDR 0x20000 //4K sector of the FLASH chip holding the transfer state, so a broken transfer can resume
+#endif
+#if OTA_CHUNK > RF69_MAX_DATA_LEN-8
+  #error OTA_CHUNK does not fit in a packet
+#endif
+
+//reads len bytes of the image at offset into buf, returns the number of bytes read
+typedef uint8_t (*OTAReadFunc)(uint32_t offset, uint8_t* buf, uint8_t len);
+
 //functions used in the REMOTE node
 void CheckForWirelessHEX(RFM69& radio, SPIFlash& flash, uint8_t DEBUG=false, uint8_t LEDpin=LED);
 void HandleHandshakeACK(RFM69& radio, SPIFlash& flash, uint8_t flashCheck=true);
 void resetUsingWatchdog(uint8_t DEBUG=false);
 uint8_t HandleWirelessHEXData(RFM69& radio, uint8_t remoteID, SPIFlash& flash, uint8_t DEBUG=false, uint8_t LEDpin=LED);
 
+uint8_t HandleWirelessBINData(RFM69& radio, uint8_t remoteID, SPIFlash& flash, uint8_t DEBUG=false, uint8_t LEDpin=LED);
+
 #ifdef SHIFTCHANNEL
 uint8_t HandleWirelessHEXDataWrapper(RFM69& radio, uint8_t remoteID, SPIFlash& flash, uint8_t DEBUG=false, uint8_t LEDpin=LED);
 #endif
@@ -69,6 +92,7 @@ uint8_t HandleSerialHEXData(RFM69& radio, uint8_t targetID, uint16_t TIMEOUT=DEF
 #ifdef SHIFTCHANNEL
 uint8_t HandleSerialHEXDataWrapper(RFM69& radio, uint8_t targetID, uint16_t TIMEOUT=DEFAULT_TIMEOUT, uint16_t ACKTIMEOUT=ACK_TIMEOUT, uint8_t DEBUG=false);
 #endif
+uint8_t SendBINImage(RFM69& radio, uint8_t targetID, uint32_t length, OTAReadFunc read, uint8_t window=OTA_WINDOW, uint16_t TIMEOUT=DEFAULT_TIMEOUT, uint16_t ACKTIMEOUT=ACK_TIMEOUT, uint8_t DEBUG=false);
 uint8_t waitForAck(RFM69& radio, uint8_t fromNodeID, uint16_t ACKTIMEOUT=ACK_TIMEOUT);
 
 uint8_t validateHEXData(void* data, uint8_t length);
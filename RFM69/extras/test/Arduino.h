@@ -0,0 +1,53 @@
+// Host build shim for the RFM69 OTA packet loss simulation (see otasim.cpp).
+// Only what RFM69_OTA.cpp uses is declared here.  Serial output goes to the
+// log of the node that prints it.
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LOW    0
+#define HIGH   1
+#define INPUT  0
+#define OUTPUT 1
+
+#define DEC 10
+#define HEX 16
+#define BIN 2
+
+typedef uint8_t byte;
+typedef uint16_t word;
+typedef bool boolean;
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(s))
+
+class HardwareSerial {
+public:
+  void print(const char *s);
+  void print(const __FlashStringHelper *s) { print(reinterpret_cast<const char *>(s)); }
+  void print(char c) { char s[2] = { c, 0 }; print(s); }
+  void print(long n, int base = DEC);
+  void print(unsigned long n, int base = DEC);
+  void print(int n, int base = DEC) { print((long) n, base); }
+  void print(unsigned int n, int base = DEC) { print((unsigned long) n, base); }
+  template <class T> void println(T x) { print(x); print("\n"); }
+  template <class T> void println(T x, int base) { print(x, base); print("\n"); }
+  void println() { print("\n"); }
+  void setTimeout(unsigned long) {}
+  size_t readBytesUntil(char, char *, size_t) { return 0; }
+};
+extern HardwareSerial Serial;
+
+// provided by the simulation, in simulated time of the calling node
+unsigned long millis(void);
+void delay(unsigned long ms);
+void simSpend(unsigned long us); // the calling node is busy for us microseconds
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+
+#endif
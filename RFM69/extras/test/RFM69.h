@@ -0,0 +1,49 @@
+// Host build shim for the RFM69 OTA packet loss simulation (see otasim.cpp).
+// The RFM69 interface RFM69_OTA.cpp uses, on a simulated radio channel: each
+// object is one node, frames take their air time at 55.5 kbps, the radio only
+// receives while it listens (not while sending, nor between receiveDone()
+// returning a frame and the next receiveDone() call, as the real driver) and
+// the simulation drops frames to model loss.  DATA etc. are per object here.
+
+#ifndef RFM69_h
+#define RFM69_h
+
+#include <Arduino.h>
+
+#define RF69_MAX_DATA_LEN   61
+#define RF69_BROADCAST_ADDR 255
+#define RFM69_CTL_SENDACK   0x80
+#define RFM69_CTL_REQACK    0x40
+
+class RFM69 {
+  public:
+    volatile uint8_t DATA[RF69_MAX_DATA_LEN + 1]; // +1: always 0 terminated
+    volatile uint8_t DATALEN;
+    volatile uint8_t SENDERID;
+    volatile uint8_t TARGETID;
+    volatile uint8_t ACK_REQUESTED;
+    volatile uint8_t ACK_RECEIVED;
+
+    RFM69(uint8_t address, uint32_t freqHz);
+    void send(uint8_t toAddress, const void* buffer, uint8_t bufferSize, bool requestACK=false);
+    bool sendWithRetry(uint8_t toAddress, const void* buffer, uint8_t bufferSize, uint8_t retries=2, uint8_t retryWaitTime=40);
+    bool receiveDone();
+    bool ACKReceived(uint8_t fromNodeID);
+    bool ACKRequested();
+    void sendACK(const void* buffer = "", uint8_t bufferSize=0);
+    uint32_t getFrequency() { return _freq; }
+    void setFrequency(uint32_t freqHz) { _freq = freqHz; _listening = false; }
+
+    // simulation state
+    uint8_t _address;
+    uint32_t _freq;
+    bool _listening;           // in RX mode
+    unsigned long long _since; // in RX mode since (us)
+    size_t _nextFrame;         // first frame on the air not looked at yet
+    long _framesSent;
+
+  protected:
+    void sendFrame(uint8_t toAddress, const void* buffer, uint8_t size, uint8_t ctl);
+};
+
+#endif
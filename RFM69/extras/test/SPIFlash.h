@@ -0,0 +1,36 @@
+// Host build shim for the RFM69 OTA packet loss simulation (see otasim.cpp).
+// The SPIFlash interface RFM69_OTA.cpp uses, on memory that behaves like NOR
+// flash (a write only clears bits, an erase sets them) and takes the time of
+// a W25X40CL: page program 0.7 ms, 4K/32K/64K erase 45/120/150 ms, 2 us a
+// byte on the SPI bus at 4 MHz.  SPIFlash/extras/test checks the real driver.
+
+#ifndef _SPIFLASH_H_
+#define _SPIFLASH_H_
+
+#include <Arduino.h>
+#include <vector>
+
+#define SPIFLASH_PAGESIZE 256
+
+class SPIFlash {
+public:
+  SPIFlash(uint8_t slaveSelectPin, uint16_t jedecID=0) : mem(0x80000, 0xFF), present(true), programs(0), erases(0) {}
+  boolean initialize() { simSpend(20); return present; }
+  uint8_t readByte(long addr) { simSpend(10); return mem[addr]; }
+  void readBytes(long addr, void* buf, word len);
+  void writeByte(long addr, uint8_t byt) { writeBytes(addr, &byt, 1); }
+  void writeBytes(long addr, const void* buf, word len);
+  void blockErase4K(long address) { erase(address, 0x1000, 45000); }
+  void blockErase32K(long address) { erase(address, 0x8000, 120000); }
+  void blockErase64K(long address) { erase(address, 0x10000, 150000); }
+  word eraseRange(long address, long len);
+
+  std::vector<uint8_t> mem;
+  bool present;
+  long programs, erases;
+
+protected:
+  void erase(long address, long size, unsigned long us);
+};
+
+#endif
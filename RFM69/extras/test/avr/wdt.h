@@ -0,0 +1,13 @@
+// Host build shim for the RFM69 OTA packet loss simulation (see otasim.cpp).
+// wdt_enable() reboots the simulated node.
+
+#ifndef _AVR_WDT_H_
+#define _AVR_WDT_H_
+
+#include <stdint.h>
+
+#define WDTO_15MS 0
+
+void wdt_enable(uint8_t timeout);
+
+#endif
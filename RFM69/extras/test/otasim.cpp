@@ -0,0 +1,454 @@
+/*
+ * RFM69_OTA - host-side packet loss simulation of the binary OTA transfer.
+ *
+ * Runs the real RFM69_OTA.cpp on two simulated nodes that share a radio
+ * channel (RFM69.h and SPIFlash.h in this directory are the models):
+ * - the programmer calls SendBINImage(), the node runs the usual sketch loop
+ *   with CheckForWirelessHEX() and "reboots" when the image is complete
+ * - each node has its own clock; the radio calls, FLASH operations and the
+ *   CRC take their time on the AVR, frames their air time at 55.5 kbps, and
+ *   a frame is only received if the radio was listening on its channel for
+ *   all of it (a node still writing FLASH misses the next frame, which is
+ *   what OTA_PACKET_GAP is for)
+ * - frames are dropped at random, or on purpose to hit one protocol step
+ * For each case it prints the outcome, the data frames sent, the ACKs and the
+ * time taken, and checks the image the node stored for its bootloader.  It
+ * also checks that a lost handshake ACK is answered again on the shifted
+ * channel, that an interrupted transfer resumes where it stopped, and that a
+ * refused image isn't reported as resumable.  The exit status is nonzero if
+ * any check fails.
+ *
+ * Build and run from this directory:
+ *   g++ -O2 -Wall -Wno-format -D__AVR__ -I. -I../.. -o otasim otasim.cpp ../../RFM69_OTA.cpp && ./otasim
+ * (-Wno-format: the HEX path scans a 16 bit unsigned with %u, right on the AVR)
+ */
+
+#include "Arduino.h"
+#include "RFM69_OTA.h"
+
+#include <ucontext.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#define PROGRAMMER_ID 1
+#define NODE_ID       2
+#define FREQUENCY     915000000UL
+#define BITRATE       55555UL
+#define QUANTUM       100 // us a node may run ahead of the other one
+#define PREAMBLE_US   (3 * 8 * 1000000UL / BITRATE)
+
+// ----- two nodes, each with its own clock, run as coroutines -----
+
+struct SimReboot {};
+
+struct SimNode {
+  ucontext_t ctx;
+  std::vector<char> stack;
+  unsigned long long now;  // us
+  bool finished;
+  std::string log;
+  void (*body)();
+};
+
+static SimNode nodes[2];   // 0: programmer, 1: node
+static SimNode *self;
+static ucontext_t mainContext;
+
+static SimNode *other(SimNode *n) { return n == &nodes[0] ? &nodes[1] : &nodes[0]; }
+
+void simSpend(unsigned long us)
+{
+  self->now += us;
+  SimNode *o = other(self);
+  if (!o->finished && self->now > o->now + QUANTUM)
+  {
+    SimNode *me = self;
+    self = o;
+    swapcontext(&me->ctx, &o->ctx);
+  }
+}
+
+unsigned long millis(void) { simSpend(2); return self->now / 1000; }
+void delay(unsigned long ms) { simSpend(ms * 1000); }
+void pinMode(uint8_t pin, uint8_t mode) {}
+void digitalWrite(uint8_t pin, uint8_t val) {}
+void wdt_enable(uint8_t timeout) { throw SimReboot(); }
+
+HardwareSerial Serial;
+
+void HardwareSerial::print(const char *s) { self->log += s; }
+
+void HardwareSerial::print(long n, int base)
+{
+  if (n < 0)
+  {
+    print('-');
+    n = -n;
+  }
+  print((unsigned long) n, base);
+}
+
+void HardwareSerial::print(unsigned long n, int base)
+{
+  char buf[40], *p = buf + sizeof(buf) - 1;
+  *p = 0;
+  do
+  {
+    *--p = "0123456789ABCDEF"[n % base];
+    n /= base;
+  } while (n);
+  print(p);
+}
+
+static void nodeEntry()
+{
+  self->body();
+  self->finished = true;
+  SimNode *o = other(self);
+  if (!o->finished)
+  {
+    self = o;
+    setcontext(&o->ctx);
+  }
+  setcontext(&mainContext);
+}
+
+static void runNodes(void (*programmer)(), void (*node)())
+{
+  void (*bodies[2])() = { programmer, node };
+  for (int i = 0; i < 2; i++)
+  {
+    SimNode &n = nodes[i];
+    n.stack.assign(1 << 18, 0);
+    n.now = 0;
+    n.finished = false;
+    n.log.clear();
+    n.body = bodies[i];
+    getcontext(&n.ctx);
+    n.ctx.uc_stack.ss_sp = &n.stack[0];
+    n.ctx.uc_stack.ss_size = n.stack.size();
+    n.ctx.uc_link = &mainContext;
+    makecontext(&n.ctx, nodeEntry, 0);
+  }
+  self = &nodes[0];
+  swapcontext(&mainContext, &nodes[0].ctx);
+}
+
+// ----- the radio channel -----
+
+struct AirFrame {
+  uint8_t from, to, ctl, len;
+  uint8_t data[RF69_MAX_DATA_LEN];
+  uint32_t freq;
+  unsigned long long start, end;
+  bool dropped;
+};
+
+static std::vector<AirFrame> air;
+static double lossRate;
+static bool (*dropFrame)(const AirFrame &f);  // drops chosen by the case
+static unsigned long rng;
+static long dataFrames, ackFrames;
+
+static bool lose()
+{
+  rng = rng * 1103515245 + 12345;
+  return (rng >> 16) % 10000 < lossRate * 10000;
+}
+
+RFM69::RFM69(uint8_t address, uint32_t freqHz)
+  : DATALEN(0), SENDERID(0), TARGETID(0), ACK_REQUESTED(0), ACK_RECEIVED(0),
+    _address(address), _freq(freqHz), _listening(false), _since(0), _nextFrame(0), _framesSent(0)
+{
+}
+
+void RFM69::sendFrame(uint8_t toAddress, const void* buffer, uint8_t size, uint8_t ctl)
+{
+  // wait while the channel is busy (the driver's canSend() checks RSSI)
+  simSpend(50);
+  for (size_t i = _nextFrame; i < air.size(); i++)
+    if (air[i].freq == _freq && air[i].from != _address && air[i].start <= self->now && self->now < air[i].end)
+      simSpend(air[i].end - self->now + 50);
+  simSpend(2 * (size + 5) + 100); // FIFO write, TX start up
+
+  AirFrame f;
+  f.from = _address;
+  f.to = toAddress;
+  f.ctl = ctl;
+  f.len = size;
+  memcpy(f.data, buffer, size);
+  f.freq = _freq;
+  f.start = self->now;
+  f.end = f.start + (11 + size) * 8 * 1000000ULL / BITRATE; // preamble, sync, header, CRC
+  f.dropped = lose() || (dropFrame && dropFrame(f));
+  air.push_back(f);
+  _listening = false;
+  _framesSent++;
+  if (size >= 4 && !memcmp(buffer, "FLB:", 4))
+    (ctl & RFM69_CTL_SENDACK ? ackFrames : dataFrames)++;
+  simSpend(f.end - f.start + 200); // until PACKETSENT, back to standby
+}
+
+void RFM69::send(uint8_t toAddress, const void* buffer, uint8_t bufferSize, bool requestACK)
+{
+  sendFrame(toAddress, buffer, bufferSize, requestACK ? RFM69_CTL_REQACK : 0);
+}
+
+bool RFM69::sendWithRetry(uint8_t toAddress, const void* buffer, uint8_t bufferSize, uint8_t retries, uint8_t retryWaitTime)
+{
+  for (uint8_t i = 0; i <= retries; i++)
+  {
+    send(toAddress, buffer, bufferSize, true);
+    unsigned long sentTime = millis();
+    while (millis() - sentTime < retryWaitTime)
+      if (ACKReceived(toAddress))
+        return true;
+  }
+  return false;
+}
+
+bool RFM69::receiveDone()
+{
+  simSpend(30);
+  if (!_listening)
+  {
+    // receiveBegin()
+    _listening = true;
+    _since = self->now;
+    while (_nextFrame < air.size() && air[_nextFrame].end <= _since)
+      _nextFrame++;
+    return false;
+  }
+  // the interrupt handler reads each frame into DATA as it ends, so a frame
+  // not taken by receiveDone() yet is overwritten by the next one
+  const AirFrame *got = 0;
+  for (; _nextFrame < air.size() && air[_nextFrame].end <= self->now; _nextFrame++)
+  {
+    const AirFrame &f = air[_nextFrame];
+    // the receiver must be on in time to see the preamble
+    if (f.dropped || f.from == _address || f.freq != _freq || f.start + PREAMBLE_US / 2 < _since)
+      continue;
+    if (f.to == _address || f.to == RF69_BROADCAST_ADDR)
+      got = &f;
+  }
+  if (!got)
+    return false;
+  memcpy((void *) DATA, got->data, got->len);
+  DATA[got->len] = 0;
+  DATALEN = got->len;
+  SENDERID = got->from;
+  TARGETID = got->to;
+  ACK_REQUESTED = got->ctl & RFM69_CTL_REQACK;
+  ACK_RECEIVED = got->ctl & RFM69_CTL_SENDACK;
+  _listening = false; // standby until the next receiveDone()
+  simSpend(20 + 2 * got->len); // FIFO read in the interrupt handler
+  return true;
+}
+
+bool RFM69::ACKReceived(uint8_t fromNodeID)
+{
+  if (receiveDone())
+    return (SENDERID == fromNodeID || fromNodeID == RF69_BROADCAST_ADDR) && ACK_RECEIVED;
+  return false;
+}
+
+bool RFM69::ACKRequested() { return ACK_REQUESTED && TARGETID != RF69_BROADCAST_ADDR; }
+
+void RFM69::sendACK(const void* buffer, uint8_t bufferSize)
+{
+  ACK_REQUESTED = 0;
+  sendFrame(SENDERID, buffer, bufferSize, RFM69_CTL_SENDACK);
+}
+
+// ----- the FLASH model -----
+
+void SPIFlash::readBytes(long addr, void* buf, word len)
+{
+  simSpend(10 + 2 * len);
+  memcpy(buf, &mem[addr], len);
+}
+
+void SPIFlash::writeBytes(long addr, const void* buf, word len)
+{
+  const uint8_t *p = (const uint8_t *) buf;
+  while (len)
+  {
+    word n = SPIFLASH_PAGESIZE - (addr % SPIFLASH_PAGESIZE);
+    if (n > len) n = len;
+    for (word i = 0; i < n; i++)
+      mem[addr + i] &= p[i];
+    simSpend(10 + 2 * n + 700);
+    programs++;
+    addr += n;
+    p += n;
+    len -= n;
+  }
+}
+
+void SPIFlash::erase(long address, long size, unsigned long us)
+{
+  address &= ~(size - 1);
+  memset(&mem[address], 0xFF, size);
+  erases++;
+  simSpend(us);
+}
+
+word SPIFlash::eraseRange(long addr, long len)
+{
+  long end = (addr + len + 0xFFF) & ~0xFFFL;
+  word count = 0;
+  for (addr &= ~0xFFFL; addr < end; count++)
+  {
+    if ((addr & 0xFFFF) == 0 && end - addr >= 0x10000) { blockErase64K(addr); addr += 0x10000; }
+    else if ((addr & 0x7FFF) == 0 && end - addr >= 0x8000) { blockErase32K(addr); addr += 0x8000; }
+    else { blockErase4K(addr); addr += 0x1000; }
+  }
+  return count;
+}
+
+// ----- the programmer and the node -----
+
+static std::vector<uint8_t> image;
+static SPIFlash flash(8);
+static int attempts;                 // SendBINImage() calls before giving up
+static int attemptsMade, reboots;
+static bool sent;                    // SendBINImage() returned true
+static unsigned long long stopAt;    // the node stops here
+static unsigned long long sendTime;  // us in SendBINImage()
+
+static uint8_t readImage(uint32_t offset, uint8_t* buf, uint8_t len)
+{
+  if (offset + len > image.size()) return 0;
+  memcpy(buf, &image[offset], len);
+  return len;
+}
+
+static void programmer()
+{
+  RFM69 radio(PROGRAMMER_ID, FREQUENCY);
+  sent = false;
+  sendTime = 0;
+  for (attemptsMade = 0; attemptsMade < attempts && !sent; )
+  {
+    if (attemptsMade++) delay(1000);
+    unsigned long long start = self->now;
+    sent = SendBINImage(radio, NODE_ID, image.size(), readImage);
+    sendTime += self->now - start;
+  }
+  stopAt = self->now + 5000000ULL;
+}
+
+static void node()
+{
+  RFM69 radio(NODE_ID, FREQUENCY);
+  while (1)
+  {
+    try
+    {
+      while (self->now < stopAt)
+        if (radio.receiveDone())
+          CheckForWirelessHEX(radio, flash, true);
+      return;
+    }
+    catch (SimReboot &)
+    {
+      // the bootloader copies the image; the new sketch keeps answering FLX?EOF
+      self->log += "<reboot>\n";
+      reboots++;
+    }
+  }
+}
+
+// ----- the cases -----
+
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+  if (!ok)
+  {
+    printf("FAIL: %s\n", what);
+    failures++;
+  }
+}
+
+static bool imageStored()
+{
+  const std::vector<uint8_t> &m = flash.mem;
+  return !memcmp(&m[0], "FLXIMG:", 7) && m[7] == (uint8_t) (image.size() >> 8) && m[8] == (uint8_t) image.size() &&
+         m[9] == ':' && !memcmp(&m[10], &image[0], image.size());
+}
+
+// one transfer of a new image of 'length' bytes (0: the image of the case
+// before again); returns true if it was stored
+static bool transfer(const char *name, long length, double loss, bool (*drop)(const AirFrame &) = 0)
+{
+  if (length)
+  {
+    image.resize(length);
+    for (long i = 0; i < length; i++)
+      image[i] = rand();
+  }
+  length = image.size();
+  air.clear();
+  lossRate = loss;
+  dropFrame = drop;
+  rng = 1;
+  dataFrames = ackFrames = 0;
+  attempts = 1;
+  reboots = 0;
+  stopAt = ~0ULL;
+  flash.mem[0] = 0xFF; // no FLXIMG header from the case before
+
+  runNodes(programmer, node);
+
+  long chunks = (length + OTA_CHUNK - 1) / OTA_CHUNK;
+  bool stored = imageStored();
+  printf("%-26s %5ld bytes, %3.0f%% loss: %s, %d call(s), %4ld data frames for %3ld packets, %3ld ACKs, %5.1f s\n",
+         name, length, loss * 100, sent ? "sent" : "failed", attemptsMade, dataFrames, chunks, ackFrames, sendTime / 1e6);
+  check(sent == stored, "SendBINImage() result matches the image stored");
+  check(reboots == (stored ? 1 : 0), "the node reboots once after a complete image");
+  return stored;
+}
+
+static bool nodeSaid(const char *text) { return nodes[1].log.find(text) != std::string::npos; }
+
+// drop the first two FLX?OK answers to the FLX?BIN handshake
+static int handshakeACKs;
+static bool dropHandshakeACKs(const AirFrame &f)
+{
+  return f.from == NODE_ID && f.len == 10 && !memcmp(f.data, "FLX?OK", 6) && handshakeACKs++ < 2;
+}
+
+// nothing gets through for 10 s, from 2 s in
+static bool blackout(const AirFrame &f) { return f.start > 2000000 && f.start < 12000000; }
+
+int main()
+{
+  srand(1);
+  check(transfer("clean channel", 20000, 0), "image transferred over a clean channel");
+  check(transfer("random loss", 20000, 0.1), "image transferred with 10% loss");
+  check(transfer("random loss", 20000, 0.3), "image transferred with 30% loss");
+
+  handshakeACKs = 0;
+  check(transfer("handshake ACKs lost", 20000, 0, dropHandshakeACKs), "image transferred after lost handshake ACKs");
+  check(nodeSaid("FLX?OK resend"), "node answers a repeated handshake during the transfer");
+
+  check(!transfer("interrupted", 30000, 0, blackout), "transfer stops during the blackout");
+  check(nodeSaid("transfer can be resumed"), "node reports the timeout as resumable");
+  long firstFrames = dataFrames;
+  // the same image again, the FLASH still holds the state of the transfer
+  check(transfer("resumed", 0, 0), "interrupted transfer completes");
+  check(nodeSaid("resuming at") && firstFrames + dataFrames < 2 * ((30000 + OTA_CHUNK - 1) / OTA_CHUNK),
+        "resumed transfer only sends the missing packets");
+
+  check(!transfer("image too big", 40000, 0), "image over 31k refused");
+  check(nodeSaid("IMG too big") && !nodeSaid("can be resumed"), "refused image not reported as resumable");
+
+  if (failures)
+    printf("%d check(s) failed\n", failures);
+  else
+    printf("all checks passed\n");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,17 @@
+// Host build shim for the RFM69 OTA packet loss simulation (see otasim.cpp).
+// The CRC-CCITT update of avr-libc, about a microsecond per byte on the AVR.
+
+#ifndef _UTIL_CRC16_H_
+#define _UTIL_CRC16_H_
+
+#include <Arduino.h>
+
+static inline uint16_t _crc_ccitt_update(uint16_t crc, uint8_t data)
+{
+  simSpend(1);
+  data ^= crc & 0xFF;
+  data ^= data << 4;
+  return (((uint16_t) data << 8) | (crc >> 8)) ^ (uint8_t) (data >> 4) ^ ((uint16_t) data << 3);
+}
+
+#endif
@@ -0,0 +1,54 @@
+// Wireless DMX: one sketch for both ends of the link.
+// The transmitter reads DMX from a console, the receiver drives the fixtures.
+// Set TRANSMITTER to 1 on the node wired to the console, 0 on the other one.
+// DMXSerial uses the hardware serial port, so there is no Serial output here;
+// the LED blinks on every radio packet.
+#include <RFM69_DMX.h>
+#include <RFM69_DMXBridge.h>
+#include <DMXSerial.h>
+#include <SPI.h>
+
+#define TRANSMITTER 1
+#define TXNODEID    1
+#define RXNODEID    2
+#define NETWORKID   100
+#define FREQUENCY   RF69_868MHZ //Match this with the version of your Moteino! (others: RF69_433MHZ, RF69_915MHZ)
+#define KEY         "thisIsEncryptKey" //has to be same 16 characters/bytes on all nodes, not more not less!
+#define LED         9
+
+RFM69 radio;
+DMXBridge bridge(radio);
+
+void setup() {
+  pinMode(LED, OUTPUT);
+#if TRANSMITTER
+  radio.initialize(FREQUENCY, TXNODEID, NETWORKID);
+  DMXSerial.init(DMXReceiver);
+  bridge.beginTransmit(RXNODEID);
+#else
+  radio.initialize(FREQUENCY, RXNODEID, NETWORKID);
+  DMXSerial.init(DMXController);
+  bridge.beginReceive(TXNODEID);
+#endif
+  //radio.setHighPower(); //uncomment only for RFM69HW!
+  radio.encrypt(KEY);
+  bridge.keyframeInterval(500);
+}
+
+void loop() {
+  if (bridge.update())
+    digitalWrite(LED, !digitalRead(LED));
+
+#if !TRANSMITTER
+  // Black out once when the link is lost for more than 2 seconds
+  static bool blackout = false;
+  if (bridge.noDataSince() > 2000) {
+    if (!blackout)
+      for (int ch = 1; ch <= DMXBRIDGE_CHANNELS; ch++)
+        DMXSerial.write(ch, 0);
+    blackout = true;
+  }
+  else
+    blackout = false;
+#endif
+}
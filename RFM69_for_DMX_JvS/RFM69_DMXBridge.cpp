@@ -0,0 +1,162 @@
+// ****************************************************************************
+// DMX universe bridge over the RFM69 radio
+// ****************************************************************************
+// Creative Commons Attrib Share-Alike License
+// You are free to use/extend this library but please abide with the CC-BY-SA
+// license:
+// http://creativecommons.org/licenses/by-sa/3.0/
+// ****************************************************************************
+#include <RFM69_DMXBridge.h>
+#define DMXSERIAL_EXTERN // the sketch defines the DMXSerial object
+#include <DMXSerial.h>
+
+#define DMXBRIDGE_ALL  ((uint16_t)((1UL << DMXBRIDGE_SEGMENTS) - 1))
+
+
+void DMXBridge::beginTransmit(byte toAddress)
+{
+  _peer = toAddress;
+  _transmitter = true;
+  _dirty = 0;
+  _keyPending = DMXBRIDGE_ALL; // Start with a full universe
+  _next = 0;
+  _seq = 0;
+  _lastKeyframe = millis();
+  clearStats();
+}
+
+
+void DMXBridge::beginReceive(byte fromAddress)
+{
+  _peer = fromAddress;
+  _transmitter = false;
+  _synced = false;
+  clearStats();
+}
+
+
+void DMXBridge::clearStats()
+{
+  _packets = 0;
+  _lost = 0;
+  _keyframes = 0;
+  _ageSum = 0;
+  _ageMax = 0;
+  _lastPacket = millis();
+}
+
+
+byte DMXBridge::ageAvg()
+{
+  return _packets ? _ageSum / _packets : 0;
+}
+
+
+bool DMXBridge::update()
+{
+  return _transmitter ? transmit() : receive();
+}
+
+
+bool DMXBridge::transmit()
+{
+  unsigned long now = millis();
+
+  // Collect the changed channels into changed segments
+  int ch = 0;
+  while ((ch = DMXSerial.nextChanged(ch)) > 0)
+  {
+    byte seg = (ch - 1) / DMXBRIDGE_SEGMENT_LEN;
+    if (!(_dirty & (1 << seg)))
+    {
+      _dirty |= 1 << seg;
+      _dirtySince[seg] = now;
+    }
+  }
+
+  if (_keyframeInterval && !_keyPending &&
+      now - _lastKeyframe >= _keyframeInterval)
+    _keyPending = DMXBRIDGE_ALL;
+
+  uint16_t todo = _dirty | _keyPending;
+  if (!todo)
+    return false;
+
+  // Round robin, so a segment that changes all the time can't starve others
+  byte seg = _next;
+  while (!(todo & (1 << seg)))
+    seg = (seg + 1) % DMXBRIDGE_SEGMENTS;
+  _next = (seg + 1) % DMXBRIDGE_SEGMENTS;
+
+  byte packet[MAX_DATA_LEN];
+  unsigned long age = (_dirty & (1 << seg)) ? now - _dirtySince[seg] : 0;
+  packet[0] = DMXBRIDGE_TYPE;
+  packet[1] = _seq++;
+  packet[2] = seg | ((_keyPending & (1 << seg)) ? DMXBRIDGE_KEYFRAME : 0);
+  packet[3] = age > 255 ? 255 : age;
+  byte len = DMXSerial.readRange(1 + seg * DMXBRIDGE_SEGMENT_LEN,
+                                 packet + DMXBRIDGE_HEADER,
+                                 DMXBRIDGE_SEGMENT_LEN);
+
+  // Clear the flags first: a change while sending marks the segment again
+  _dirty &= ~(1 << seg);
+  if (_keyPending & (1 << seg))
+  {
+    _keyPending &= ~(1 << seg);
+    if (!_keyPending)
+    {
+      _keyframes++;
+      _lastKeyframe = now;
+    }
+  }
+
+  _radio.send(_peer, packet, DMXBRIDGE_HEADER + len);
+  _packets++;
+  _lastPacket = millis();
+  return true;
+}
+
+
+bool DMXBridge::receive()
+{
+  if (!_radio.receiveDone())
+    return false;
+
+  if (RFM69::DATALEN <= DMXBRIDGE_HEADER ||
+      RFM69::DATA[0] != DMXBRIDGE_TYPE ||
+      (_peer && RFM69::SENDERID != _peer))
+    return false;
+
+  byte seq = RFM69::DATA[1];
+  byte seg = RFM69::DATA[2] & ~DMXBRIDGE_KEYFRAME;
+  byte age = RFM69::DATA[3];
+  if (seg >= DMXBRIDGE_SEGMENTS)
+    return false;
+
+  if (_synced && millis() - _lastPacket < DMXBRIDGE_RESYNC_MS)
+  {
+    // Half the sequence space ahead counts as new, the other half as old
+    byte gap = seq - _seq;
+    if (gap == 0 || gap >= 128)
+      return false; // Duplicate, or older than the data already written
+    _lost += gap - 1;
+  }
+  _seq = seq;
+  _synced = true;
+
+  // The last segment of a keyframe completes it
+  if ((RFM69::DATA[2] & DMXBRIDGE_KEYFRAME) && seg == DMXBRIDGE_SEGMENTS - 1)
+    _keyframes++;
+
+  DMXSerial.writeRange(1 + seg * DMXBRIDGE_SEGMENT_LEN,
+                       (const uint8_t*)RFM69::DATA + DMXBRIDGE_HEADER,
+                       RFM69::DATALEN - DMXBRIDGE_HEADER);
+  DMXSerial.commit(); // Only does something with double buffering
+
+  _packets++;
+  _ageSum += age;
+  if (age > _ageMax)
+    _ageMax = age;
+  _lastPacket = millis();
+  return true;
+}
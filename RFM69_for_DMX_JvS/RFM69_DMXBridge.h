@@ -0,0 +1,113 @@
+// ****************************************************************************
+// DMX universe bridge over the RFM69 radio
+// ****************************************************************************
+// Creative Commons Attrib Share-Alike License
+// You are free to use/extend this library but please abide with the CC-BY-SA
+// license:
+// http://creativecommons.org/licenses/by-sa/3.0/
+// ****************************************************************************
+// One node reads a universe with DMXSerial (DMXReceiver mode) and transmits
+// it, the other node writes it to DMXSerial (DMXController mode).
+//
+// A full universe does not fit in one radio packet, and sending all of it
+// at the DMX frame rate needs more air time than the radio has: at 55555
+// baud a 61 byte packet takes about 10ms, so 9 packets per universe allow
+// 11 updates per second at best. The universe is therefore split into
+// DMXBRIDGE_SEGMENTS segments. Only segments with changed channels are sent,
+// and all segments are sent again every keyframe interval so a receiver that
+// lost a packet, or started late, catches up.
+//
+// Packet layout (DMXBRIDGE_HEADER bytes, then up to DMXBRIDGE_SEGMENT_LEN
+// channel values):
+//   0  DMXBRIDGE_TYPE, to tell bridge packets apart from other traffic
+//   1  sequence number, incremented for every packet
+//   2  segment index, DMXBRIDGE_KEYFRAME set when sent as part of a keyframe
+//   3  age: ms between the change on the DMX input and the transmission
+//      (255 = 255ms or more). Only the transmitter's share of the delay;
+//      the air time and the receiver's loop come on top of it.
+//
+// The receiver ignores packets whose sequence number is not ahead of the
+// last one (duplicates, or packets overtaken by newer ones). A transmitter
+// that restarts begins at sequence 0 again, so after DMXBRIDGE_RESYNC_MS
+// without a packet any sequence number is taken.
+//
+// The transmitter uses DMXSerial.nextChanged() to find the changed channels,
+// so the sketch must not call nextChanged() itself.
+// ****************************************************************************
+#ifndef RFM69_DMXBridge_h
+#define RFM69_DMXBridge_h
+#include <Arduino.h>
+#include <RFM69_DMX.h>
+
+#define DMXBRIDGE_HEADER       4
+#define DMXBRIDGE_SEGMENT_LEN  (MAX_DATA_LEN - DMXBRIDGE_HEADER) // 57
+#define DMXBRIDGE_CHANNELS     512
+#define DMXBRIDGE_SEGMENTS     ((DMXBRIDGE_CHANNELS + DMXBRIDGE_SEGMENT_LEN - 1) \
+                                / DMXBRIDGE_SEGMENT_LEN) // 9
+#define DMXBRIDGE_TYPE         0xD7
+#define DMXBRIDGE_KEYFRAME     0x80
+#define DMXBRIDGE_KEYFRAME_MS  1000 // Default time between keyframes
+#define DMXBRIDGE_RESYNC_MS    1000 // Silence after which the receiver resyncs
+
+class DMXBridge {
+  public:
+    DMXBridge(RFM69 &radio) : _radio(radio)
+    {
+      _peer = 0;
+      _transmitter = false;
+      _keyframeInterval = DMXBRIDGE_KEYFRAME_MS;
+      clearStats();
+    }
+
+    // Transmit the universe read by DMXSerial to node toAddress (0 for
+    // broadcast). DMXSerial must be initialized in DMXReceiver mode.
+    void beginTransmit(byte toAddress=0);
+    // Write the universe received from node fromAddress (0 for any node) to
+    // DMXSerial, which must be initialized in DMXController mode.
+    void beginReceive(byte fromAddress=0);
+    // Time between keyframes in ms, 0 to send changed segments only.
+    void keyframeInterval(uint16_t ms) { _keyframeInterval = ms; }
+
+    // Call from loop() as often as possible. The transmitter sends at most
+    // one packet per call, the receiver handles at most one.
+    // Returns true if a packet was sent or received.
+    bool update();
+
+    // Statistics
+    void clearStats();
+    unsigned long packets()   { return _packets; }   // Sent or received
+    unsigned long lost()      { return _lost; }      // Sequence gaps (RX)
+    unsigned long keyframes() { return _keyframes; } // Complete keyframes
+    byte ageMax()             { return _ageMax; }    // Transmitter side
+    byte ageAvg();                                   //  delay in ms (RX)
+    unsigned long noDataSince() { return millis() - _lastPacket; }
+
+  protected:
+    bool transmit();
+    bool receive();
+
+    RFM69 &_radio;
+    byte _peer;
+    bool _transmitter;
+    uint16_t _keyframeInterval;
+
+    // Transmitter state
+    uint16_t _dirty;       // One bit per segment waiting to be sent
+    uint16_t _keyPending;  // Segments of the running keyframe not yet sent
+    byte _next;            // Segment to look at first (round robin)
+    byte _seq;
+    unsigned long _lastKeyframe;
+    unsigned long _dirtySince[DMXBRIDGE_SEGMENTS];
+
+    // Receiver state
+    bool _synced;          // _seq holds the last received sequence number
+
+    unsigned long _packets;
+    unsigned long _lost;
+    unsigned long _keyframes;
+    unsigned long _ageSum;
+    byte _ageMax;
+    unsigned long _lastPacket;
+};
+
+#endif
@@ -0,0 +1,15 @@
+// Host build shim for the DMX bridge loopback simulation (see bridgesim.cpp).
+// Only what RFM69_DMXBridge.cpp uses is declared here.
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <string.h>
+
+typedef uint8_t byte;
+
+// provided by the simulation
+unsigned long millis(void);
+
+#endif
@@ -0,0 +1,36 @@
+// Host build shim for the DMX bridge loopback simulation (see bridgesim.cpp).
+// One object stands for the DMXSerial of both nodes: the transmitter's calls
+// read the universe coming from the console, the receiver's calls write the
+// universe going to the fixtures.
+
+#ifndef DmxSerial_h
+#define DmxSerial_h
+
+#include <Arduino.h>
+
+#define DMXSERIAL_MAX 512
+
+class DMXSerialClass
+{
+  public:
+    // DMXReceiver side (transmitting node)
+    int     nextChanged(int channel);
+    int     readRange  (int start, uint8_t *values, int count);
+
+    // DMXController side (receiving node)
+    void    write      (int channel, uint8_t value) { writeRange(channel, &value, 1); }
+    int     writeRange (int start, const uint8_t *values, int count);
+    void    commit     (void) {}
+
+    // simulation: the console sets a channel, which marks it changed
+    void    input      (int channel, uint8_t value);
+
+    uint8_t in[DMXSERIAL_MAX + 1];
+    bool    changed[DMXSERIAL_MAX + 1];
+    uint8_t out[DMXSERIAL_MAX + 1];
+    unsigned long inAt[DMXSERIAL_MAX + 1];  // us of the last input change
+};
+
+extern DMXSerialClass DMXSerial;
+
+#endif
@@ -0,0 +1,28 @@
+// Host build shim for the DMX bridge loopback simulation (see bridgesim.cpp).
+// The RFM69 interface RFM69_DMXBridge.cpp uses, on a simulated link: send()
+// takes the frame's air time at 55.5 kbps, and the simulation decides when,
+// how often or whether the frame arrives at the other node.  DATA etc. are
+// static, as in the real class.
+
+#ifndef RFM69_h
+#define RFM69_h
+
+#include <Arduino.h>
+
+#define MAX_DATA_LEN 61
+
+class RFM69 {
+  public:
+    static volatile byte DATA[MAX_DATA_LEN];
+    static volatile byte DATALEN;
+    static volatile byte SENDERID;
+
+    RFM69(byte address) : _address(address) {}
+    bool send(byte toAddress, const void* buffer, byte bufferSize, bool requestACK=false);
+    bool receiveDone();
+
+    // simulation state
+    byte _address;
+};
+
+#endif
@@ -0,0 +1,312 @@
+/*
+ * RFM69_DMXBridge - host-side loopback simulation of the DMX bridge.
+ *
+ * Runs the real RFM69_DMXBridge.cpp as transmitter and receiver on one
+ * simulated clock (RFM69_DMX.h, DMXSerial.h and Arduino.h in this directory
+ * are the models):
+ * - a console changes the input universe: a fader on channel 1 that only
+ *   moves up, a chase on channels 2..8 and a new scene on all channels every
+ *   2 seconds, then it stops so the output has to settle
+ * - send() takes the air time of the frame at 55.5 kbps; the link drops,
+ *   duplicates or delays frames (a delayed frame is overtaken by the next)
+ * For each case it prints the packets, the lost count, the age the bridge
+ * reports and the end-to-end delay from an input change to the output, and
+ * checks that the output ends up equal to the input, that lost() counts
+ * exactly the frames that never arrived or arrived overtaken, and that an
+ * old frame never sets the fader back.  It also checks that the receiver
+ * follows a transmitter that restarts at sequence 0.  The exit status is
+ * nonzero if any check fails.
+ *
+ * Build and run from this directory:
+ *   g++ -O2 -Wall -I. -I../.. -o bridgesim bridgesim.cpp ../../RFM69_DMXBridge.cpp && ./bridgesim
+ */
+
+#include "Arduino.h"
+#include "RFM69_DMX.h"
+#include "DMXSerial.h"
+#include "RFM69_DMXBridge.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#define TX_ID        1
+#define RX_ID        2
+#define BITRATE      55555UL
+#define FRAME_EXTRA  11   // preamble, sync, length, addresses, control, CRC
+#define SEND_US      600  // SPI and mode switches around a frame
+#define RECEIVE_US   300  // reading the FIFO and writing the universe
+#define LOOP_US      50   // one loop() without radio work
+
+static unsigned long long simNow; // us
+
+unsigned long millis(void) { return simNow / 1000; }
+
+// ----- the link between the two nodes -----
+
+struct SimFrame {
+  unsigned long long arrive;
+  long index;              // in the order sent
+  byte from, to, len;
+  byte data[MAX_DATA_LEN];
+};
+
+static struct {
+  double loss, duplicate, late;
+  unsigned long lateUs;
+} link;
+
+static std::vector<SimFrame> air;
+static long sentFrames;
+static std::vector<bool> onTime;  // per index: arrived before any later frame
+static long newestArrived;
+
+volatile byte RFM69::DATA[MAX_DATA_LEN];
+volatile byte RFM69::DATALEN;
+volatile byte RFM69::SENDERID;
+
+static bool chance(double p) { return p > 0 && rand() < p * RAND_MAX; }
+
+bool RFM69::send(byte toAddress, const void* buffer, byte bufferSize, bool)
+{
+  simNow += SEND_US + (bufferSize + FRAME_EXTRA) * 8 * 1000000ULL / BITRATE;
+
+  SimFrame f;
+  f.arrive = simNow;
+  f.index = sentFrames++;
+  f.from = _address;
+  f.to = toAddress;
+  f.len = bufferSize;
+  memcpy(f.data, buffer, bufferSize);
+  onTime.push_back(false);
+  if (chance(link.loss))
+    return true;
+  if (chance(link.late))
+    f.arrive += link.lateUs;
+  air.push_back(f);
+  if (chance(link.duplicate)) {
+    f.arrive += 2000;
+    air.push_back(f);
+  }
+  return true;
+}
+
+bool RFM69::receiveDone()
+{
+  size_t first = air.size();
+  for (size_t i = 0; i < air.size(); i++)
+    if (air[i].arrive <= simNow && (first == air.size() || air[i].arrive < air[first].arrive))
+      first = i;
+  if (first == air.size())
+    return false;
+
+  SimFrame f = air[first];
+  air.erase(air.begin() + first);
+  if (f.to != _address && f.to != 0)
+    return false;
+  if (f.index > newestArrived) {
+    onTime[f.index] = true;
+    newestArrived = f.index;
+  }
+  memcpy((byte *) DATA, f.data, f.len);
+  DATALEN = f.len;
+  SENDERID = f.from;
+  return true;
+}
+
+// frames up to the newest that arrived which the receiver can't have used
+static long expectedLost()
+{
+  long n = 0;
+  for (long i = 0; i <= newestArrived; i++)
+    if (!onTime[i])
+      n++;
+  return n;
+}
+
+// ----- DMXSerial of both nodes -----
+
+DMXSerialClass DMXSerial;
+
+static bool pending[DMXSERIAL_MAX + 1]; // input change not yet at the output
+static unsigned long long delaySum, delayMax;
+static long delays;
+
+void DMXSerialClass::input(int channel, uint8_t value)
+{
+  if (in[channel] == value)
+    return;
+  in[channel] = value;
+  changed[channel] = true;
+  inAt[channel] = simNow;
+  pending[channel] = true;
+}
+
+int DMXSerialClass::nextChanged(int channel)
+{
+  for (int n = channel + 1; n <= DMXSERIAL_MAX; n++)
+    if (changed[n]) {
+      changed[n] = false;
+      return n;
+    }
+  return 0;
+}
+
+int DMXSerialClass::readRange(int start, uint8_t *values, int count)
+{
+  if (count > DMXSERIAL_MAX + 1 - start) count = DMXSERIAL_MAX + 1 - start;
+  memcpy(values, in + start, count);
+  return count;
+}
+
+int DMXSerialClass::writeRange(int start, const uint8_t *values, int count)
+{
+  if (count > DMXSERIAL_MAX + 1 - start) count = DMXSERIAL_MAX + 1 - start;
+  memcpy(out + start, values, count);
+  for (int ch = start; ch < start + count; ch++)
+    if (pending[ch] && out[ch] == in[ch]) {
+      unsigned long long d = simNow - inAt[ch];
+      delaySum += d;
+      if (d > delayMax) delayMax = d;
+      delays++;
+      pending[ch] = false;
+    }
+  return count;
+}
+
+// ----- the console -----
+
+static unsigned long long nextFader, nextChase, nextScene, consoleStops;
+
+static void console()
+{
+  if (simNow >= consoleStops)
+    return;
+  while (simNow >= nextFader) {
+    if (DMXSerial.in[1] < 250)
+      DMXSerial.input(1, DMXSerial.in[1] + 1);
+    nextFader += 25000;
+  }
+  while (simNow >= nextChase) {
+    int step = nextChase / 100000;
+    for (int ch = 2; ch <= 8; ch++)
+      DMXSerial.input(ch, (ch - 2) == step % 7 ? 255 : 0);
+    nextChase += 100000;
+  }
+  while (simNow >= nextScene) {
+    for (int ch = 9; ch <= DMXSERIAL_MAX; ch++)
+      DMXSerial.input(ch, rand());
+    nextScene += 2000000;
+  }
+}
+
+// ----- cases -----
+
+static RFM69 txRadio(TX_ID), rxRadio(RX_ID);
+static DMXBridge tx(txRadio), rx(rxRadio);
+static int failures;
+static bool faderBack;
+
+static void check(bool ok, const char *what)
+{
+  if (!ok) {
+    printf("FAILED: %s\n", what);
+    failures++;
+  }
+}
+
+static void run(unsigned long long until)
+{
+  while (simNow < until) {
+    byte fader = DMXSerial.out[1];
+    console();
+    if (!tx.update())
+      simNow += LOOP_US;
+    simNow += rx.update() ? RECEIVE_US : LOOP_US;
+    if (DMXSerial.out[1] < fader)
+      faderBack = true;
+  }
+}
+
+static void start(double loss, double duplicate, double late)
+{
+  link.loss = loss;
+  link.duplicate = duplicate;
+  link.late = late;
+  link.lateUs = 30000;
+  air.clear();
+  sentFrames = 0;
+  onTime.clear();
+  newestArrived = -1;
+  memset(&DMXSerial, 0, sizeof DMXSerial);
+  memset(pending, 0, sizeof pending);
+  delaySum = delayMax = delays = 0;
+  faderBack = false;
+  nextFader = nextChase = nextScene = simNow;
+  consoleStops = simNow + 8000000;
+  tx.keyframeInterval(500);
+  tx.beginTransmit(RX_ID);
+  rx.beginReceive(TX_ID);
+}
+
+static unsigned long endToEndAvg() { return delays ? delaySum / delays / 1000 : 0; }
+
+static void report(const char *name)
+{
+  printf("%-20s %5ld frames sent, %5lu received, %4lu lost (missed %4ld), "
+         "age avg %3d max %3d ms, end-to-end avg %3lu max %4llu ms\n",
+         name, sentFrames, rx.packets(), rx.lost(), expectedLost(),
+         rx.ageAvg(), rx.ageMax(), endToEndAvg(), delayMax / 1000);
+}
+
+static bool settled()
+{
+  return memcmp(DMXSerial.out + 1, DMXSerial.in + 1, DMXSERIAL_MAX) == 0;
+}
+
+static void linkCase(const char *name, double loss, double duplicate, double late)
+{
+  start(loss, duplicate, late);
+  run(simNow + 10000000);
+  report(name);
+  check(settled(), "output equals the input after the console stops");
+  check(rx.lost() == (unsigned long) expectedLost(), "lost() counts the frames the receiver missed");
+  check(!faderBack, "an old frame never sets the fader back");
+}
+
+int main()
+{
+  srand(1);
+
+  linkCase("clean link", 0, 0, 0);
+  check(rx.lost() == 0, "nothing lost on a clean link");
+  check(rx.ageAvg() + 10UL <= endToEndAvg(),
+        "ageAvg() leaves out the air time of about 10ms");
+
+  linkCase("10% loss", 0.1, 0, 0);
+  linkCase("30% loss", 0.3, 0, 0);
+  linkCase("10% duplicates", 0, 0.1, 0);
+  linkCase("5% overtaken", 0, 0, 0.05);
+  linkCase("all of it", 0.1, 0.05, 0.05);
+
+  // the transmitter restarts while the receiver keeps running; its sequence
+  // numbers start behind the last one received (the sequence gap counts as
+  // lost, "missed" doesn't apply)
+  start(0, 0, 0);
+  while (sentFrames % 256 < 100)
+    run(simNow + 1000);
+  simNow += 200000;
+  tx.beginTransmit(RX_ID);
+  unsigned long before = rx.packets();
+  run(simNow + 7000000);
+  report("transmitter restart");
+  check(settled(), "output follows a restarted transmitter");
+  check(rx.packets() > before && rx.noDataSince() < DMXBRIDGE_RESYNC_MS,
+        "receiver takes the packets of a restarted transmitter");
+
+  if (failures)
+    printf("%d check(s) failed\n", failures);
+  else
+    printf("all checks passed\n");
+  return failures ? 1 : 0;
+}
@@ -35,6 +35,14 @@ fat_t    Fat16::clusterCount_;           // total clusters in volume
 uint32_t Fat16::fatStartBlock_;          // start of first FAT
 uint32_t Fat16::rootDirStartBlock_;      // start of root dir
 uint32_t Fat16::dataStartBlock_;         // start of data clusters
+#if FAT16_DIR_INDEX_SIZE
+//------------------------------------------------------------------------------
+// root directory name index
+uint8_t  Fat16::dirIndexCount_ = 0;      // number of entries in the index
+uint8_t  Fat16::dirIndexComplete_ = 0;   // true if all used entries are indexed
+uint8_t  Fat16::dirIndexHash_[FAT16_DIR_INDEX_SIZE];    // hash of name
+uint16_t Fat16::dirIndexEntry_[FAT16_DIR_INDEX_SIZE];   // root dir index
+#endif  // FAT16_DIR_INDEX_SIZE
 //------------------------------------------------------------------------------
 // raw block cache
 SdCard *Fat16::rawDev_ = 0;             // class for block read and write
@@ -77,6 +85,18 @@ static uint8_t make83Name(const char* str, uint8_t* name) {
   // must have a file name, extension is optional
   return name[0] != ' ';
 }
+#if FAT16_DIR_INDEX_SIZE
+//------------------------------------------------------------------------------
+// hash of an 8.3 name for the root directory index, same as the checksum
+// used by long name entries
+static uint8_t dirHash(const uint8_t* name) {
+  uint8_t sum = 0;
+  for (uint8_t i = 0; i < 11; i++) {
+    sum = ((sum & 1) << 7) + (sum >> 1) + name[i];
+  }
+  return sum;
+}
+#endif  // FAT16_DIR_INDEX_SIZE
 //==============================================================================
 // Fat16 member functions
 //------------------------------------------------------------------------------
@@ -173,6 +193,53 @@ uint8_t Fat16::dirEntry(dir_t* dir) {
   memcpy(dir, p, sizeof(dir_t));
   return true;
 }
+#if FAT16_DIR_INDEX_SIZE
+//------------------------------------------------------------------------------
+// add a root directory entry to the name index
+void Fat16::dirIndexAdd(uint16_t index, const uint8_t* name) {
+  if (dirIndexCount_ < FAT16_DIR_INDEX_SIZE) {
+    dirIndexHash_[dirIndexCount_] = dirHash(name);
+    dirIndexEntry_[dirIndexCount_++] = index;
+  } else {
+    // entries not in the index must be found by a scan
+    dirIndexComplete_ = false;
+  }
+}
+//------------------------------------------------------------------------------
+// index all used root directory entries except long name entries
+uint8_t Fat16::dirIndexBuild(void) {
+  dirIndexCount_ = 0;
+  dirIndexComplete_ = true;
+  for (uint16_t index = 0; index < rootDirEntryCount_; index++) {
+    dir_t* p = cacheDirEntry(index);
+    if (!p) return false;
+
+    // done if beyond last used entry
+    if (p->name[0] == DIR_NAME_FREE) break;
+
+    if (p->name[0] == DIR_NAME_DELETED) continue;
+
+    // a long name entry never matches a name from make83Name()
+    if ((p->attributes & DIR_ATT_LONG_NAME_MASK) == DIR_ATT_LONG_NAME) continue;
+
+    dirIndexAdd(index, p->name);
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
+// remove a deleted root directory entry from the name index
+void Fat16::dirIndexRemove(uint16_t index) {
+  for (uint8_t i = 0; i < dirIndexCount_; i++) {
+    if (dirIndexEntry_[i] == index) {
+      // move last entry into the free slot
+      dirIndexCount_--;
+      dirIndexHash_[i] = dirIndexHash_[dirIndexCount_];
+      dirIndexEntry_[i] = dirIndexEntry_[dirIndexCount_];
+      return;
+    }
+  }
+}
+#endif  // FAT16_DIR_INDEX_SIZE
 //------------------------------------------------------------------------------
 uint8_t Fat16::fatGet(fat_t cluster, fat_t* value) {
   if (cluster > (clusterCount_ + 1)) return false;
@@ -268,6 +335,9 @@ uint8_t Fat16::init(SdCard* dev, uint8_t part) {
     // not a usable FAT16 bpb
     return false;
   }
+#if FAT16_DIR_INDEX_SIZE
+  if (!dirIndexBuild()) return false;
+#endif  // FAT16_DIR_INDEX_SIZE
   volumeInitialized_ = 1;
   return true;
 }
@@ -355,6 +425,28 @@ uint8_t Fat16::open(const char* fileName, uint8_t oflag) {
   // error if invalid name
   if (!make83Name(fileName, dname)) return false;
 
+#if FAT16_DIR_INDEX_SIZE
+  // check entries with a matching hash
+  uint8_t hash = dirHash(dname);
+  for (uint8_t i = 0; i < dirIndexCount_; i++) {
+    if (dirIndexHash_[i] != hash) continue;
+    uint16_t index = dirIndexEntry_[i];
+    if (!(p = cacheDirEntry(index))) return false;
+    if (!memcmp(dname, p->name, 11)) {
+      // don't open existing file if O_CREAT and O_EXCL
+      if ((oflag & (O_CREAT | O_EXCL)) == (O_CREAT | O_EXCL)) return false;
+
+      // open existing file
+      return open(index, oflag);
+    }
+  }
+  // if all entries are indexed the scan is only needed to create the file
+  if (dirIndexComplete_
+    && (oflag & (O_CREAT | O_WRITE)) != (O_CREAT | O_WRITE)) {
+    return false;
+  }
+#endif  // FAT16_DIR_INDEX_SIZE
+
   for (uint16_t index = 0; index < rootDirEntryCount_; index++) {
     if (!(p = cacheDirEntry(index))) return false;
     if (p->name[0] == DIR_NAME_FREE || p->name[0] == DIR_NAME_DELETED) {
@@ -398,6 +490,10 @@ uint8_t Fat16::open(const char* fileName, uint8_t oflag) {
   // insure created directory entry will be written to storage device
   if (!cacheFlush()) return false;
 
+#if FAT16_DIR_INDEX_SIZE
+  dirIndexAdd(empty, dname);
+#endif  // FAT16_DIR_INDEX_SIZE
+
   // open entry
   return open(empty, oflag);
 }
@@ -441,6 +537,11 @@ uint8_t Fat16::open(uint16_t index, uint8_t oflag) {
   dirEntryIndex_ = index;
   fileSize_ = d->fileSize;
   firstCluster_ = d->firstClusterLow;
+#if FAT16_RUN_COUNT
+  // a read only file can't change so its cluster chain is walked once
+  runCount_ = 0;
+  if (!(oflag & O_WRITE) && !runBuild()) return false;
+#endif  // FAT16_RUN_COUNT
   flags_ = oflag & (O_ACCMODE | O_SYNC | O_APPEND);
 
   if (oflag & O_TRUNC ) return truncate(0);
@@ -558,6 +659,10 @@ int16_t Fat16::read(void* buf, uint16_t nbyte) {
       // start next cluster
       if (curCluster_ == 0) {
         curCluster_ = firstCluster_;
+#if FAT16_RUN_COUNT
+      } else if (runCluster(clusterOfFile(curPosition_), &curCluster_)) {
+        // next cluster is in the runs, no FAT access
+#endif  // FAT16_RUN_COUNT
       } else {
         if (!fatGet(curCluster_, &curCluster_)) return -1;
       }
@@ -654,6 +759,9 @@ uint8_t Fat16::remove(void) {
   if (!d) return false;
   d->name[0] = DIR_NAME_DELETED;
   flags_ = 0;
+#if FAT16_DIR_INDEX_SIZE
+  dirIndexRemove(dirEntryIndex_);
+#endif  // FAT16_DIR_INDEX_SIZE
   return cacheFlush();
 }
 //------------------------------------------------------------------------------
@@ -678,6 +786,52 @@ uint8_t Fat16::remove(const char* fileName) {
   if (!file.open(fileName, O_WRITE)) return false;
   return file.remove();
 }
+#if FAT16_RUN_COUNT
+//------------------------------------------------------------------------------
+// walk the file's cluster chain into runs of contiguous clusters,
+// clusters after the last run are found with the FAT
+uint8_t Fat16::runBuild(void) {
+  // nothing to do for an empty file
+  if (fileSize_ == 0 || firstCluster_ == 0) return true;
+
+  // the FAT entry of the file's last cluster is not needed
+  fat_t count = clusterOfFile(fileSize_ - 1);
+  fat_t cluster = firstCluster_;
+  uint8_t i = 0;
+  runStart_[0] = cluster;
+  runLength_[0] = 1;
+  while (count--) {
+    fat_t next;
+    if (!fatGet(cluster, &next)) return false;
+
+    // a bad chain is reported by read() beyond the runs
+    if (next < 2 || isEOC(next)) break;
+
+    if (next != (cluster + 1)) {
+      // start a new run, stop if no room
+      if (++i >= FAT16_RUN_COUNT) break;
+      runStart_[i] = next;
+      runLength_[i] = 0;
+    }
+    runLength_[i]++;
+    cluster = next;
+  }
+  runCount_ = i < FAT16_RUN_COUNT ? i + 1 : FAT16_RUN_COUNT;
+  return true;
+}
+//------------------------------------------------------------------------------
+// find cluster \a n of the file in the runs, false if beyond the runs
+uint8_t Fat16::runCluster(fat_t n, fat_t* cluster) const {
+  for (uint8_t i = 0; i < runCount_; i++) {
+    if (n < runLength_[i]) {
+      *cluster = runStart_[i] + n;
+      return true;
+    }
+    n -= runLength_[i];
+  }
+  return false;
+}
+#endif  // FAT16_RUN_COUNT
 //------------------------------------------------------------------------------
 /**
  * Sets the file's read/write position.
@@ -696,10 +850,26 @@ uint8_t Fat16::seekSet(uint32_t pos) {
     curPosition_ = 0;
     return true;
   }
-  fat_t n = ((pos - 1) >> 9)/blocksPerCluster_;
+  fat_t n = clusterOfFile(pos - 1);
+#if FAT16_RUN_COUNT
+  if (runCluster(n, &curCluster_)) {
+    // no FAT access if the position is in the runs
+    curPosition_ = pos;
+    return true;
+  }
+#endif  // FAT16_RUN_COUNT
   if (pos < curPosition_ || curPosition_ == 0) {
     // must follow chain from first cluster
     curCluster_ = firstCluster_;
+#if FAT16_RUN_COUNT
+    if (runCount_) {
+      // or from the last cluster of the runs
+      uint8_t i = runCount_ - 1;
+      curCluster_ = runStart_[i] + runLength_[i] - 1;
+      n++;
+      for (i = 0; i < runCount_; i++) n -= runLength_[i];
+    }
+#endif  // FAT16_RUN_COUNT
   } else {
     // advance from curPosition
     n -= ((curPosition_ - 1) >> 9)/blocksPerCluster_;
@@ -329,6 +329,14 @@ class Fat16 : public Print {
   static uint32_t rootDirStartBlock_;  // start of root dir
   static uint32_t dataStartBlock_;     // start of data clusters
 
+#if FAT16_DIR_INDEX_SIZE
+  // root directory name index
+  static uint8_t dirIndexCount_;     // number of entries in the index
+  static uint8_t dirIndexComplete_;  // true if all used entries are indexed
+  static uint8_t dirIndexHash_[FAT16_DIR_INDEX_SIZE];    // hash of name
+  static uint16_t dirIndexEntry_[FAT16_DIR_INDEX_SIZE];  // root dir index
+#endif  // FAT16_DIR_INDEX_SIZE
+
   // block cache
   static uint8_t const CACHE_FOR_READ  = 0;    // cache a block for read
   static uint8_t const CACHE_FOR_WRITE = 1;    // cache a block and set dirty
@@ -351,6 +359,11 @@ class Fat16 : public Print {
   uint32_t fileSize_;      // fileSize
   fat_t curCluster_;       // current cluster
   uint32_t curPosition_;   // current byte offset
+#if FAT16_RUN_COUNT
+  uint8_t runCount_;                  // number of runs, zero if none
+  fat_t runStart_[FAT16_RUN_COUNT];   // first cluster of each run
+  fat_t runLength_[FAT16_RUN_COUNT];  // number of clusters in each run
+#endif  // FAT16_RUN_COUNT
 
   // private functions for cache
   static uint8_t blockOfCluster(uint32_t position) {
@@ -358,6 +371,9 @@ class Fat16 : public Print {
     return (position >> 9) & (blocksPerCluster_ - 1);
   }
   static uint16_t cacheDataOffset(uint32_t position) {return position & 0X1FF;}
+  static fat_t clusterOfFile(uint32_t position) {
+    return (position >> 9)/blocksPerCluster_;
+  }
   static dir_t* cacheDirEntry(uint16_t index, uint8_t action = 0);
   static uint8_t cacheRawBlock(uint32_t blockNumber, uint8_t action = 0);
   static uint8_t cacheFlush(void);
@@ -374,5 +390,14 @@ class Fat16 : public Print {
   uint8_t addCluster(void);
   // free a cluster chain
   uint8_t freeChain(fat_t cluster);
+#if FAT16_DIR_INDEX_SIZE
+  static void dirIndexAdd(uint16_t index, const uint8_t* name);
+  static uint8_t dirIndexBuild(void);
+  static void dirIndexRemove(uint16_t index);
+#endif  // FAT16_DIR_INDEX_SIZE
+#if FAT16_RUN_COUNT
+  uint8_t runBuild(void);
+  uint8_t runCluster(fat_t n, fat_t* cluster) const;
+#endif  // FAT16_RUN_COUNT
 };
 #endif  // Fat16_h
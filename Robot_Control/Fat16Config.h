@@ -35,4 +35,18 @@
  * Set non-zero to allow access to Fat16 internals by cardInfo debug sketch
  */
 #define FAT16_DEBUG_SUPPORT 1
+/**
+ * Number of root directory entries in the name index built by init().
+ * open() by name checks the index before scanning the root directory.
+ * Each entry uses three bytes of RAM, at most 255 entries.  Set to zero
+ * to disable the index.
+ */
+#define FAT16_DIR_INDEX_SIZE 32
+/**
+ * Number of cluster runs, a first cluster and a count of contiguous
+ * clusters, stored for a file opened read only.  read() and seekSet()
+ * use the runs instead of the FAT.  Each run uses four bytes of RAM in
+ * every Fat16 object.  Set to zero to disable the runs.
+ */
+#define FAT16_RUN_COUNT 4
 #endif  // Fat16Config_h
@@ -114,6 +114,14 @@ short 8.3 names.
 It is possible to open a file with two or more instances of Fat16.  A file may
 be corrupted if data is written to the file by more than one instance of Fat16.
 
+\link Fat16::init() init() \endlink builds an index of the names in the
+root directory so \link Fat16::open() open() \endlink does not scan the
+directory for a file name.  A file opened read only keeps its cluster chain
+as a few runs of contiguous clusters so \link Fat16::read() read() \endlink
+and \link Fat16::seekSet() seekSet() \endlink do not read the FAT.  Don't
+write a file while it is open read only by another instance of Fat16.
+The size of the index and the number of runs are set in Fat16Config.h.
+
 Short names are limited to 8 characters followed by an optional period (.)
 and extension of up to 3 characters.  The characters may be any combination
 of letters and digits.  The following special characters are also allowed:
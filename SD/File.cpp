@@ -18,11 +18,24 @@
    uint8_t nfilecount=0;
 */
 
+// SdFile slots for open files, so opening and closing files doesn't
+// fragment the heap.  Copies of a File share its slot.
+static SdFile filePool[SD_MAX_FILES];
+static boolean filePoolUsed[SD_MAX_FILES];
+
 File::File(SdFile f, const char *n) {
-  // oh man you are kidding me, new() doesnt exist? Ok we do it by hand!
-  _file = (SdFile *)malloc(sizeof(SdFile)); 
+  // take a free slot, the File is closed if all are in use
+  _file = 0;
+  _name[0] = 0;
+  for (uint8_t i = 0; i < SD_MAX_FILES; i++) {
+    if (!filePoolUsed[i]) {
+      filePoolUsed[i] = true;
+      _file = &filePool[i];
+      break;
+    }
+  }
   if (_file) {
-    memcpy(_file, &f, sizeof(SdFile));
+    *_file = f;
     
     strncpy(_name, n, 12);
     _name[12] = 0;
@@ -99,6 +112,27 @@ int File::read(void *buf, uint16_t nbyte) {
   return 0;
 }
 
+// Points *ptr at the data in the SD block cache instead of copying it.
+// Returns at most the rest of the current block, the data is valid
+// until the next SD access.
+int File::readPtr(const uint8_t **ptr, uint16_t nbyte) {
+  if (_file) 
+    return _file->readPtr(ptr, nbyte);
+  return 0;
+}
+
+// For files that are read in order: the card starts reading the next
+// block while the sketch uses the current one.
+boolean File::readAhead(boolean on) {
+  if (! _file) return false;
+
+  if (!on) {
+    _file->clearReadAhead();
+    return true;
+  }
+  return _file->setReadAhead();
+}
+
 int File::available() {
   if (! _file) return 0;
 
@@ -131,7 +165,7 @@ uint32_t File::size() {
 void File::close() {
   if (_file) {
     _file->close();
-    free(_file); 
+    filePoolUsed[_file - filePool] = false;
     _file = 0;
 
     /* for debugging file open/close leaks
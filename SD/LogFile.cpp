@@ -0,0 +1,113 @@
+/*
+
+ SD - a slightly more friendly wrapper for sdfatlib
+
+ This library aims to expose a subset of SD card functionality
+ in the form of a higher level "wrapper" object.
+
+ License: GNU General Public License V3
+          (Because sdfatlib is licensed with this.)
+
+ (C) Copyright 2010 SparkFun Electronics
+
+ */
+
+#include <SD.h>
+
+// A LogFile is opened with SD.openLog()
+LogFile::LogFile(void) {
+  _bgnBlock = 0;
+  _endBlock = 0;
+  _block = 0;
+  _count = 0;
+  clearLatency();
+}
+
+size_t LogFile::write(uint8_t val) {
+  return write(&val, 1);
+}
+
+// Data is copied to the block buffer, a full buffer is written to
+// the card. Nothing else is done here: the clusters are allocated
+// and erased, so the time is bounded by one block write.
+size_t LogFile::write(const uint8_t *buf, size_t size) {
+  if (!_file.isOpen() || size > capacity() - this->size()) {
+    setWriteError();
+    return 0;
+  }
+  size_t n = size;
+  while (n) {
+    uint16_t k = 512 - _count;
+    if (k > n)
+      k = n;
+    memcpy(_buf + _count, buf, k);
+    _count += k;
+    buf += k;
+    n -= k;
+    if (_count == 512) {
+      if (!writeBuffer()) {
+        setWriteError();
+        return 0;
+      }
+      _block++;
+      _count = 0;
+    }
+  }
+  return size;
+}
+
+// write _buf to _block and measure the time
+boolean LogFile::writeBuffer(void) {
+  uint32_t t = micros();
+  // the block bypasses the cache, drop an old copy of it (the clusters
+  // may have belonged to a removed file whose blocks are still cached)
+  SdVolume::cacheInvalidate(_block);
+  // pre-erase count for a new sequence: the rest of the file
+  if (!SdVolume::streamWrite(_block, _buf, _endBlock - _block + 1))
+    return false;
+  t = micros() - t;
+  if (t > _latencyMax)
+    _latencyMax = t;
+  _latencySum += t;
+  _blocks++;
+  return true;
+}
+
+// Write the partial block and end the multiple block sequence, so the
+// data is on the card. The directory entry still has the allocated size
+// until close(). What the rest of the file reads as depends on the card:
+// erased blocks read as zero or 0XFF, and blocks that weren't erased
+// (see SD.openLog()) still hold old data.
+boolean LogFile::sync(void) {
+  if (!_file.isOpen())
+    return false;
+  if (_count) {
+    memset(_buf + _count, 0, 512 - _count);
+    if (!writeBuffer())
+      return false;
+  }
+  return _file.sync();
+}
+
+boolean LogFile::close(void) {
+  if (!sync())
+    return false;
+  if (!_file.truncate(size()))
+    return false;
+  return _file.close();
+}
+
+uint32_t LogFile::size(void) {
+  return ((_block - _bgnBlock) << 9) + _count;
+}
+
+// maximum size, as given to SD.openLog()
+uint32_t LogFile::capacity(void) {
+  return _file.fileSize();
+}
+
+void LogFile::clearLatency(void) {
+  _latencyMax = 0;
+  _latencySum = 0;
+  _blocks = 0;
+}
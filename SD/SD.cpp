@@ -469,6 +469,55 @@ File SDClass::open(const char *filepath, uint8_t mode) {
 }
 
 
+boolean SDClass::openLog(LogFile &log, const char *filepath, uint32_t size) {
+  /*
+
+     Create a contiguous file of `size` bytes for the LogFile `log`.
+
+     The file must not exist.  Its blocks are erased, so the card
+     doesn't need to erase them while logging.  Cards that don't
+     support single block erase skip that step, the multiple block
+     writes then pre-erase the rest of the file.
+
+   */
+  if (log._file.isOpen()) return false;
+
+  int pathidx;
+  SdFile parentdir = getParentDir(filepath, &pathidx);
+  filepath += pathidx;
+
+  if (!filepath[0] || !parentdir.isOpen())
+    return false;
+
+  boolean ok;
+  // there is a special case for the Root directory since its a static dir
+  if (parentdir.isRoot()) {
+    ok = log._file.createContiguous(&root, filepath, size);
+  } else {
+    ok = log._file.createContiguous(&parentdir, filepath, size);
+    parentdir.close();
+  }
+  if (!ok)
+    return false;
+
+  if (!log._file.contiguousRange(&log._bgnBlock, &log._endBlock)) {
+    log._file.remove();
+    return false;
+  }
+  // erase() refuses cards without single block erase before it sends a
+  // command, any other failure is an error
+  if (!card.erase(log._bgnBlock, log._endBlock) &&
+      card.errorCode() != SD_CARD_ERROR_ERASE_SINGLE_BLOCK) {
+    log._file.remove();
+    return false;
+  }
+
+  log._block = log._bgnBlock;
+  log._count = 0;
+  log.clearLatency();
+  return true;
+}
+
 /*
 File SDClass::open(char *filepath, uint8_t mode) {
   //
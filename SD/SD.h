@@ -23,10 +23,21 @@
 #define FILE_READ O_READ
 #define FILE_WRITE (O_READ | O_WRITE | O_CREAT)
 
+// Number of File objects that can be open at the same time.  Open files
+// use SdFile slots of a fixed pool instead of the heap.  Define
+// SD_MAX_FILES before including SD.h to change it.
+#ifndef SD_MAX_FILES
+#if defined(RAMEND) && RAMEND < 0X1000
+#define SD_MAX_FILES 4
+#else  // RAMEND
+#define SD_MAX_FILES 8
+#endif  // RAMEND
+#endif  // SD_MAX_FILES
+
 class File : public Stream {
  private:
   char _name[13]; // our name
-  SdFile *_file;  // underlying file pointer
+  SdFile *_file;  // underlying file pointer, a slot of the pool or 0
 
 public:
   File(SdFile f, const char *name);     // wraps an underlying SdFile
@@ -39,6 +50,8 @@ public:
   virtual int available();
   virtual void flush();
   int read(void *buf, uint16_t nbyte);
+  int readPtr(const uint8_t **ptr, uint16_t nbyte); // read without a copy
+  boolean readAhead(boolean on = true); // for files read in order
   boolean seek(uint32_t pos);
   uint32_t position();
   uint32_t size();
@@ -53,6 +66,46 @@ public:
   using Print::write;
 };
 
+// A pre-allocated contiguous file for data logging.  The file is created
+// with its maximum size and erased, so logging doesn't search free clusters
+// or update the FAT and directory entry.  Data is collected in a block
+// buffer and each full block is written in a multiple block sequence.
+// close() truncates the file to the logged size.
+class LogFile : public Print {
+ private:
+  SdFile _file;
+  uint32_t _bgnBlock;     // first block of the file
+  uint32_t _endBlock;     // last block of the file
+  uint32_t _block;        // block for _buf
+  uint16_t _count;        // bytes in _buf
+  uint32_t _latencyMax;   // longest block write, micros
+  uint32_t _latencySum;   // for latencyAvg()
+  uint32_t _blocks;       // blocks written
+  uint8_t _buf[512];
+
+  boolean writeBuffer(void);
+
+public:
+  LogFile(void);
+  virtual size_t write(uint8_t);
+  virtual size_t write(const uint8_t *buf, size_t size);
+  boolean sync(void);     // write the partial block and end the sequence
+  boolean close(void);    // sync and truncate to size()
+  uint32_t size(void);    // bytes logged
+  uint32_t capacity(void);
+  operator bool() { return _file.isOpen(); }
+
+  // block write statistics, in microseconds
+  uint32_t latencyMax(void) { return _latencyMax; }
+  uint32_t latencyAvg(void) { return _blocks ? _latencySum / _blocks : 0; }
+  uint32_t blocksWritten(void) { return _blocks; }
+  void clearLatency(void);
+
+  using Print::write;
+
+  friend class SDClass;
+};
+
 class SDClass {
 
 private:
@@ -85,6 +138,10 @@ public:
   
   boolean rmdir(char *filepath);
 
+  // Create a new contiguous file of size bytes for logging and erase it.
+  // Fails if the file exists or there is no contiguous free space.
+  boolean openLog(LogFile &log, const char *filepath, uint32_t size);
+
 private:
 
   // This is used to determine the mode used to open a file
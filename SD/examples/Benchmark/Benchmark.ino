@@ -0,0 +1,220 @@
+/*
+  SD card benchmark
+
+ This example measures the SD library with your card:
+ * sequential write and read speed
+ * random 512 byte reads per second
+ * open and close rate
+ * histograms of write() and flush() times, with the longest time
+
+ If SD_CARD_STATS is on (the default for boards with more than
+ 2.5 KB RAM, see utility/Sd2Card.h) the card counters are printed
+ after each test: commands sent, blocks read and written and the
+ time spent waiting for the card.
+
+ The circuit:
+ * SD card attached to SPI bus as follows:
+ ** MOSI - pin 11
+ ** MISO - pin 12
+ ** CLK - pin 13
+ ** CS - pin 4
+
+ The sketch also runs on a PC against a simulated card with adjustable
+ latency, see extras/test/bench.cpp.
+
+ This example code is in the public domain.
+
+ */
+
+#include <SD.h>
+
+// On the Ethernet Shield, CS is pin 4. Note that even if it's not
+// used as the CS pin, the hardware CS pin (10 on most Arduino boards,
+// 53 on the Mega) must be left as an output or the SD library
+// functions will not work.
+const int chipSelect = 4;
+
+// test file, SD.remove() takes a char*
+char fileName[] = "bench.dat";
+// size of the test file
+const uint32_t FILE_SIZE = 500000;
+// bytes for each write() and read()
+const uint16_t BUF_SIZE = 100;
+// flush() after this many writes
+const uint16_t FLUSH_WRITES = 50;
+// random block reads and open/close calls
+const uint16_t RANDOM_READS = 200;
+const uint16_t OPENS = 100;
+
+// bucket i counts times below 2^(i+6) microseconds, 64 us to 65 ms,
+// the last bucket counts longer times
+const uint8_t BUCKETS = 12;
+
+struct Histogram {
+  uint32_t count[BUCKETS];
+  uint32_t maxMicros;
+};
+
+uint8_t buf[BUF_SIZE];
+Histogram writeTimes;
+Histogram flushTimes;
+
+void clearHistogram(Histogram &h)
+{
+  memset(&h, 0, sizeof(h));
+}
+
+void addTime(Histogram &h, uint32_t us)
+{
+  uint8_t i = 0;
+  while (i < BUCKETS - 1 && us >= (64UL << i)) i++;
+  h.count[i]++;
+  if (us > h.maxMicros) h.maxMicros = us;
+}
+
+void printHistogram(const char *name, Histogram &h)
+{
+  Serial.print(name);
+  Serial.print(" max us: ");
+  Serial.println(h.maxMicros);
+  for (uint8_t i = 0; i < BUCKETS; i++) {
+    if (!h.count[i]) continue;
+    Serial.print(i < BUCKETS - 1 ? "  < " : "  >= ");
+    Serial.print(64UL << (i < BUCKETS - 1 ? i : i - 1));
+    Serial.print(" us: ");
+    Serial.println(h.count[i]);
+  }
+}
+
+// print bytes per microsecond as KB/s
+void printRate(const char *name, uint32_t bytes, uint32_t us)
+{
+  Serial.print(name);
+  Serial.print(": ");
+  Serial.print(bytes * 1000.0 / us);
+  Serial.println(" KB/s");
+}
+
+void printStats()
+{
+#if SD_CARD_STATS
+  Sd2Card *card = SdVolume::sdCard();
+  const sd_stats_t *s = card->stats();
+  Serial.print("  commands: ");
+  Serial.print(s->commands);
+  Serial.print(", blocks read: ");
+  Serial.print(s->blocksRead);
+  Serial.print(", written: ");
+  Serial.println(s->blocksWritten);
+  Serial.print("  busy ms: ");
+  Serial.print(s->busyMicros / 1000);
+  Serial.print(" (max us ");
+  Serial.print(s->busyMaxMicros);
+  Serial.print("), read wait ms: ");
+  Serial.print(s->readWaitMicros / 1000);
+  Serial.print(" (max us ");
+  Serial.print(s->readWaitMaxMicros);
+  Serial.print("), errors: ");
+  Serial.println(s->errors);
+  card->clearStats();
+#endif  // SD_CARD_STATS
+}
+
+void setup()
+{
+ // Open serial communications and wait for port to open:
+  Serial.begin(9600);
+   while (!Serial) {
+    ; // wait for serial port to connect. Needed for Leonardo only
+  }
+
+  Serial.print("Initializing SD card...");
+  pinMode(10, OUTPUT);
+  if (!SD.begin(chipSelect)) {
+    Serial.println("Card failed, or not present");
+    return;
+  }
+  Serial.println("card initialized.");
+  SD.remove(fileName);
+  printStats();
+
+  // sequential write, time each write() and flush()
+  File file = SD.open(fileName, FILE_WRITE);
+  if (!file) {
+    Serial.println("error opening bench.dat");
+    return;
+  }
+  for (uint16_t i = 0; i < BUF_SIZE; i++) buf[i] = i;
+  clearHistogram(writeTimes);
+  clearHistogram(flushTimes);
+  uint32_t n = 0;
+  uint32_t t0 = micros();
+  for (uint32_t pos = 0; pos < FILE_SIZE; pos += BUF_SIZE) {
+    uint32_t t = micros();
+    if (file.write(buf, BUF_SIZE) != BUF_SIZE) {
+      Serial.println("write failed");
+      file.close();
+      return;
+    }
+    addTime(writeTimes, micros() - t);
+    if (++n % FLUSH_WRITES == 0) {
+      t = micros();
+      file.flush();
+      addTime(flushTimes, micros() - t);
+    }
+  }
+  file.close();
+  printRate("write", FILE_SIZE, micros() - t0);
+  printHistogram("write()", writeTimes);
+  printHistogram("flush()", flushTimes);
+  printStats();
+
+  // sequential read
+  file = SD.open(fileName);
+  t0 = micros();
+  uint32_t total = 0;
+  int16_t count;
+  while ((count = file.read(buf, BUF_SIZE)) > 0) total += count;
+  printRate("read", total, micros() - t0);
+  if (total != FILE_SIZE) Serial.println("read failed");
+  printStats();
+
+  // random block reads, without copying the data
+  uint32_t blocks = FILE_SIZE / 512;
+  t0 = micros();
+  for (uint16_t i = 0; i < RANDOM_READS; i++) {
+    const uint8_t *data;
+    file.seek(512 * random(blocks));
+    if (file.readPtr(&data, 512) != 512) {
+      Serial.println("random read failed");
+      break;
+    }
+  }
+  uint32_t us = micros() - t0;
+  file.close();
+  Serial.print("random 512 byte reads per second: ");
+  Serial.println(RANDOM_READS * 1000000.0 / us);
+  printStats();
+
+  // open and close
+  t0 = micros();
+  for (uint16_t i = 0; i < OPENS; i++) {
+    file = SD.open(fileName);
+    if (!file) {
+      Serial.println("open failed");
+      break;
+    }
+    file.close();
+  }
+  us = micros() - t0;
+  Serial.print("open/close per second: ");
+  Serial.println(OPENS * 1000000.0 / us);
+  printStats();
+
+  Serial.println("done");
+}
+
+void loop()
+{
+  // nothing happens after setup
+}
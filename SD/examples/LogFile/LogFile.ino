@@ -0,0 +1,87 @@
+/*
+  SD card low latency datalogger
+ 
+ This example logs three analog sensors every 10 ms to a
+ pre-allocated log file.  The file is created with its maximum
+ size and erased by SD.openLog(), so each write takes at most
+ the time of one block write to the card.  After 10 seconds the
+ file is closed, it is truncated to the logged data.
+ 	
+ The circuit:
+ * analog sensors on analog ins 0, 1, and 2
+ * SD card attached to SPI bus as follows:
+ ** MOSI - pin 11
+ ** MISO - pin 12
+ ** CLK - pin 13
+ ** CS - pin 4
+ 
+ This example code is in the public domain.
+ 	 
+ */
+
+#include <SD.h>
+
+// On the Ethernet Shield, CS is pin 4. Note that even if it's not
+// used as the CS pin, the hardware CS pin (10 on most Arduino boards,
+// 53 on the Mega) must be left as an output or the SD library
+// functions will not work.
+const int chipSelect = 4;
+
+// one record, 8 bytes
+struct Record {
+  unsigned long time;
+  int value[3];
+};
+
+LogFile logFile;
+unsigned long nextTime;
+unsigned long stopTime;
+
+void setup()
+{
+ // Open serial communications and wait for port to open:
+  Serial.begin(9600);
+   while (!Serial) {
+    ; // wait for serial port to connect. Needed for Leonardo only
+  }
+
+  Serial.print("Initializing SD card...");
+  pinMode(10, OUTPUT);
+  if (!SD.begin(chipSelect)) {
+    Serial.println("Card failed, or not present");
+    return;
+  }
+  Serial.println("card initialized.");
+
+  // 1000 records per 10 seconds, the file must not exist
+  SD.remove("datalog.bin");
+  if (!SD.openLog(logFile, "datalog.bin", 1000UL * sizeof(Record))) {
+    Serial.println("error creating datalog.bin");
+    return;
+  }
+  nextTime = millis();
+  stopTime = nextTime + 10000;
+}
+
+void loop()
+{
+  if (!logFile || (long)(millis() - nextTime) < 0) return;
+  nextTime += 10;
+
+  Record r;
+  r.time = micros();
+  for (int analogPin = 0; analogPin < 3; analogPin++) {
+    r.value[analogPin] = analogRead(analogPin);
+  }
+  logFile.write((const uint8_t *)&r, sizeof(r));
+
+  if ((long)(millis() - stopTime) >= 0) {
+    Serial.print("bytes logged: ");
+    Serial.println(logFile.size());
+    Serial.print("max block write us: ");
+    Serial.println(logFile.latencyMax());
+    Serial.print("avg block write us: ");
+    Serial.println(logFile.latencyAvg());
+    logFile.close();
+  }
+}
@@ -0,0 +1,62 @@
+// Host build shim for the SD library tests (see fakecard.cpp).
+// Only what the library and its examples use is declared here.
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+
+#ifndef RAMEND
+#define RAMEND 0x8FF // ATmega328P, 2 KB RAM
+#endif
+
+#define LOW    0
+#define HIGH   1
+#define INPUT  0
+#define OUTPUT 1
+
+#define DEC 10
+#define HEX 16
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+// provided by fakecard.cpp
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+long random(long howbig);
+
+#include "Stream.h"
+
+// writes to stdout
+class HardwareSerial : public Stream {
+ public:
+  void begin(unsigned long baud) {}
+  size_t write(uint8_t c);
+  using Print::write;
+  int available(void) { return 0; }
+  int read(void) { return -1; }
+  int peek(void) { return -1; }
+  void flush(void) {}
+  operator bool() { return true; }
+};
+
+extern HardwareSerial Serial;
+
+// heap use of the library is counted, see soak.cpp
+void* hostMalloc(size_t size);
+void hostFree(void* ptr);
+#define malloc(size) hostMalloc(size)
+#define free(ptr) hostFree(ptr)
+
+#endif
@@ -0,0 +1,55 @@
+// Host build shim for the SD library tests (see fakecard.cpp).
+
+#ifndef Print_h
+#define Print_h
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+class Print {
+ private:
+  int write_error;
+ protected:
+  void setWriteError(int err = 1) { write_error = err; }
+ public:
+  Print() : write_error(0) {}
+  virtual ~Print() {}
+  int getWriteError() { return write_error; }
+  void clearWriteError() { setWriteError(0); }
+
+  virtual size_t write(uint8_t) = 0;
+  size_t write(const char* str) { return write((const uint8_t*) str, strlen(str)); }
+  virtual size_t write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while (size--) n += write(*buffer++);
+    return n;
+  }
+
+  size_t print(const char* s) { return write(s); }
+  size_t print(char c) { return write((uint8_t) c); }
+  size_t print(unsigned char n, int base = 10) { return print((unsigned long) n, base); }
+  size_t print(int n, int base = 10) { return print((long) n, base); }
+  size_t print(unsigned int n, int base = 10) { return print((unsigned long) n, base); }
+  size_t print(long n, int base = 10) {
+    char buf[24];
+    snprintf(buf, sizeof(buf), base == 16 ? "%lX" : "%ld", n);
+    return write(buf);
+  }
+  size_t print(unsigned long n, int base = 10) {
+    char buf[24];
+    snprintf(buf, sizeof(buf), base == 16 ? "%lX" : "%lu", n);
+    return write(buf);
+  }
+  size_t print(double n, int digits = 2) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.*f", digits, n);
+    return write(buf);
+  }
+
+  size_t println(void) { return write("\r\n"); }
+  template <class T> size_t println(T n) { return print(n) + println(); }
+  template <class T> size_t println(T n, int base) { return print(n, base) + println(); }
+};
+
+#endif
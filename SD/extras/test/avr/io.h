@@ -0,0 +1,33 @@
+// Host build shim for the SD library tests (see fakecard.cpp).
+// The port registers of the ATmega328P pin map in Sd2PinMap.h and the
+// SPI registers used by utility/Sd2Card.cpp.
+
+#ifndef _AVR_IO_H_
+#define _AVR_IO_H_
+
+#include <stdint.h>
+
+extern volatile uint8_t DDRB, PINB, PORTB;
+extern volatile uint8_t DDRC, PINC, PORTC;
+extern volatile uint8_t DDRD, PIND, PORTD;
+
+// writing SPDR clocks one byte to the simulated card, reading it
+// returns the byte received from the card
+struct SpiDataRegister {
+  uint8_t received;
+  SpiDataRegister& operator=(uint8_t b);
+  operator uint8_t() const { return received; }
+};
+
+extern SpiDataRegister SPDR;
+// SPIF is always set, a transfer is done when the SPDR write returns
+extern volatile uint8_t SPCR, SPSR;
+
+#define SPIF  7
+#define SPE   6
+#define MSTR  4
+#define SPR1  1
+#define SPR0  0
+#define SPI2X 0
+
+#endif
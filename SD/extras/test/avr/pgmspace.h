@@ -0,0 +1,14 @@
+// Host build shim for the SD library tests (see fakecard.cpp).
+
+#ifndef _AVR_PGMSPACE_H_
+#define _AVR_PGMSPACE_H_
+
+#include <stdint.h>
+
+#define PROGMEM
+#define PGM_P const char*
+#define PSTR(s) (s)
+#define pgm_read_byte(addr) (*(const uint8_t*) (addr))
+#define pgm_read_word(addr) (*(const uint16_t*) (addr))
+
+#endif
@@ -0,0 +1,174 @@
+/* SD library host tests - Benchmark example on the simulated card
+ *
+ * Runs examples/Benchmark/Benchmark.ino unchanged against fakecard.cpp,
+ * so the example and the card counters can be checked without hardware
+ * and the effect of card latency on the library can be compared.  The
+ * card's timing is set from the command line, all times in microseconds:
+ *   -a us     access time of a read command (800)
+ *   -n us     time to the next block of a multiple block read (100)
+ *   -w us     programming time of a written block (250)
+ *   -s n,us   every n-th block write takes us instead (64,20000)
+ *   -c us     SPI transfer time of a byte (1)
+ *   -H        SDHC card, block addresses instead of byte addresses
+ *   -f image  use a FAT16 or FAT32 card image file instead of a new
+ *             16 MB FAT16 volume, -o image saves the card afterwards
+ * After the example, 64 blocks near the end of the card are read and
+ * written back with Sd2Card's single block calls and with readBlocks()
+ * and writeBlocks(), and the SPI bytes and time per KB are printed for
+ * each.  The times printed are simulated, see fakecard.cpp.  The exit
+ * status is nonzero if the library broke a card protocol rule or a block
+ * transfer failed.
+ *
+ * Build and run from this directory; RAMEND of an ATmega2560 turns the
+ * card counters (SD_CARD_STATS) on:
+ *   g++ -O2 -Wall -Wno-address-of-packed-member -fpack-struct \
+ *     -DRAMEND=0x21FF -I. -I../.. -I../../utility -o bench bench.cpp \
+ *     fakecard.cpp ../../SD.cpp ../../File.cpp ../../LogFile.cpp \
+ *     ../../utility/SdFile.cpp ../../utility/SdVolume.cpp \
+ *     ../../utility/Sd2Card.cpp
+ *   ./bench -a 1500 -w 400
+ */
+#include <stdio.h>
+#include <unistd.h>
+#include "Arduino.h"
+#include "fakecard.h"
+
+#include "../../examples/Benchmark/Benchmark.ino"
+
+const uint8_t IO_BLOCKS = 64;
+static uint8_t ioData[IO_BLOCKS][512];
+static uint8_t ioCheck[IO_BLOCKS][512];
+static sd_block_io_t ioList[IO_BLOCKS];
+static int ioFailures = 0;
+
+// list of IO_BLOCKS blocks from first, in runs of run blocks with a gap
+// of run blocks between them
+static void makeList(uint32_t first, uint8_t run, uint8_t (*data)[512]) {
+  for (uint8_t i = 0; i < IO_BLOCKS; i++) {
+    ioList[i].block = first + (i / run) * 2 * run + i % run;
+    ioList[i].data = data[i];
+  }
+}
+
+static unsigned long ioBytes;
+static unsigned long ioMicros;
+
+static void ioStart(Sd2Card* card) {
+#if SD_CARD_STATS
+  card->clearStats();
+#endif  // SD_CARD_STATS
+  ioBytes = cardSpiBytes;
+  ioMicros = micros();
+}
+
+static void ioDone(Sd2Card* card, const char* name, uint8_t ok) {
+  unsigned long us = micros() - ioMicros;
+  unsigned long kb = IO_BLOCKS / 2;
+  printf("  %-26s %5lu SPI bytes/KB, %5lu us/KB", name,
+         (cardSpiBytes - ioBytes) / kb, us / kb);
+#if SD_CARD_STATS
+  printf(", %3lu commands", (unsigned long) card->stats()->commands);
+#endif  // SD_CARD_STATS
+  printf("%s\n", ok ? "" : ", FAILED");
+  if (!ok) ioFailures++;
+}
+
+static void checkData(const char* what) {
+  if (memcmp(ioData, ioCheck, sizeof(ioData))) {
+    printf("  %s: data differs\n", what);
+    ioFailures++;
+  }
+}
+
+// single block calls against readBlocks() and writeBlocks()
+static void blockIo(void) {
+  Sd2Card* card = SdVolume::sdCard();
+  if (card->cardSize() != cardBlocks) {
+    printf("cardSize() %lu, card has %lu blocks\n",
+           (unsigned long) card->cardSize(), (unsigned long) cardBlocks);
+    ioFailures++;
+  }
+  uint32_t first = cardBlocks - 4 * IO_BLOCKS;
+  printf("block I/O, %u blocks from block %lu:\n", IO_BLOCKS,
+         (unsigned long) first);
+  for (uint8_t run = IO_BLOCKS; run >= 4; run /= 4) {
+    char name[32];
+    uint8_t ok = true;
+    makeList(first, run, ioData);
+    ioStart(card);
+    for (uint8_t i = 0; ok && i < IO_BLOCKS; i++) {
+      ok = card->readBlock(ioList[i].block, ioList[i].data);
+    }
+    snprintf(name, sizeof(name), "readBlock(), runs of %u", run);
+    ioDone(card, name, ok);
+
+    makeList(first, run, ioCheck);
+    ioStart(card);
+    ok = card->readBlocks(ioList, IO_BLOCKS);
+    snprintf(name, sizeof(name), "readBlocks(), runs of %u", run);
+    ioDone(card, name, ok);
+    checkData("readBlocks()");
+  }
+  // write the blocks back unchanged
+  makeList(first, IO_BLOCKS, ioData);
+  uint8_t ok = true;
+  ioStart(card);
+  for (uint8_t i = 0; ok && i < IO_BLOCKS; i++) {
+    ok = card->writeBlock(ioList[i].block, ioList[i].data);
+  }
+  ioDone(card, "writeBlock(), runs of 64", ok);
+  ioStart(card);
+  ioDone(card, "writeBlocks(), runs of 64",
+         card->writeBlocks(ioList, IO_BLOCKS));
+  makeList(first, IO_BLOCKS, ioCheck);
+  if (!card->readBlocks(ioList, IO_BLOCKS)) ioFailures++;
+  checkData("writeBlocks()");
+}
+
+int main(int argc, char** argv) {
+  const char* image = 0;
+  const char* output = 0;
+  int c;
+  while ((c = getopt(argc, argv, "a:n:w:s:c:Hf:o:")) != -1) {
+    switch (c) {
+      case 'a': cardModel.accessMicros = atol(optarg); break;
+      case 'n': cardModel.nextBlockMicros = atol(optarg); break;
+      case 'w': cardModel.writeMicros = atol(optarg); break;
+      case 's':
+        if (sscanf(optarg, "%lu,%lu", &cardModel.slowEvery,
+                   &cardModel.slowMicros) != 2) {
+          fprintf(stderr, "-s takes n,us\n");
+          return 2;
+        }
+        break;
+      case 'c': cardModel.spiByteMicros = atol(optarg); break;
+      case 'H': cardModel.highCapacity = true; break;
+      case 'f': image = optarg; break;
+      case 'o': output = optarg; break;
+      default:
+        fprintf(stderr, "usage: %s [-a us] [-n us] [-w us] [-s n,us] [-c us]"
+                " [-H] [-f image] [-o image]\n", argv[0]);
+        return 2;
+    }
+  }
+  if (image && !cardLoad(image)) {
+    fprintf(stderr, "can't read %s\n", image);
+    return 2;
+  }
+  printf("card: access %lu us, next block %lu us, write %lu us, "
+         "every %lu. write %lu us, SPI %lu us/byte%s\n",
+         cardModel.accessMicros, cardModel.nextBlockMicros,
+         cardModel.writeMicros, cardModel.slowEvery, cardModel.slowMicros,
+         cardModel.spiByteMicros, cardModel.highCapacity ? ", SDHC" : "");
+
+  setup();
+  blockIo();
+
+  printf("card protocol errors: %lu, pre-erased blocks lost: %lu\n",
+         cardProtocolErrors, cardPreEraseLost);
+  if (output && !cardSave(output)) {
+    fprintf(stderr, "can't write %s\n", output);
+    return 2;
+  }
+  return cardProtocolErrors || cardPreEraseLost || ioFailures ? 1 : 0;
+}
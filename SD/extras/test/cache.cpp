@@ -0,0 +1,106 @@
+/* SD library host tests - SdVolume block cache on the simulated card
+ *
+ * Writes three 150 KB files in 100 byte writes and reads one of them back
+ * in 100 byte reads, the access pattern that made the FAT block and the
+ * file data block evict each other in a single block cache.  It prints the
+ * FAT and data cache hits and misses and the blocks the card read and
+ * wrote for each part, checks the data read back and checks that both
+ * copies of the FAT are equal.  The exit status is nonzero if any check
+ * fails.
+ *
+ * Build and run from this directory; RAMEND of an ATmega2560 gives the
+ * cache one FAT block and two data blocks and turns the card counters on
+ * (-fpack-struct lays out the FAT structures as on AVR):
+ *   g++ -O2 -Wall -Wno-address-of-packed-member -fpack-struct \
+ *     -DRAMEND=0x21FF -I. -I../.. -I../../utility -o cache cache.cpp \
+ *     fakecard.cpp ../../SD.cpp ../../File.cpp ../../LogFile.cpp \
+ *     ../../utility/SdFile.cpp ../../utility/SdVolume.cpp \
+ *     ../../utility/Sd2Card.cpp
+ *   ./cache
+ * Add -DSD_CACHE_FAT_BLOCKS=0 -DSD_CACHE_DATA_BLOCKS=1 for the single
+ * block cache of a 2 KB board.
+ */
+#include <stdio.h>
+#include "Arduino.h"
+#include <SD.h>
+#include "fakecard.h"
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+  if (!ok) {
+    printf("FAIL: %s\n", what);
+    failures++;
+  }
+}
+
+static uint8_t pattern(uint32_t pos) {
+  return (pos * 7 + (pos >> 9)) & 0XFF;
+}
+
+static void start(void) {
+  SdVolume::cacheClearStats();
+  SdVolume::sdCard()->clearStats();
+}
+
+static void report(const char* what) {
+  const sd_stats_t* stats = SdVolume::sdCard()->stats();
+  printf("%-26s FAT hits %6lu misses %4lu, data hits %6lu misses %4lu, "
+         "card reads %4lu writes %4lu\n", what,
+         (unsigned long) SdVolume::fatCacheHits(),
+         (unsigned long) SdVolume::fatCacheMisses(),
+         (unsigned long) SdVolume::dataCacheHits(),
+         (unsigned long) SdVolume::dataCacheMisses(),
+         (unsigned long) stats->blocksRead,
+         (unsigned long) stats->blocksWritten);
+}
+
+int main() {
+  printf("SD_CACHE_FAT_BLOCKS %d, SD_CACHE_DATA_BLOCKS %d\n",
+         SD_CACHE_FAT_BLOCKS, SD_CACHE_DATA_BLOCKS);
+  check(SD.begin(4), "SD.begin()");
+
+  uint8_t buf[100];
+  start();
+  for (uint8_t k = 0; k < 3; k++) {
+    char name[13];
+    snprintf(name, sizeof(name), "FILE%u.BIN", k);
+    File f = SD.open(name, FILE_WRITE);
+    check(f, "create file");
+    uint32_t size = 150000 + k * 1000UL;
+    for (uint32_t pos = 0; pos < size; pos += sizeof(buf)) {
+      uint8_t n = size - pos < sizeof(buf) ? size - pos : sizeof(buf);
+      for (uint8_t i = 0; i < n; i++) buf[i] = pattern(pos + i);
+      if (f.write(buf, n) != n) {
+        check(false, "write");
+        break;
+      }
+    }
+    f.close();
+  }
+  report("write 3 files, 100 bytes");
+
+  start();
+  File f = SD.open("FILE1.BIN");
+  uint32_t pos = 0, bad = 0;
+  int n;
+  while ((n = f.read(buf, sizeof(buf))) > 0) {
+    for (int i = 0; i < n; i++) {
+      if (buf[i] != pattern(pos + i)) bad++;
+    }
+    pos += n;
+  }
+  f.close();
+  report("read FILE1.BIN, 100 bytes");
+  check(pos == 151000 && bad == 0, "FILE1.BIN reads back as written");
+
+  bpb_t* bpb = &((fbs_t*) cardImage)->bpb;
+  uint8_t* fat = cardImage + 512UL * bpb->reservedSectorCount;
+  check(memcmp(fat, fat + 512UL * bpb->sectorsPerFat16,
+               512UL * bpb->sectorsPerFat16) == 0, "mirror FAT equals the FAT");
+  check(cardProtocolErrors == 0, "card protocol");
+
+  if (failures) printf("%d check(s) failed\n", failures);
+  else printf("all checks passed\n");
+  return failures ? 1 : 0;
+}
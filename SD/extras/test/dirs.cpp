@@ -0,0 +1,151 @@
+/* SD library host tests - opening files in a large directory
+ *
+ * Creates 250 files in one directory of the simulated card, then opens
+ * 300 of them at random and looks up 300 names that don't exist, and
+ * prints the blocks the card read for each part.  These are the lookups
+ * the directory entry cache and the hashed name index speed up.  Then it
+ * removes every 7th file and creates every 14th again, and checks after
+ * each step that every name opens the right file or none, so stale cache
+ * and index entries are caught.  It also checks files in the root
+ * directory and that a removed directory can't be opened.  The exit
+ * status is nonzero if any check fails.
+ *
+ * Build and run from this directory; RAMEND of an ATmega2560 gives 8
+ * cached entries and a 256 entry index and turns the card counters on
+ * (-fpack-struct lays out the FAT structures as on AVR):
+ *   g++ -O2 -Wall -Wno-address-of-packed-member -fpack-struct \
+ *     -DRAMEND=0x21FF -I. -I../.. -I../../utility -o dirs dirs.cpp \
+ *     fakecard.cpp ../../SD.cpp ../../File.cpp ../../LogFile.cpp \
+ *     ../../utility/SdFile.cpp ../../utility/SdVolume.cpp \
+ *     ../../utility/Sd2Card.cpp
+ *   ./dirs
+ * Add -DSD_DIR_CACHE_SIZE=0 -DSD_DIR_INDEX_SIZE=0 to compare with a
+ * linear search.
+ */
+#include <stdio.h>
+#include "Arduino.h"
+#include <SD.h>
+#include "fakecard.h"
+
+const int FILE_COUNT = 250;
+const int LOOKUPS = 300;
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+  if (!ok) {
+    printf("FAIL: %s\n", what);
+    failures++;
+  }
+}
+
+static void start(void) {
+  SdVolume::sdCard()->clearStats();
+}
+
+static void report(const char* what) {
+  printf("%-26s %5lu card block reads\n", what,
+         (unsigned long) SdVolume::sdCard()->stats()->blocksRead);
+}
+
+static void logName(char* path, const char* dir, int k) {
+  snprintf(path, 24, "%sLOG%03d.TXT", dir, k);
+}
+
+static uint8_t create(const char* dir, int k) {
+  char path[24], data[16];
+  logName(path, dir, k);
+  File f = SD.open(path, O_CREAT | O_EXCL | O_WRITE);
+  if (!f) return false;
+  int n = snprintf(data, sizeof(data), "data %d", k);
+  uint8_t ok = f.write((const uint8_t*) data, n) == (size_t) n;
+  f.close();
+  return ok;
+}
+
+// 1 if file k has its data, 0 if it has other data, -1 if it can't be
+// opened
+static int content(const char* dir, int k) {
+  char path[24], data[16], want[16];
+  logName(path, dir, k);
+  File f = SD.open(path);
+  if (!f) return -1;
+  int n = f.read(data, sizeof(data));
+  f.close();
+  int m = snprintf(want, sizeof(want), "data %d", k);
+  return n == m && memcmp(data, want, m) == 0 ? 1 : 0;
+}
+
+int main() {
+  printf("SD_DIR_CACHE_SIZE %d, SD_DIR_INDEX_SIZE %d\n",
+         SD_DIR_CACHE_SIZE, SD_DIR_INDEX_SIZE);
+  check(SD.begin(4), "SD.begin()");
+  char logs[] = "LOGS";
+  check(SD.mkdir(logs), "mkdir LOGS");
+
+  start();
+  int bad = 0;
+  for (int k = 0; k < FILE_COUNT; k++) {
+    if (!create("LOGS/", k)) bad++;
+  }
+  report("create 250, O_EXCL");
+  check(bad == 0, "create files");
+
+  srand(1);
+  bad = 0;
+  start();
+  for (int i = 0; i < LOOKUPS; i++) {
+    if (content("LOGS/", rand() % FILE_COUNT) != 1) bad++;
+  }
+  report("open 300 existing");
+  check(bad == 0, "open existing files");
+
+  bad = 0;
+  start();
+  for (int i = 0; i < LOOKUPS; i++) {
+    char path[24];
+    snprintf(path, sizeof(path), "LOGS/NO%03d.TXT", i);
+    if (SD.exists(path)) bad++;
+  }
+  report("look up 300 missing");
+  check(bad == 0, "missing names not found");
+
+  bad = 0;
+  for (int k = 0; k < FILE_COUNT; k += 7) {
+    char path[24];
+    logName(path, "LOGS/", k);
+    if (!SD.remove(path)) bad++;
+  }
+  for (int k = 0; k < FILE_COUNT; k++) {
+    if (content("LOGS/", k) != (k % 7 ? 1 : -1)) bad++;
+  }
+  check(bad == 0, "removed files are gone, others open");
+
+  bad = 0;
+  for (int k = 0; k < FILE_COUNT; k += 14) {
+    if (!create("LOGS/", k)) bad++;
+  }
+  for (int k = 0; k < FILE_COUNT; k++) {
+    int want = k % 7 && k % 14 ? 1 : (k % 14 ? -1 : 1);
+    if (content("LOGS/", k) != want) bad++;
+  }
+  check(bad == 0, "created again in deleted entries");
+
+  bad = 0;
+  for (int k = 0; k < 20; k++) {
+    if (!create("", k)) bad++;
+  }
+  for (int k = 0; k < 20; k++) {
+    if (content("", k) != 1) bad++;
+  }
+  check(bad == 0, "files in the root directory");
+
+  char empty[] = "EMPTY";
+  check(SD.mkdir(empty) && SD.rmdir(empty), "mkdir and rmdir EMPTY");
+  check(!SD.open(empty), "removed directory can't be opened");
+  check(cardProtocolErrors == 0, "card protocol");
+
+  if (failures) printf("%d check(s) failed\n", failures);
+  else printf("all checks passed\n");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,561 @@
+/* SD library host tests - simulated card
+ *
+ * A model of an SD card on the SPI bus, for builds of the library on a
+ * PC.  utility/Sd2Card.cpp is built unchanged: each write to SPDR (see
+ * avr/io.h) clocks one byte to the card, and the pin driven low by
+ * digitalWrite() selects it.  The card keeps its blocks in RAM, formatted
+ * as a FAT16 or FAT32 volume by cardFormat() or loaded from an image file
+ * by cardLoad(), and answers the commands Sd2Card uses in SPI mode: CMD0,
+ * CMD8, CMD9/CMD10 (registers), CMD12, CMD13, CMD17/CMD18 (reads),
+ * CMD24/CMD25 (writes), CMD32/CMD33/CMD38 (erase), CMD58, ACMD23 and
+ * ACMD41.  It is a standard capacity card with byte addresses, or SDHC
+ * with block addresses if cardModel.highCapacity is set.
+ *
+ * These rules of the protocol are checked and counted in
+ * cardProtocolErrors:
+ * - at least 74 clocks with the card deselected before the first CMD0
+ * - every byte of a response is read before the card is deselected or
+ *   the next command is sent; the response to CMD12 follows a stuff
+ *   byte (0X00 here) that is not part of it
+ * - no command while the card is busy, no command but CMD12 during a
+ *   multiple block read and none during a multiple block write
+ * - no other bytes than 0XFF, commands and data tokens from the host
+ * - block zero is never written
+ * Blocks pre-erased by ACMD23 but not written before the stop token lose
+ * their contents, as the card may erase them; they are counted in
+ * cardPreEraseLost.
+ *
+ * Time is simulated: micros() only advances with the card model below
+ * (SPI bytes, access time, write programming time), by MICROS_COST per
+ * call and with delay() and delayMicroseconds(), so timings show the
+ * card-bound part of an operation, not the CPU time of the library.  A
+ * test models the work of a sketch with delayMicroseconds().  The card
+ * sends 0XFF until a read block is ready and holds the bus at zero while
+ * it is busy programming.
+ *
+ * The build command is at the top of each test.  -fpack-struct lays out
+ * the FAT structures as on AVR, where every member is aligned, so the
+ * warnings about pointers to packed members are turned off.
+ */
+#include <stdio.h>
+#include "Arduino.h"
+#include <SdFat.h>
+#include "fakecard.h"
+
+#undef malloc
+#undef free
+
+SdCardModel cardModel = {1, 800, 100, 250, 64, 20000, 0};
+
+uint8_t* cardImage = 0;
+uint32_t cardBlocks = 0;
+unsigned long cardProtocolErrors = 0;
+unsigned long cardPreEraseLost = 0;
+unsigned long cardSpiBytes = 0;
+
+unsigned long hostMallocCalls = 0;
+long hostHeapBytes = 0;
+
+volatile uint8_t DDRB, PINB, PORTB, DDRC, PINC, PORTC, DDRD, PIND, PORTD;
+volatile uint8_t SPCR, SPSR = 1 << SPIF;
+SpiDataRegister SPDR;
+HardwareSerial Serial;
+
+// the simulated clock, microseconds
+static unsigned long now = 0;
+// a micros() call on a 16 MHz AVR
+static const unsigned long MICROS_COST = 4;
+//------------------------------------------------------------------------------
+// Arduino runtime
+static void cardSelect(uint8_t pin);
+static void cardDeselect(uint8_t pin);
+
+unsigned long micros(void) { return now += MICROS_COST; }
+unsigned long millis(void) { return micros() / 1000; }
+void delay(unsigned long ms) { now += ms * 1000; }
+void delayMicroseconds(unsigned int us) { now += us; }
+void pinMode(uint8_t pin, uint8_t mode) {}
+void digitalWrite(uint8_t pin, uint8_t val) {
+  if (val == LOW) cardSelect(pin);
+  else cardDeselect(pin);
+}
+long random(long howbig) { return howbig ? rand() % howbig : 0; }
+
+size_t HardwareSerial::write(uint8_t c) {
+  if (c != '\r') putchar(c);
+  return 1;
+}
+
+void* hostMalloc(size_t size) {
+  size_t* p = (size_t*) malloc(size + sizeof(size_t));
+  if (!p) return 0;
+  *p = size;
+  hostMallocCalls++;
+  hostHeapBytes += size;
+  return p + 1;
+}
+
+void hostFree(void* ptr) {
+  if (!ptr) return;
+  size_t* p = (size_t*) ptr - 1;
+  hostHeapBytes -= *p;
+  free(p);
+}
+//------------------------------------------------------------------------------
+// card image
+uint8_t cardFormat(uint32_t blocks, uint8_t fatType) {
+  const uint8_t fats = 2;
+  const uint16_t reserved = fatType == 32 ? 32 : 1;
+  const uint16_t rootEntries = fatType == 32 ? 0 : 512;
+  const uint8_t entrySize = fatType / 8;
+  uint8_t spc = 1;
+  if (fatType == 16) {
+    while (blocks / spc > 65000) spc <<= 1;
+  }
+  uint32_t clusters = (blocks - reserved - rootEntries / 16) / spc;
+  uint32_t fatBlocks = ((clusters + 2) * entrySize + 511) / 512;
+  clusters = (blocks - reserved - fats * fatBlocks - rootEntries / 16) / spc;
+  if (fatType == 16 && (clusters < 4085 || clusters > 65524)) return false;
+  if (fatType == 32 && clusters < 65525) return false;
+  if (fatType != 16 && fatType != 32) return false;
+
+  free(cardImage);
+  cardImage = (uint8_t*) calloc(blocks, 512);
+  if (!cardImage) return false;
+  cardBlocks = blocks;
+
+  bpb_t* bpb = &((fbs_t*) cardImage)->bpb;
+  uint8_t* boot = cardImage;
+  boot[0] = 0XEB; boot[1] = fatType == 32 ? 0X58 : 0X3C; boot[2] = 0X90;
+  memcpy(boot + 3, "MSDOS5.0", 8);
+  bpb->bytesPerSector = 512;
+  bpb->sectorsPerCluster = spc;
+  bpb->reservedSectorCount = reserved;
+  bpb->fatCount = fats;
+  bpb->rootDirEntryCount = rootEntries;
+  if (blocks < 0X10000) bpb->totalSectors16 = blocks;
+  else bpb->totalSectors32 = blocks;
+  bpb->mediaType = 0XF8;
+  bpb->sectorsPerTrtack = 32;
+  bpb->headCount = 2;
+  if (fatType == 16) {
+    bpb->sectorsPerFat16 = fatBlocks;
+  } else {
+    // root directory in cluster 2, FSINFO in block 1
+    bpb->sectorsPerFat32 = fatBlocks;
+    bpb->fat32RootCluster = 2;
+    bpb->fat32FSInfo = 1;
+    fsinfo_t* fsi = (fsinfo_t*) (cardImage + 512);
+    fsi->leadSignature = FSINFO_LEAD_SIG;
+    fsi->structSignature = FSINFO_STRUCT_SIG;
+    fsi->freeCount = clusters - 1;
+    fsi->nextFree = 3;
+    fsi->tailSignature[2] = 0X55; fsi->tailSignature[3] = 0XAA;
+  }
+  boot[510] = 0X55; boot[511] = 0XAA;
+
+  for (uint8_t i = 0; i < fats; i++) {
+    uint8_t* fat = cardImage + 512UL * (reserved + i * fatBlocks);
+    memset(fat, 0XFF, 3 * entrySize);
+    fat[0] = 0XF8;
+    if (fatType == 32) {
+      fat[3] = fat[7] = fat[11] = 0X0F;
+    }
+  }
+  return true;
+}
+
+uint8_t cardLoad(const char* path) {
+  FILE* fp = fopen(path, "rb");
+  if (!fp) return false;
+  fseek(fp, 0, SEEK_END);
+  long size = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+  free(cardImage);
+  cardImage = (uint8_t*) malloc(size);
+  cardBlocks = cardImage ? size / 512 : 0;
+  uint8_t ok = cardImage && fread(cardImage, 512, cardBlocks, fp) == cardBlocks;
+  fclose(fp);
+  return ok;
+}
+
+uint8_t cardSave(const char* path) {
+  FILE* fp = fopen(path, "wb");
+  if (!fp) return false;
+  uint8_t ok = fwrite(cardImage, 512, cardBlocks, fp) == cardBlocks;
+  return fclose(fp) == 0 && ok;
+}
+//------------------------------------------------------------------------------
+// card model
+enum {
+  CARD_IDLE,        // waiting for a command
+  CARD_READ,        // CMD17
+  CARD_READ_MULTI,  // CMD18 until CMD12
+  CARD_WRITE,       // CMD24
+  CARD_WRITE_MULTI  // CMD25 until the stop token
+};
+
+static uint8_t selectPin = 0XFF;    // pin that selects the card, 0XFF none
+static uint8_t spiMode = false;     // CMD0 received
+static uint8_t idle = true;         // R1 idle bit, until ACMD41 is done
+static uint8_t appCommand = false;  // last command was CMD55
+static uint8_t acmd41Count = 0;
+static unsigned long deselectedClocks = 0;
+
+static uint8_t command[6];          // command received so far
+static uint8_t commandLength = 0;
+static uint8_t response[32];        // response still to be sent
+static uint8_t responseLength = 0;
+static uint8_t responseIndex = 0;
+
+static uint8_t state = CARD_IDLE;
+static uint32_t block;              // block of the current data transfer
+static int16_t dataIndex = -1;      // byte of the block, -1 before the token
+static uint8_t dataResponse = false;  // a written block is to be answered
+static uint8_t writeBuffer[512];
+static uint32_t preErase = 0;       // ACMD23 count for the next CMD25
+static uint32_t eraseEnd = 0;       // end of the blocks pre-erased for CMD25
+static uint32_t eraseFirst = 0;     // CMD32
+static uint32_t eraseLast = 0;      // CMD33
+
+static unsigned long readyAt;       // read data available at this time
+static unsigned long busyUntil;     // busy programming until this time
+static unsigned long writeCount;    // for the slow write every slowEvery blocks
+
+static void protocolError(const char* what) {
+  fprintf(stderr, "card: %s\n", what);
+  cardProtocolErrors++;
+}
+
+static void respond(const uint8_t* data, uint8_t n) {
+  memcpy(response + responseLength, data, n);
+  responseLength += n;
+}
+
+static void respond(uint8_t b) {
+  respond(&b, 1);
+}
+
+static uint8_t responsePending(void) {
+  return responseIndex < responseLength;
+}
+
+static unsigned long program(void) {
+  unsigned long t = cardModel.writeMicros;
+  if (cardModel.slowEvery && ++writeCount % cardModel.slowEvery == 0) {
+    t = cardModel.slowMicros;
+  }
+  return t;
+}
+
+// CSD register for the size of the image
+static void cardCsd(csd_t* csd) {
+  memset(csd, 0, sizeof(*csd));
+  if (cardModel.highCapacity) {
+    uint32_t c_size = cardBlocks / 1024 - 1;
+    csd->v2.csd_ver = 1;
+    csd->v2.read_bl_len = 9;
+    csd->v2.c_size_high = c_size >> 16;
+    csd->v2.c_size_mid = c_size >> 8;
+    csd->v2.c_size_low = c_size;
+    csd->v2.erase_blk_en = 1;
+  } else {
+    // (c_size + 1) << (c_size_mult + 2) blocks of 512 bytes
+    uint8_t mult = 0;
+    while (mult < 7 && (cardBlocks >> (mult + 2)) > 4096) mult++;
+    uint16_t c_size = (cardBlocks >> (mult + 2)) - 1;
+    csd->v1.read_bl_len = 9;
+    csd->v1.c_size_high = c_size >> 10;
+    csd->v1.c_size_mid = c_size >> 2;
+    csd->v1.c_size_low = c_size;
+    csd->v1.c_size_mult_high = mult >> 1;
+    csd->v1.c_size_mult_low = mult;
+    csd->v1.erase_blk_en = 1;
+  }
+  csd->v1.always1 = 1;
+}
+
+// block number of a command argument, false if it is out of range
+static uint8_t cardAddress(uint32_t arg, uint32_t* blockNumber) {
+  if (!cardModel.highCapacity) {
+    if (arg & 0X1FF) return false;
+    arg >>= 9;
+  }
+  *blockNumber = arg;
+  return arg < cardBlocks;
+}
+
+// pre-erased blocks not written by a CMD25 lose their contents
+static void writeMultipleEnd(void) {
+  for (; block < eraseEnd; block++) {
+    memset(cardImage + 512UL * block, 0XA5, 512);
+    cardPreEraseLost++;
+  }
+  state = CARD_IDLE;
+}
+
+static void cardCommand(void) {
+  uint8_t cmd = command[0] & 0X3F;
+  uint32_t arg = (uint32_t) command[1] << 24 | (uint32_t) command[2] << 16
+                 | (uint32_t) command[3] << 8 | command[4];
+  uint8_t crc = command[5];
+  uint8_t acmd = appCommand;
+  appCommand = false;
+
+  if (state == CARD_READ_MULTI && cmd != CMD12) {
+    protocolError("command during a multiple block read");
+    state = CARD_IDLE;
+  }
+  if (cmd == CMD0) {
+    if (!spiMode && deselectedClocks < 10) {
+      protocolError("less than 74 clocks before CMD0");
+    }
+    if (crc != 0X95) {
+      respond(R1_IDLE_STATE | 0X08);  // CRC error
+      return;
+    }
+    spiMode = idle = true;
+    acmd41Count = 0;
+    state = CARD_IDLE;
+    if (!cardImage) cardFormat(32768);
+  }
+  // no response in SD mode
+  if (!spiMode) return;
+  uint8_t r1 = idle ? R1_IDLE_STATE : R1_READY_STATE;
+
+  if (acmd && cmd == ACMD41) {
+    idle = ++acmd41Count < 2;
+    respond(idle ? R1_IDLE_STATE : R1_READY_STATE);
+    return;
+  }
+  if (acmd && cmd == ACMD23) {
+    preErase = arg & 0X7FFFFF;
+    respond(r1);
+    return;
+  }
+  switch (cmd) {
+    case CMD0:
+      respond(r1);
+      break;
+
+    case CMD8: {
+      if (crc != 0X87) {
+        respond(r1 | 0X08);
+        break;
+      }
+      uint8_t r7[] = {r1, 0, 0, (uint8_t) (arg >> 8), (uint8_t) arg};
+      respond(r7, sizeof(r7));
+      break;
+    }
+
+    case CMD9:
+    case CMD10: {
+      csd_t reg;
+      if (cmd == CMD9) cardCsd(&reg);
+      else memset(&reg, 0, sizeof(reg));
+      uint8_t token[] = {r1, 0XFF, DATA_START_BLOCK};
+      respond(token, sizeof(token));
+      respond((const uint8_t*) &reg, 16);
+      respond(0XFF);
+      respond(0XFF);
+      break;
+    }
+
+    case CMD12: {
+      if (state != CARD_READ_MULTI) {
+        protocolError("CMD12 without a multiple block read");
+      }
+      state = CARD_IDLE;
+      uint8_t stuff[] = {0X00, 0XFF, r1};
+      respond(stuff, sizeof(stuff));
+      break;
+    }
+
+    case CMD13: {
+      uint8_t r2[] = {r1, 0};
+      respond(r2, sizeof(r2));
+      break;
+    }
+
+    case CMD17:
+    case CMD18:
+      if (!cardAddress(arg, &block)) {
+        respond(r1 | 0X40);  // parameter error
+        break;
+      }
+      state = cmd == CMD17 ? CARD_READ : CARD_READ_MULTI;
+      dataIndex = -1;
+      readyAt = now + cardModel.accessMicros;
+      respond(r1);
+      break;
+
+    case CMD24:
+    case CMD25:
+      if (!cardAddress(arg, &block)) {
+        respond(r1 | 0X40);
+        break;
+      }
+      if (block == 0) protocolError("write to block zero");
+      state = cmd == CMD24 ? CARD_WRITE : CARD_WRITE_MULTI;
+      dataIndex = -1;
+      eraseEnd = 0;
+      if (cmd == CMD25 && preErase) {
+        eraseEnd = block + preErase;
+        if (eraseEnd > cardBlocks) eraseEnd = cardBlocks;
+      }
+      preErase = 0;
+      respond(r1);
+      break;
+
+    case CMD32:
+    case CMD33:
+      if (!cardAddress(arg, cmd == CMD32 ? &eraseFirst : &eraseLast)) {
+        respond(r1 | 0X40);
+        break;
+      }
+      respond(r1);
+      break;
+
+    case CMD38:
+      if (eraseFirst == 0 || eraseFirst > eraseLast) {
+        respond(r1 | 0X10);  // erase sequence error
+        break;
+      }
+      memset(cardImage + 512UL * eraseFirst, 0,
+             512UL * (eraseLast - eraseFirst + 1));
+      eraseFirst = eraseLast = 0;
+      busyUntil = now + cardModel.writeMicros;
+      respond(r1);
+      break;
+
+    case CMD55:
+      appCommand = true;
+      respond(r1);
+      break;
+
+    case CMD58: {
+      uint8_t r3[] = {r1, (uint8_t) (cardModel.highCapacity ? 0XC0 : 0X80),
+                      0XFF, 0X80, 0};
+      respond(r3, sizeof(r3));
+      break;
+    }
+
+    default:
+      respond(r1 | R1_ILLEGAL_COMMAND);
+      break;
+  }
+}
+
+// the byte the card sends while the host sends one
+static uint8_t cardOutput(void) {
+  if (responsePending()) return response[responseIndex++];
+  if (now < busyUntil) return 0;
+  if (dataResponse) {
+    dataResponse = false;
+    busyUntil = now + program();
+    return DATA_RES_ACCEPTED;
+  }
+  if (state != CARD_READ && state != CARD_READ_MULTI) return 0XFF;
+  if (dataIndex < 0) {
+    if (block >= cardBlocks) return 0X08;  // out of range error token
+    if (now < readyAt) return 0XFF;
+    dataIndex = 0;
+    return DATA_START_BLOCK;
+  }
+  uint8_t b = dataIndex < 512 ? cardImage[512UL * block + dataIndex] : 0XFF;
+  if (++dataIndex == 514) {
+    // CRC sent, the card looks for the next block of a CMD18
+    if (state == CARD_READ) state = CARD_IDLE;
+    block++;
+    dataIndex = -1;
+    readyAt = now + cardModel.nextBlockMicros;
+  }
+  return b;
+}
+
+// a byte from the host during a write command
+static void cardWriteInput(uint8_t b) {
+  if (dataIndex >= 0) {
+    if (dataIndex < 512) writeBuffer[dataIndex] = b;
+    if (++dataIndex == 514) {
+      memcpy(cardImage + 512UL * block++, writeBuffer, 512);
+      dataIndex = -1;
+      dataResponse = true;
+      if (state == CARD_WRITE) state = CARD_IDLE;
+    }
+    return;
+  }
+  if (b == 0XFF) return;
+  if (now < busyUntil) protocolError("data token while busy");
+  if (state == CARD_WRITE && b == DATA_START_BLOCK) {
+    dataIndex = 0;
+  } else if (state == CARD_WRITE_MULTI && b == WRITE_MULTIPLE_TOKEN) {
+    if (block < cardBlocks) dataIndex = 0;
+    else protocolError("write past the end of the card");
+  } else if (state == CARD_WRITE_MULTI && b == STOP_TRAN_TOKEN) {
+    writeMultipleEnd();
+  } else if ((b & 0XC0) == 0X40) {
+    protocolError(state == CARD_WRITE_MULTI ?
+                  "command during a multiple block write" :
+                  "command instead of the data token");
+    if (state == CARD_WRITE_MULTI) writeMultipleEnd();
+    state = CARD_IDLE;
+    command[0] = b;
+    commandLength = 1;
+  } else {
+    protocolError("unexpected byte during a write");
+  }
+}
+
+// one byte on the bus: the host sends in, the card answers
+static uint8_t cardClock(uint8_t in) {
+  now += cardModel.spiByteMicros;
+  cardSpiBytes++;
+  if (selectPin == 0XFF) {
+    deselectedClocks++;
+    return 0XFF;
+  }
+  uint8_t out = cardOutput();
+  if (commandLength) {
+    command[commandLength++] = in;
+    if (commandLength == 6) {
+      commandLength = 0;
+      responseLength = responseIndex = 0;
+      cardCommand();
+      // one byte of Ncr before the response, CMD12 has its stuff byte
+      if (responseLength && (command[0] & 0X3F) != CMD12) {
+        memmove(response + 1, response, responseLength++);
+        response[0] = 0XFF;
+      }
+    }
+  } else if ((state == CARD_WRITE || state == CARD_WRITE_MULTI)
+             && !responsePending()) {
+    cardWriteInput(in);
+  } else if ((in & 0XC0) == 0X40) {
+    if (responsePending()) protocolError("response not read");
+    if (now < busyUntil) protocolError("command while busy");
+    command[0] = in;
+    commandLength = 1;
+  } else if (in != 0XFF) {
+    protocolError("unexpected byte");
+  }
+  return out;
+}
+
+static void cardSelect(uint8_t pin) {
+  selectPin = pin;
+}
+
+static void cardDeselect(uint8_t pin) {
+  if (pin != selectPin) return;
+  selectPin = 0XFF;
+  if (commandLength) protocolError("deselected during a command");
+  if (responsePending()) protocolError("response not read");
+  commandLength = 0;
+  responseLength = responseIndex = 0;
+}
+
+SpiDataRegister& SpiDataRegister::operator=(uint8_t b) {
+  received = cardClock(b);
+  return *this;
+}
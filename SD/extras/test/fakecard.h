@@ -0,0 +1,34 @@
+/* SD library host tests - simulated card, see fakecard.cpp */
+#ifndef fakecard_h
+#define fakecard_h
+#include <stdint.h>
+
+/** Card timing, all times in microseconds */
+struct SdCardModel {
+  unsigned long spiByteMicros;    // SPI transfer of one byte
+  unsigned long accessMicros;     // first block of a read command
+  unsigned long nextBlockMicros;  // following blocks of a multiple block read
+  unsigned long writeMicros;      // programming a written block
+  unsigned long slowEvery;        // every slowEvery-th block write (0 = none)
+  unsigned long slowMicros;       // takes slowMicros instead
+  uint8_t highCapacity;           // SDHC: block addresses, CSD version 2
+};
+
+extern SdCardModel cardModel;
+extern uint8_t* cardImage;
+extern uint32_t cardBlocks;
+extern unsigned long cardProtocolErrors;
+extern unsigned long cardPreEraseLost;
+// bytes clocked over SPI since the program started
+extern unsigned long cardSpiBytes;
+
+// malloc() calls and bytes allocated by the library
+extern unsigned long hostMallocCalls;
+extern long hostHeapBytes;
+
+// a new, empty volume with fatType 16 or 32
+uint8_t cardFormat(uint32_t blocks, uint8_t fatType = 16);
+uint8_t cardLoad(const char* path);
+uint8_t cardSave(const char* path);
+
+#endif  // fakecard_h
@@ -0,0 +1,163 @@
+/* SD library host tests - cluster allocation on nearly full volumes
+ *
+ * Formats the simulated card as FAT16 (32695 clusters) or FAT32 (137780
+ * clusters), marks 95% of the clusters in use with a free cluster
+ * left every HOLE_EVERY clusters, the way a card looks after many files
+ * were written and some removed, and points the FAT32 FSINFO next free
+ * hint at the start of the volume.  Then it creates 40 files of 1500
+ * bytes, removing one of them after every tenth, and prints the blocks the
+ * card read for it.  It checks that the files read back as written, that
+ * both copies of the FAT are equal and that the FSINFO hint was moved to
+ * the clusters in use now.  The exit status is nonzero if
+ * any check fails.
+ *
+ * Build and run from this directory; RAMEND of an ATmega2560 turns the
+ * free cluster map and the card counters on (-fpack-struct lays out the
+ * FAT structures as on AVR):
+ *   g++ -O2 -Wall -Wno-address-of-packed-member -fpack-struct \
+ *     -DRAMEND=0x21FF -I. -I../.. -I../../utility -o frag frag.cpp \
+ *     fakecard.cpp ../../SD.cpp ../../File.cpp ../../LogFile.cpp \
+ *     ../../utility/SdFile.cpp ../../utility/SdVolume.cpp \
+ *     ../../utility/Sd2Card.cpp
+ *   ./frag 16 && ./frag 32
+ * Add -DSD_FREE_MAP_SIZE=0 to compare without the free cluster map.
+ */
+#include <stdio.h>
+#include "Arduino.h"
+#include <SD.h>
+#include "fakecard.h"
+
+const uint32_t HOLE_EVERY = 4096;
+const uint16_t FILE_SIZE = 1500;
+const uint8_t FILE_COUNT = 40;
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+  if (!ok) {
+    printf("FAIL: %s\n", what);
+    failures++;
+  }
+}
+
+static uint8_t* fat(uint8_t copy) {
+  bpb_t* bpb = &((fbs_t*) cardImage)->bpb;
+  uint32_t fatBlocks = bpb->sectorsPerFat16 ? bpb->sectorsPerFat16
+                                            : bpb->sectorsPerFat32;
+  return cardImage + 512UL * (bpb->reservedSectorCount + copy * fatBlocks);
+}
+
+// mark 95% of the clusters after the root directory in use
+static void fill(uint8_t fatType) {
+  bpb_t* bpb = &((fbs_t*) cardImage)->bpb;
+  uint32_t blocks = bpb->totalSectors16 ? bpb->totalSectors16
+                                        : bpb->totalSectors32;
+  uint32_t fatBlocks = bpb->sectorsPerFat16 ? bpb->sectorsPerFat16
+                                            : bpb->sectorsPerFat32;
+  uint32_t clusters = (blocks - bpb->reservedSectorCount
+    - bpb->fatCount * fatBlocks - bpb->rootDirEntryCount / 16)
+    / bpb->sectorsPerCluster;
+  uint32_t first = fatType == 32 ? 3 : 2;
+  uint32_t used = clusters * 95 / 100;
+  uint32_t marked = 0;
+  for (uint8_t copy = 0; copy < bpb->fatCount; copy++) {
+    uint8_t* f = fat(copy);
+    for (uint32_t c = first; c < first + used; c++) {
+      if ((c - first) % HOLE_EVERY == HOLE_EVERY - 1) continue;
+      if (fatType == 16) {
+        ((uint16_t*) f)[c] = 0XFFFF;
+      } else {
+        ((uint32_t*) f)[c] = 0X0FFFFFFF;
+      }
+      if (copy == 0) marked++;
+    }
+  }
+  if (fatType == 32) {
+    fsinfo_t* fsi = (fsinfo_t*) (cardImage + 512UL * bpb->fat32FSInfo);
+    fsi->freeCount -= marked;
+    fsi->nextFree = first;
+  }
+  printf("FAT%u, %lu clusters, %lu in use\n", fatType,
+         (unsigned long) clusters, (unsigned long) (marked + first - 2));
+}
+
+static void fileName(char* name, uint8_t k) {
+  snprintf(name, 13, "F%u.TXT", k);
+}
+
+static uint8_t content(uint8_t k, uint16_t i) {
+  return 'a' + (k + i) % 26;
+}
+
+static void run(uint8_t fatType, uint32_t blocks) {
+  check(cardFormat(blocks, fatType), "cardFormat()");
+  fill(fatType);
+  check(SD.begin(4), "SD.begin()");
+
+  uint8_t buf[FILE_SIZE];
+  uint8_t removed[FILE_COUNT] = {0};
+  SdVolume::sdCard()->clearStats();
+  for (uint8_t k = 0; k < FILE_COUNT; k++) {
+    char name[13];
+    fileName(name, k);
+    for (uint16_t i = 0; i < FILE_SIZE; i++) buf[i] = content(k, i);
+    File f = SD.open(name, FILE_WRITE);
+    check(f && f.write(buf, FILE_SIZE) == FILE_SIZE, "create file");
+    f.close();
+    if (k % 10 == 9) {
+      fileName(name, k - 5);
+      check(SD.remove(name), "remove file");
+      removed[k - 5] = true;
+    }
+  }
+  printf("  %u files created, %u removed: %lu card block reads, "
+         "%lu writes\n", FILE_COUNT, FILE_COUNT / 10,
+         (unsigned long) SdVolume::sdCard()->stats()->blocksRead,
+         (unsigned long) SdVolume::sdCard()->stats()->blocksWritten);
+
+  uint8_t bad = 0;
+  for (uint8_t k = 0; k < FILE_COUNT; k++) {
+    if (removed[k]) continue;
+    char name[13];
+    fileName(name, k);
+    File f = SD.open(name);
+    if (!f || f.read(buf, FILE_SIZE) != FILE_SIZE) {
+      bad++;
+    } else {
+      for (uint16_t i = 0; i < FILE_SIZE; i++) {
+        if (buf[i] != content(k, i)) {
+          bad++;
+          break;
+        }
+      }
+    }
+    f.close();
+  }
+  check(bad == 0, "files read back as written");
+
+  bpb_t* bpb = &((fbs_t*) cardImage)->bpb;
+  uint32_t fatBlocks = bpb->sectorsPerFat16 ? bpb->sectorsPerFat16
+                                            : bpb->sectorsPerFat32;
+  check(memcmp(fat(0), fat(1), 512UL * fatBlocks) == 0,
+        "mirror FAT equals the FAT");
+  if (fatType == 32) {
+    fsinfo_t* fsi = (fsinfo_t*) (cardImage + 512UL * bpb->fat32FSInfo);
+    printf("  FSINFO next free %lu\n", (unsigned long) fsi->nextFree);
+    check(fsi->nextFree > 3, "FSINFO next free hint written back");
+  }
+}
+
+int main(int argc, char** argv) {
+  uint8_t fatType = argc > 1 ? atoi(argv[1]) : 16;
+  if (fatType != 16 && fatType != 32) {
+    fprintf(stderr, "usage: %s [16|32]\n", argv[0]);
+    return 2;
+  }
+  printf("SD_FREE_MAP_SIZE %d\n", SD_FREE_MAP_SIZE);
+  run(fatType, fatType == 16 ? 131072 : 140000);
+  check(cardProtocolErrors == 0, "card protocol");
+
+  if (failures) printf("%d check(s) failed\n", failures);
+  else printf("all checks passed\n");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,78 @@
+/* SD library host tests - LogFile on the simulated card
+ *
+ * Creates and reads a file, so its blocks are in the SdVolume cache, then
+ * removes it and opens a LogFile, which gets the same clusters again.  The
+ * log is written with multiple block writes that bypass the cache; reading
+ * it back through SD.open() must return the logged data, not the blocks of
+ * the removed file.  The exit status is nonzero if any check fails.
+ *
+ * RAMEND of an ATmega2560 gives the cache a block for file data.
+ *
+ * Build and run from this directory (-fpack-struct lays out the FAT
+ * structures as on AVR):
+ *   g++ -O2 -Wall -Wno-address-of-packed-member -fpack-struct \
+ *     -DRAMEND=0x21FF -I. -I../.. -I../../utility -o logfile logfile.cpp \
+ *     fakecard.cpp ../../SD.cpp ../../File.cpp ../../LogFile.cpp \
+ *     ../../utility/SdFile.cpp ../../utility/SdVolume.cpp \
+ *     ../../utility/Sd2Card.cpp
+ *   ./logfile
+ */
+#include <stdio.h>
+#include "Arduino.h"
+#include <SD.h>
+#include "fakecard.h"
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+  if (!ok) {
+    printf("FAIL: %s\n", what);
+    failures++;
+  }
+}
+
+const uint32_t LOG_SIZE = 16384;
+
+int main() {
+  check(SD.begin(4), "SD.begin()");
+
+  // an old file, read back so its blocks are cached
+  uint8_t buf[512];
+  memset(buf, 'A', sizeof(buf));
+  File old = SD.open("OLD.BIN", FILE_WRITE);
+  for (uint32_t n = 0; n < LOG_SIZE; n += sizeof(buf))
+    old.write(buf, sizeof(buf));
+  old.close();
+  old = SD.open("OLD.BIN");
+  while (old.read() >= 0) {}
+  old.close();
+  char oldName[] = "OLD.BIN";
+  check(SD.remove(oldName), "remove OLD.BIN");
+
+  LogFile log;
+  check(SD.openLog(log, "LOG.BIN", LOG_SIZE), "SD.openLog()");
+  for (uint32_t n = 0; n < LOG_SIZE; n++)
+    log.write((uint8_t) ('a' + n % 26));
+  check(log.size() == LOG_SIZE, "log size");
+  check(log.close(), "close log");
+
+  File in = SD.open("LOG.BIN");
+  check(in && in.size() == LOG_SIZE, "LOG.BIN has the logged size");
+  // last block first: reading in order would push the old blocks out of
+  // the cache before they are reached
+  uint32_t bad = 0;
+  for (uint32_t b = LOG_SIZE; b; b -= 512) {
+    in.seek(b - 512);
+    for (uint32_t n = b - 512; n < b; n++)
+      if (in.read() != (int) ('a' + n % 26)) bad++;
+  }
+  in.close();
+  printf("%lu of %lu bytes read back differ from the log\n",
+         (unsigned long) bad, (unsigned long) LOG_SIZE);
+  check(bad == 0, "log reads back as written");
+  check(cardProtocolErrors == 0, "card protocol");
+
+  if (failures) printf("%d check(s) failed\n", failures);
+  else printf("all checks passed\n");
+  return failures ? 1 : 0;
+}
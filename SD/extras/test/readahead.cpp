@@ -0,0 +1,139 @@
+/* SD library host tests - read-ahead on the simulated card
+ *
+ * Writes two 152000 byte files in turns of one cluster, so each file is
+ * fragmented at every cluster, then reads one of them in order the way a
+ * sketch plays it back, without and with File::readAhead():
+ * - 60 byte read() calls and 3 us of work per byte (BMP rows)
+ * - 512 byte read() calls and 1 ms of work per block (sound)
+ * - readPtr() and 2 us of work per byte
+ * The work is modelled with delayMicroseconds().  For each case it prints
+ * the simulated time, the time spent waiting for the card to find read
+ * data (the stall read-ahead saves) and the commands sent.  It checks the
+ * data read and that read-ahead at least halves the stall of whole block
+ * reads.  The card takes 800 us to find the first block of a read
+ * command and 100 us for each next block, -a and -n change that.  The
+ * exit status is nonzero if any check fails.
+ *
+ * Build and run from this directory; RAMEND of an ATmega2560 gives the
+ * cache one FAT block and two data blocks and turns the card counters on
+ * (-fpack-struct lays out the FAT structures as on AVR):
+ *   g++ -O2 -Wall -Wno-address-of-packed-member -fpack-struct \
+ *     -DRAMEND=0x21FF -I. -I../.. -I../../utility -o readahead readahead.cpp \
+ *     fakecard.cpp ../../SD.cpp ../../File.cpp ../../LogFile.cpp \
+ *     ../../utility/SdFile.cpp ../../utility/SdVolume.cpp \
+ *     ../../utility/Sd2Card.cpp
+ *   ./readahead -a 1500
+ * Add -DSD_CACHE_FAT_BLOCKS=0 -DSD_CACHE_DATA_BLOCKS=1 for the single
+ * block cache of a 2 KB board.
+ */
+#include <stdio.h>
+#include <unistd.h>
+#include "Arduino.h"
+#include <SD.h>
+#include "fakecard.h"
+
+const uint32_t FILE_SIZE = 152000;
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+  if (!ok) {
+    printf("FAIL: %s\n", what);
+    failures++;
+  }
+}
+
+static uint8_t pattern(uint32_t pos) {
+  return (pos * 7 + (pos >> 9)) & 0XFF;
+}
+
+// two files in turns of one cluster
+static void writeFiles(void) {
+  static uint8_t buf[512];
+  File a = SD.open("FRAGA.BIN", FILE_WRITE);
+  File b = SD.open("FRAGB.BIN", FILE_WRITE);
+  check(a && b, "create files");
+  for (uint32_t pos = 0; pos < FILE_SIZE; pos += sizeof(buf)) {
+    uint16_t n = FILE_SIZE - pos < sizeof(buf) ? FILE_SIZE - pos : sizeof(buf);
+    for (uint16_t i = 0; i < n; i++) buf[i] = pattern(pos + i);
+    if (a.write(buf, n) != n || b.write(buf, n) != n) {
+      check(false, "write");
+      break;
+    }
+  }
+  a.close();
+  b.close();
+}
+
+enum { ROWS, BLOCKS, POINTER };
+
+// returns the time spent waiting for read data
+static unsigned long play(uint8_t mode, uint8_t readAhead) {
+  static const char* names[] = {"60 byte reads, 3 us/byte",
+    "512 byte reads, 1 ms/block", "readPtr(), 2 us/byte"};
+  File f = SD.open("FRAGB.BIN");
+  check(f, "open FRAGB.BIN");
+  if (readAhead) check(f.readAhead(), "readAhead()");
+
+  Sd2Card* card = SdVolume::sdCard();
+  card->clearStats();
+  unsigned long start = micros();
+  uint32_t pos = 0, bad = 0;
+  uint8_t buf[512];
+  for (;;) {
+    const uint8_t* p = buf;
+    int n;
+    if (mode == ROWS) n = f.read(buf, 60);
+    else if (mode == BLOCKS) n = f.read(buf, 512);
+    else n = f.readPtr(&p, 512);
+    if (n <= 0) break;
+    for (int i = 0; i < n; i++) {
+      if (p[i] != pattern(pos + i)) bad++;
+    }
+    pos += n;
+    if (mode == ROWS) delayMicroseconds(3 * n);
+    else if (mode == BLOCKS) delayMicroseconds(1000UL * n / 512);
+    else delayMicroseconds(2 * n);
+  }
+  unsigned long us = micros() - start;
+  f.close();
+  const sd_stats_t* stats = card->stats();
+  printf("%-27s read-ahead %-3s %6lu us, stall %6lu us, %4lu commands\n",
+         names[mode], readAhead ? "on" : "off", us,
+         (unsigned long) stats->readWaitMicros,
+         (unsigned long) stats->commands);
+  check(pos == FILE_SIZE && bad == 0, "file reads back as written");
+  return stats->readWaitMicros;
+}
+
+int main(int argc, char** argv) {
+  int c;
+  while ((c = getopt(argc, argv, "a:n:")) != -1) {
+    switch (c) {
+      case 'a': cardModel.accessMicros = atol(optarg); break;
+      case 'n': cardModel.nextBlockMicros = atol(optarg); break;
+      default:
+        fprintf(stderr, "usage: %s [-a us] [-n us]\n", argv[0]);
+        return 2;
+    }
+  }
+  printf("card: access %lu us, next block %lu us; SD_CACHE_FAT_BLOCKS %d, "
+         "SD_CACHE_DATA_BLOCKS %d\n", cardModel.accessMicros,
+         cardModel.nextBlockMicros, SD_CACHE_FAT_BLOCKS,
+         SD_CACHE_DATA_BLOCKS);
+  check(SD.begin(4), "SD.begin()");
+  writeFiles();
+  for (uint8_t mode = ROWS; mode <= POINTER; mode++) {
+    unsigned long stall = play(mode, false);
+    unsigned long stallReadAhead = play(mode, true);
+    // whole block reads gain with any cache size
+    if (mode == BLOCKS) {
+      check(stallReadAhead < stall / 2, "read-ahead stalls less");
+    }
+  }
+  check(cardProtocolErrors == 0, "card protocol");
+
+  if (failures) printf("%d check(s) failed\n", failures);
+  else printf("all checks passed\n");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,82 @@
+/* SD library host tests - File handle soak test
+ *
+ * Opens, copies and closes File objects many times on the simulated card
+ * (fakecard.cpp) and checks that the library never calls malloc() and the
+ * heap doesn't grow: open files use the SD_MAX_FILES slots of the SdFile
+ * pool in File.cpp.  Then it opens files until the pool is used up and
+ * checks that SD.open() fails cleanly and works again after a close().
+ * The exit status is nonzero if any check fails.
+ *
+ * Build and run from this directory (-fpack-struct lays out the FAT
+ * structures as on AVR):
+ *   g++ -O2 -Wall -Wno-address-of-packed-member -fpack-struct \
+ *     -I. -I../.. -I../../utility -o soak soak.cpp fakecard.cpp \
+ *     ../../SD.cpp ../../File.cpp ../../LogFile.cpp \
+ *     ../../utility/SdFile.cpp ../../utility/SdVolume.cpp \
+ *     ../../utility/Sd2Card.cpp
+ *   ./soak [iterations]
+ * Add -DSD_MAX_FILES=n to check another pool size.
+ */
+#include <stdio.h>
+#include "Arduino.h"
+#include <SD.h>
+#include "fakecard.h"
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+  if (!ok) {
+    printf("FAIL: %s\n", what);
+    failures++;
+  }
+}
+
+int main(int argc, char** argv) {
+  long iterations = argc > 1 ? atol(argv[1]) : 100000;
+
+  check(SD.begin(4), "SD.begin()");
+  File w = SD.open("SOAK.TXT", FILE_WRITE);
+  check(w && w.write((const uint8_t*) "hello", 5) == 5, "create SOAK.TXT");
+  w.close();
+
+  unsigned long mallocs = hostMallocCalls;
+  long heap = hostHeapBytes;
+  long bad = 0;
+  for (long i = 0; i < iterations; i++) {
+    File f = SD.open("SOAK.TXT");
+    if (!f || f.read() != 'h') bad++;
+    File g = f;  // copies share the slot
+    if (i % 3 == 0) {
+      File d = SD.open("/");
+      if (!d || !d.isDirectory()) bad++;
+      d.close();
+    }
+    g.close();
+    if (f) bad++;  // closed through the copy
+  }
+  printf("%ld iterations: %ld bad, %lu malloc() calls, heap growth %ld bytes\n",
+         iterations, bad, hostMallocCalls - mallocs, hostHeapBytes - heap);
+  check(bad == 0, "open/read/copy/close");
+  check(hostMallocCalls == mallocs, "no malloc() for open files");
+  check(hostHeapBytes == heap, "no heap growth");
+
+  // use up the pool
+  File files[SD_MAX_FILES + 1];
+  int opened = 0;
+  for (int i = 0; i <= SD_MAX_FILES; i++) {
+    files[i] = SD.open("SOAK.TXT");
+    if (files[i]) opened++;
+  }
+  printf("SD_MAX_FILES %d: %d files opened\n", SD_MAX_FILES, opened);
+  check(opened == SD_MAX_FILES, "SD.open() fails when all slots are in use");
+  files[0].close();
+  File again = SD.open("SOAK.TXT");
+  check(again && again.read() == 'h', "SD.open() works again after close()");
+  again.close();
+  for (int i = 1; i <= SD_MAX_FILES; i++) files[i].close();
+  check(cardProtocolErrors == 0, "card protocol");
+
+  if (failures) printf("%d check(s) failed\n", failures);
+  else printf("all checks passed\n");
+  return failures ? 1 : 0;
+}
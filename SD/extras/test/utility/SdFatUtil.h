@@ -0,0 +1,31 @@
+// Host build shim for SdFatUtil.h (see fakecard.cpp).
+// SD.h includes <utility/SdFatUtil.h>, which finds this file first.  The
+// real FreeRam() casts AVR pointers to int, which doesn't build on a
+// 64-bit host; none of the library code uses it.
+
+#ifndef SdFatUtil_h
+#define SdFatUtil_h
+
+#include <Arduino.h>
+#include <avr/pgmspace.h>
+
+#define PgmPrint(x) SerialPrint_P(PSTR(x))
+#define PgmPrintln(x) SerialPrintln_P(PSTR(x))
+#define NOINLINE __attribute__((noinline,unused))
+#define UNUSEDOK __attribute__((unused))
+
+// RAM is not counted on the host
+static UNUSEDOK int FreeRam(void) {
+  return 0;
+}
+
+static NOINLINE void SerialPrint_P(PGM_P str) {
+  for (uint8_t c; (c = pgm_read_byte(str)); str++) Serial.write(c);
+}
+
+static NOINLINE void SerialPrintln_P(PGM_P str) {
+  SerialPrint_P(str);
+  Serial.println();
+}
+
+#endif
@@ -288,6 +288,44 @@ uint32_t const FAT32MASK = 0X0FFFFFFF;
 /** Type name for fat32BootSector */
 typedef struct fat32BootSector fbs_t;
 //------------------------------------------------------------------------------
+/** Lead signature for a FSINFO sector */
+uint32_t const FSINFO_LEAD_SIG = 0X41615252;
+/** Struct signature for a FSINFO sector */
+uint32_t const FSINFO_STRUCT_SIG = 0X61417272;
+/**
+ * \struct fsInfoSector
+ *
+ * \brief FSINFO sector for a FAT32 volume.
+ *
+ */
+struct fsInfoSector {
+           /** must be 0X52, 0X52, 0X61, 0X41 */
+  uint32_t leadSignature;
+           /** must be zero */
+  uint8_t  reserved1[480];
+           /** must be 0X72, 0X72, 0X41, 0X61 */
+  uint32_t structSignature;
+          /**
+           * Contains the last known free cluster count on the volume.
+           * If the value is 0xFFFFFFFF, then the free count is unknown
+           * and must be computed. Any other value can be used, but is
+           * not necessarily correct.
+           */
+  uint32_t freeCount;
+          /**
+           * This is a hint for the FAT driver. It indicates the cluster
+           * number at which the driver should start looking for free
+           * clusters.  If the value is 0xFFFFFFFF, then there is no hint.
+           */
+  uint32_t nextFree;
+           /** must be zero */
+  uint8_t  reserved2[12];
+           /** must be 0X00, 0X00, 0X55, 0XAA */
+  uint8_t  tailSignature[4];
+};
+/** Type name for FSINFO */
+typedef struct fsInfoSector fsinfo_t;
+//------------------------------------------------------------------------------
 /**
  * \struct directoryEntry
  * \brief FAT short directory entry
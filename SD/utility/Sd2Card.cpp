@@ -96,8 +96,13 @@ uint8_t Sd2Card::cardCommand(uint8_t cmd, uint32_t arg) {
   // select card
   chipSelectLow();
 
-  // wait up to 300 ms if busy
-  waitNotBusy(300);
+  // wait up to 300 ms if busy; not for CMD12, the card is still sending
+  // data of a multiple block read and this would only clock out data bytes
+  if (cmd != CMD12) waitNotBusy(300);
+
+#if SD_CARD_STATS
+  stats_.commands++;
+#endif  // SD_CARD_STATS
 
   // send command
   spiSend(cmd | 0x40);
@@ -111,6 +116,9 @@ uint8_t Sd2Card::cardCommand(uint8_t cmd, uint32_t arg) {
   if (cmd == CMD8) crc = 0X87;  // correct crc for CMD8 with arg 0X1AA
   spiSend(crc);
 
+  // skip the stuff byte sent before the response to CMD12
+  if (cmd == CMD12) spiRec();
+
   // wait for response
   for (uint8_t i = 0; ((status_ = spiRec()) & 0X80) && i != 0XFF; i++);
   return status_;
@@ -150,6 +158,13 @@ void Sd2Card::chipSelectLow(void) {
   digitalWrite(chipSelectPin_, LOW);
 }
 //------------------------------------------------------------------------------
+#if SD_CARD_STATS
+/** Set the counters returned by stats() to zero. */
+void Sd2Card::clearStats(void) {
+  memset(&stats_, 0, sizeof(stats_));
+}
+#endif  // SD_CARD_STATS
+//------------------------------------------------------------------------------
 /** Erase a range of blocks.
  *
  * \param[in] firstBlock The address of the first block in the range.
@@ -213,6 +228,9 @@ uint8_t Sd2Card::eraseSingleBlockEnable(void) {
 uint8_t Sd2Card::init(uint8_t sckRateID, uint8_t chipSelectPin) {
   errorCode_ = inBlock_ = partialBlockRead_ = type_ = 0;
   chipSelectPin_ = chipSelectPin;
+#if SD_CARD_STATS
+  clearStats();
+#endif  // SD_CARD_STATS
   // 16-bit init start time allows over a minute
   uint16_t t0 = (uint16_t)millis();
   uint32_t arg;
@@ -322,6 +340,41 @@ uint8_t Sd2Card::readBlock(uint32_t block, uint8_t* dst) {
   return readData(block, 0, 512, dst);
 }
 //------------------------------------------------------------------------------
+/**
+ * Read the blocks of a scatter list.
+ *
+ * Entries with consecutive block numbers are read with one multiple
+ * block read command, other entries with readBlock().
+ *
+ * \param[in] list Array of block numbers and locations for the data.
+ * \param[in] count Number of entries in \a list.
+ *
+ * \return The value one, true, is returned for success and
+ * the value zero, false, is returned for failure.
+ */
+uint8_t Sd2Card::readBlocks(const sd_block_io_t* list, uint8_t count) {
+  readEnd();
+  for (uint8_t i = 0; i < count;) {
+    // number of entries in this run of consecutive blocks
+    uint8_t n = 1;
+    while ((i + n) < count && list[i + n].block == (list[i].block + n)) n++;
+    if (n == 1) {
+      if (!readBlock(list[i].block, list[i].data)) return false;
+    } else {
+      if (!readStart(list[i].block)) return false;
+      for (uint8_t k = 0; k < n; k++) {
+        if (!readData(list[i + k].data)) {
+          readStop();
+          return false;
+        }
+      }
+      if (!readStop()) return false;
+    }
+    i += n;
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
 /**
  * Read part of a 512 byte block from an SD card.
  *
@@ -419,6 +472,38 @@ void Sd2Card::readEnd(void) {
   }
 }
 //------------------------------------------------------------------------------
+/** Read one data block in a multiple block read sequence
+ *
+ * \param[out] dst Pointer to the location for the 512 byte block.
+ *
+ * \return The value one, true, is returned for success and
+ * the value zero, false, is returned for failure.
+ */
+uint8_t Sd2Card::readData(uint8_t* dst) {
+  chipSelectLow();
+  if (!waitStartBlock()) return false;
+#ifdef OPTIMIZE_HARDWARE_SPI
+  // start first spi transfer
+  SPDR = 0XFF;
+  for (uint16_t i = 0; i < 511; i++) {
+    while (!(SPSR & (1 << SPIF)));
+    dst[i] = SPDR;
+    SPDR = 0XFF;
+  }
+  // wait for last byte
+  while (!(SPSR & (1 << SPIF)));
+  dst[511] = SPDR;
+#else  // OPTIMIZE_HARDWARE_SPI
+  for (uint16_t i = 0; i < 512; i++) {
+    dst[i] = spiRec();
+  }
+#endif  // OPTIMIZE_HARDWARE_SPI
+  spiRec();  // get first crc byte
+  spiRec();  // get second crc byte
+  chipSelectHigh();
+  return true;
+}
+//------------------------------------------------------------------------------
 /** read CID or CSR register */
 uint8_t Sd2Card::readRegister(uint8_t cmd, void* buf) {
   uint8_t* dst = reinterpret_cast<uint8_t*>(buf);
@@ -439,6 +524,44 @@ uint8_t Sd2Card::readRegister(uint8_t cmd, void* buf) {
   return false;
 }
 //------------------------------------------------------------------------------
+/** Start a read multiple blocks sequence.
+ *
+ * \param[in] blockNumber Address of first block in sequence.
+ *
+ * \note This function is used with readData() and readStop()
+ * for optimized multiple block reads.  The card is deselected between
+ * blocks, so the SPI bus may be used for other devices.
+ *
+ * \return The value one, true, is returned for success and
+ * the value zero, false, is returned for failure.
+ */
+uint8_t Sd2Card::readStart(uint32_t blockNumber) {
+  // use address if not SDHC card
+  if (type()!= SD_CARD_TYPE_SDHC) blockNumber <<= 9;
+  if (cardCommand(CMD18, blockNumber)) {
+    error(SD_CARD_ERROR_CMD18);
+    chipSelectHigh();
+    return false;
+  }
+  chipSelectHigh();
+  return true;
+}
+//------------------------------------------------------------------------------
+/** End a read multiple blocks sequence.
+ *
+ * \return The value one, true, is returned for success and
+ * the value zero, false, is returned for failure.
+ */
+uint8_t Sd2Card::readStop(void) {
+  if (cardCommand(CMD12, 0)) {
+    error(SD_CARD_ERROR_CMD12);
+    chipSelectHigh();
+    return false;
+  }
+  chipSelectHigh();
+  return true;
+}
+//------------------------------------------------------------------------------
 /**
  * Set the SPI clock rate.
  *
@@ -470,27 +593,54 @@ uint8_t Sd2Card::setSckRate(uint8_t sckRateID) {
 //------------------------------------------------------------------------------
 // wait for card to go not busy
 uint8_t Sd2Card::waitNotBusy(uint16_t timeoutMillis) {
+  // usual case for a command
+  if (spiRec() == 0XFF) return true;
+#if SD_CARD_STATS
+  uint32_t m0 = micros();
+#endif  // SD_CARD_STATS
   uint16_t t0 = millis();
+  uint8_t rtn = false;
   do {
-    if (spiRec() == 0XFF) return true;
+    if (spiRec() == 0XFF) {
+      rtn = true;
+      break;
+    }
   }
   while (((uint16_t)millis() - t0) < timeoutMillis);
-  return false;
+#if SD_CARD_STATS
+  uint32_t m = micros() - m0;
+  stats_.busyMicros += m;
+  if (m > stats_.busyMaxMicros) stats_.busyMaxMicros = m;
+#endif  // SD_CARD_STATS
+  return rtn;
 }
 //------------------------------------------------------------------------------
 /** Wait for start block token */
 uint8_t Sd2Card::waitStartBlock(void) {
   uint16_t t0 = millis();
+#if SD_CARD_STATS
+  uint32_t m0 = micros();
+#endif  // SD_CARD_STATS
   while ((status_ = spiRec()) == 0XFF) {
     if (((uint16_t)millis() - t0) > SD_READ_TIMEOUT) {
       error(SD_CARD_ERROR_READ_TIMEOUT);
       goto fail;
     }
   }
+#if SD_CARD_STATS
+  {
+    uint32_t m = micros() - m0;
+    stats_.readWaitMicros += m;
+    if (m > stats_.readWaitMaxMicros) stats_.readWaitMaxMicros = m;
+  }
+#endif  // SD_CARD_STATS
   if (status_ != DATA_START_BLOCK) {
     error(SD_CARD_ERROR_READ);
     goto fail;
   }
+#if SD_CARD_STATS
+  stats_.blocksRead++;
+#endif  // SD_CARD_STATS
   return true;
 
  fail:
@@ -541,15 +691,52 @@ uint8_t Sd2Card::writeBlock(uint32_t blockNumber, const uint8_t* src) {
   return false;
 }
 //------------------------------------------------------------------------------
+/**
+ * Write the blocks of a scatter list.
+ *
+ * Entries with consecutive block numbers are written with one multiple
+ * block write command, other entries with writeBlock().
+ *
+ * \param[in] list Array of block numbers and locations of the data.
+ * \param[in] count Number of entries in \a list.
+ *
+ * \return The value one, true, is returned for success and
+ * the value zero, false, is returned for failure.
+ */
+uint8_t Sd2Card::writeBlocks(const sd_block_io_t* list, uint8_t count) {
+  for (uint8_t i = 0; i < count;) {
+    // number of entries in this run of consecutive blocks
+    uint8_t n = 1;
+    while ((i + n) < count && list[i + n].block == (list[i].block + n)) n++;
+    if (n == 1) {
+      if (!writeBlock(list[i].block, list[i].data)) return false;
+    } else {
+      if (!writeStart(list[i].block, n)) return false;
+      for (uint8_t k = 0; k < n; k++) {
+        if (!writeData(list[i + k].data)) {
+          writeStop();
+          return false;
+        }
+      }
+      if (!writeStop()) return false;
+    }
+    i += n;
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
 /** Write one data block in a multiple block write sequence */
 uint8_t Sd2Card::writeData(const uint8_t* src) {
+  chipSelectLow();
   // wait for previous write to finish
   if (!waitNotBusy(SD_WRITE_TIMEOUT)) {
     error(SD_CARD_ERROR_WRITE_MULTIPLE);
     chipSelectHigh();
     return false;
   }
-  return writeData(WRITE_MULTIPLE_TOKEN, src);
+  if (!writeData(WRITE_MULTIPLE_TOKEN, src)) return false;
+  chipSelectHigh();
+  return true;
 }
 //------------------------------------------------------------------------------
 // send one block of data for write block or write multiple blocks
@@ -559,12 +746,15 @@ uint8_t Sd2Card::writeData(uint8_t token, const uint8_t* src) {
   // send data - optimized loop
   SPDR = token;
 
-  // send two byte per iteration
+  // send two byte per iteration, fetch each byte while the previous
+  // byte is shifted out
   for (uint16_t i = 0; i < 512; i += 2) {
+    uint8_t b = src[i];
     while (!(SPSR & (1 << SPIF)));
-    SPDR = src[i];
+    SPDR = b;
+    b = src[i + 1];
     while (!(SPSR & (1 << SPIF)));
-    SPDR = src[i+1];
+    SPDR = b;
   }
 
   // wait for last data byte
@@ -585,6 +775,9 @@ uint8_t Sd2Card::writeData(uint8_t token, const uint8_t* src) {
     chipSelectHigh();
     return false;
   }
+#if SD_CARD_STATS
+  stats_.blocksWritten++;
+#endif  // SD_CARD_STATS
   return true;
 }
 //------------------------------------------------------------------------------
@@ -594,7 +787,8 @@ uint8_t Sd2Card::writeData(uint8_t token, const uint8_t* src) {
  * \param[in] eraseCount The number of blocks to be pre-erased.
  *
  * \note This function is used with writeData() and writeStop()
- * for optimized multiple block writes.
+ * for optimized multiple block writes.  The card is deselected between
+ * blocks, so the SPI bus may be used for other devices.
  *
  * \return The value one, true, is returned for success and
  * the value zero, false, is returned for failure.
@@ -618,6 +812,7 @@ uint8_t Sd2Card::writeStart(uint32_t blockNumber, uint32_t eraseCount) {
     error(SD_CARD_ERROR_CMD25);
     goto fail;
   }
+  chipSelectHigh();
   return true;
 
  fail:
@@ -631,6 +826,7 @@ uint8_t Sd2Card::writeStart(uint32_t blockNumber, uint32_t eraseCount) {
  * the value zero, false, is returned for failure.
  */
 uint8_t Sd2Card::writeStop(void) {
+  chipSelectLow();
   if (!waitNotBusy(SD_WRITE_TIMEOUT)) goto fail;
   spiSend(STOP_TRAN_TOKEN);
   if (!waitNotBusy(SD_WRITE_TIMEOUT)) goto fail;
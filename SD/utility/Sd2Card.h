@@ -80,6 +80,19 @@ uint8_t const SPI_MISO_PIN = 12;
 uint8_t const SPI_SCK_PIN = 13;
 #endif  // SOFTWARE_SPI
 //------------------------------------------------------------------------------
+/**
+ * Count commands, blocks and the time spent waiting for the card if
+ * nonzero.  See Sd2Card::stats().  On by default for boards with more
+ * than 2.5 KB RAM.
+ */
+#ifndef SD_CARD_STATS
+#if defined(RAMEND) && RAMEND < 0X1000
+#define SD_CARD_STATS 0
+#else  // RAMEND
+#define SD_CARD_STATS 1
+#endif  // RAMEND
+#endif  // SD_CARD_STATS
+//------------------------------------------------------------------------------
 /** Protect block zero from write if nonzero */
 #define SD_PROTECT_BLOCK_ZERO 1
 /** init timeout ms */
@@ -136,6 +149,10 @@ uint8_t const SD_CARD_ERROR_WRITE_PROGRAMMING = 0X14;
 uint8_t const SD_CARD_ERROR_WRITE_TIMEOUT = 0X15;
 /** incorrect rate selected */
 uint8_t const SD_CARD_ERROR_SCK_RATE = 0X16;
+/** card returned an error response for CMD18 (read multiple block) */
+uint8_t const SD_CARD_ERROR_CMD18 = 0X17;
+/** card returned an error response for CMD12 (stop transmission) */
+uint8_t const SD_CARD_ERROR_CMD12 = 0X18;
 //------------------------------------------------------------------------------
 // card types
 /** Standard capacity V1 SD card */
@@ -145,6 +162,45 @@ uint8_t const SD_CARD_TYPE_SD2 = 2;
 /** High Capacity SD card */
 uint8_t const SD_CARD_TYPE_SDHC = 3;
 //------------------------------------------------------------------------------
+/**
+ * \struct sdCardStats
+ * \brief Counters kept by Sd2Card if SD_CARD_STATS is nonzero.
+ */
+struct sdCardStats {
+           /** Commands sent to the card, an ACMD counts as two */
+  uint32_t commands;
+           /** Data blocks and registers read */
+  uint32_t blocksRead;
+           /** Data blocks written */
+  uint32_t blocksWritten;
+           /** Microseconds waiting for the card to finish a command or write */
+  uint32_t busyMicros;
+           /** Longest wait for the card to finish, microseconds */
+  uint32_t busyMaxMicros;
+           /** Microseconds waiting for read data */
+  uint32_t readWaitMicros;
+           /** Longest wait for read data, microseconds */
+  uint32_t readWaitMaxMicros;
+           /** Failed operations, see Sd2Card::errorCode() */
+  uint16_t errors;
+};
+/** Type name for sdCardStats */
+typedef struct sdCardStats sd_stats_t;
+//------------------------------------------------------------------------------
+/**
+ * \struct sdBlockIo
+ * \brief One entry of a scatter list for Sd2Card::readBlocks() and
+ * Sd2Card::writeBlocks().
+ */
+struct sdBlockIo {
+           /** Logical block number */
+  uint32_t block;
+           /** Location of the 512 bytes for the block */
+  uint8_t* data;
+};
+/** Type name for sdBlockIo */
+typedef struct sdBlockIo sd_block_io_t;
+//------------------------------------------------------------------------------
 /**
  * \class Sd2Card
  * \brief Raw access to SD and SDHC flash memory cards.
@@ -182,8 +238,10 @@ class Sd2Card {
   /** Returns the current value, true or false, for partial block read. */
   uint8_t partialBlockRead(void) const {return partialBlockRead_;}
   uint8_t readBlock(uint32_t block, uint8_t* dst);
+  uint8_t readBlocks(const sd_block_io_t* list, uint8_t count);
   uint8_t readData(uint32_t block,
           uint16_t offset, uint16_t count, uint8_t* dst);
+  uint8_t readData(uint8_t* dst);
   /**
    * Read a cards CID register. The CID contains card identification
    * information such as Manufacturer ID, Product name, Product serial
@@ -198,10 +256,18 @@ class Sd2Card {
     return readRegister(CMD9, csd);
   }
   void readEnd(void);
+  uint8_t readStart(uint32_t blockNumber);
+  uint8_t readStop(void);
   uint8_t setSckRate(uint8_t sckRateID);
+#if SD_CARD_STATS
+  void clearStats(void);
+  /** \return Counters since init() or clearStats(). */
+  const sd_stats_t* stats(void) const {return &stats_;}
+#endif  // SD_CARD_STATS
   /** Return the card type: SD V1, SD V2 or SDHC */
   uint8_t type(void) const {return type_;}
   uint8_t writeBlock(uint32_t blockNumber, const uint8_t* src);
+  uint8_t writeBlocks(const sd_block_io_t* list, uint8_t count);
   uint8_t writeData(const uint8_t* src);
   uint8_t writeStart(uint32_t blockNumber, uint32_t eraseCount);
   uint8_t writeStop(void);
@@ -214,13 +280,21 @@ class Sd2Card {
   uint8_t partialBlockRead_;
   uint8_t status_;
   uint8_t type_;
+#if SD_CARD_STATS
+  sd_stats_t stats_;
+#endif  // SD_CARD_STATS
   // private functions
   uint8_t cardAcmd(uint8_t cmd, uint32_t arg) {
     cardCommand(CMD55, 0);
     return cardCommand(cmd, arg);
   }
   uint8_t cardCommand(uint8_t cmd, uint32_t arg);
-  void error(uint8_t code) {errorCode_ = code;}
+  void error(uint8_t code) {
+    errorCode_ = code;
+#if SD_CARD_STATS
+    stats_.errors++;
+#endif  // SD_CARD_STATS
+  }
   uint8_t readRegister(uint8_t cmd, void* buf);
   uint8_t sendWriteCommand(uint32_t blockNumber, uint32_t eraseCount);
   void chipSelectHigh(void);
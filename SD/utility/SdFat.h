@@ -33,6 +33,78 @@
  */
 #define ALLOW_DEPRECATED_FUNCTIONS 1
 //------------------------------------------------------------------------------
+/**
+ * Number of 512 byte cache blocks for FAT blocks.  If zero the FAT blocks
+ * share the data blocks, so a FAT access may evict the file data block.
+ * Define SD_CACHE_FAT_BLOCKS and SD_CACHE_DATA_BLOCKS before including
+ * SD.h to change the defaults.
+ */
+#ifndef SD_CACHE_FAT_BLOCKS
+#if defined(RAMEND) && RAMEND < 0X1000
+// 2.5 KB RAM or less (ATmega328, ATmega32U4) - one block as before
+#define SD_CACHE_FAT_BLOCKS 0
+#else  // RAMEND
+#define SD_CACHE_FAT_BLOCKS 1
+#endif  // RAMEND
+#endif  // SD_CACHE_FAT_BLOCKS
+/**
+ * Number of 512 byte cache blocks for file data and directory blocks.
+ */
+#ifndef SD_CACHE_DATA_BLOCKS
+#if defined(RAMEND) && RAMEND < 0X1000
+#define SD_CACHE_DATA_BLOCKS 1
+#else  // RAMEND
+#define SD_CACHE_DATA_BLOCKS 2
+#endif  // RAMEND
+#endif  // SD_CACHE_DATA_BLOCKS
+#if SD_CACHE_DATA_BLOCKS < 1
+#error SD_CACHE_DATA_BLOCKS must be at least one
+#endif  // SD_CACHE_DATA_BLOCKS
+/** Total number of cache blocks */
+#define SD_CACHE_BLOCKS (SD_CACHE_FAT_BLOCKS + SD_CACHE_DATA_BLOCKS)
+/**
+ * Number of entries in the free cluster map, zero to disable it.  Each
+ * entry holds the free cluster count of a group of FAT blocks, so cluster
+ * allocation can skip groups without free clusters.  The counts are found
+ * while allocating, one byte of RAM per entry.
+ */
+#ifndef SD_FREE_MAP_SIZE
+#if defined(RAMEND) && RAMEND < 0X1000
+#define SD_FREE_MAP_SIZE 0
+#else  // RAMEND
+#define SD_FREE_MAP_SIZE 64
+#endif  // RAMEND
+#endif  // SD_FREE_MAP_SIZE
+/**
+ * Number of directory entries remembered by name after they are opened,
+ * zero to disable.  A remembered entry is checked against its directory
+ * block before use, so opening the same file again reads one block.
+ * Each entry uses 21 bytes of RAM.
+ */
+#ifndef SD_DIR_CACHE_SIZE
+#if defined(RAMEND) && RAMEND < 0X1000
+#define SD_DIR_CACHE_SIZE 2
+#else  // RAMEND
+#define SD_DIR_CACHE_SIZE 8
+#endif  // RAMEND
+#endif  // SD_DIR_CACHE_SIZE
+/**
+ * Number of entries in the hashed name index, zero to disable.  The index
+ * holds a one byte hash of each entry for the first SD_DIR_INDEX_SIZE
+ * entries of the last directory searched, so a search only reads blocks
+ * with a matching hash.  Must be a multiple of 16.
+ */
+#ifndef SD_DIR_INDEX_SIZE
+#if defined(RAMEND) && RAMEND < 0X1000
+#define SD_DIR_INDEX_SIZE 0
+#else  // RAMEND
+#define SD_DIR_INDEX_SIZE 256
+#endif  // RAMEND
+#endif  // SD_DIR_INDEX_SIZE
+#if SD_DIR_INDEX_SIZE & 0XF
+#error SD_DIR_INDEX_SIZE must be a multiple of 16
+#endif  // SD_DIR_INDEX_SIZE
+//------------------------------------------------------------------------------
 // forward declaration since SdVolume is used in SdFile
 class SdVolume;
 //==============================================================================
@@ -149,6 +221,13 @@ class SdFile : public Print {
   void clearUnbufferedRead(void) {
     flags_ &= ~F_FILE_UNBUFFERED_READ;
   }
+  /**
+   * Cancel read-ahead for this file.
+   * See setReadAhead()
+   */
+  void clearReadAhead(void) {
+    flags_ &= ~F_FILE_READ_AHEAD;
+  }
   uint8_t close(void);
   uint8_t contiguousRange(uint32_t* bgnBlock, uint32_t* endBlock);
   uint8_t createContiguous(SdFile* dirFile,
@@ -240,6 +319,7 @@ class SdFile : public Print {
   }
   int16_t read(void* buf, uint16_t nbyte);
   int8_t readDir(dir_t* dir);
+  int16_t readPtr(const uint8_t** ptr, uint16_t nbyte);
   static uint8_t remove(SdFile* dirFile, const char* fileName);
   uint8_t remove(void);
   /** Set the file's current position to zero. */
@@ -258,6 +338,7 @@ class SdFile : public Print {
    */
   uint8_t seekEnd(void) {return seekSet(fileSize_);}
   uint8_t seekSet(uint32_t pos);
+  uint8_t setReadAhead(void);
   /**
    * Use unbuffered reads to access this file.  Used with Wave
    * Shield ISR.  Used with Sd2Card::partialBlockRead() in WaveRP.
@@ -277,6 +358,10 @@ class SdFile : public Print {
    */
   uint8_t type(void) const {return type_;}
   uint8_t truncate(uint32_t size);
+  /** \return Read-ahead flag. */
+  uint8_t readAhead(void) const {
+    return flags_ & F_FILE_READ_AHEAD;
+  }
   /** \return Unbuffered read flag. */
   uint8_t unbufferedRead(void) const {
     return flags_ & F_FILE_UNBUFFERED_READ;
@@ -369,14 +454,17 @@ class SdFile : public Print {
   // should be 0XF
   static uint8_t const F_OFLAG = (O_ACCMODE | O_APPEND | O_SYNC);
   // available bits
-  static uint8_t const F_UNUSED = 0X30;
+  static uint8_t const F_UNUSED = 0X10;
+  // start reading the next block before it is needed
+  static uint8_t const F_FILE_READ_AHEAD = 0X20;
   // use unbuffered SD read
   static uint8_t const F_FILE_UNBUFFERED_READ = 0X40;
   // sync of directory entry required
   static uint8_t const F_FILE_DIR_DIRTY = 0X80;
 
 // make sure F_OFLAG is ok
-#if ((F_UNUSED | F_FILE_UNBUFFERED_READ | F_FILE_DIR_DIRTY) & F_OFLAG)
+#if ((F_UNUSED | F_FILE_READ_AHEAD | F_FILE_UNBUFFERED_READ | \
+  F_FILE_DIR_DIRTY) & F_OFLAG)
 #error flags_ bits conflict
 #endif  // flags_ bits
 
@@ -398,6 +486,8 @@ class SdFile : public Print {
   static void (*dateTime_)(uint16_t* date, uint16_t* time);
   static uint8_t make83Name(const char* str, uint8_t* name);
   uint8_t openCachedEntry(uint8_t cacheIndex, uint8_t oflags);
+  uint8_t positionBlock(uint32_t* block);
+  uint8_t readAheadStart(uint8_t keepBlock);
   dir_t* readDirCache(void);
 };
 //==============================================================================
@@ -418,6 +508,8 @@ union cache_t {
   mbr_t    mbr;
            /** Used to access to a cached FAT boot sector. */
   fbs_t    fbs;
+           /** Used to access a cached FAT32 FSINFO sector. */
+  fsinfo_t fsinfo;
 };
 //------------------------------------------------------------------------------
 /**
@@ -427,15 +519,27 @@ union cache_t {
 class SdVolume {
  public:
   /** Create an instance of SdVolume */
-  SdVolume(void) :allocSearchStart_(2), fatType_(0) {}
+  SdVolume(void) :allocSearchStart_(2), fatType_(0), fsInfoBlock_(0) {}
   /** Clear the cache and returns a pointer to the cache.  Used by the WaveRP
    *  recorder to do raw write to the SD card.  Not for normal apps.
    */
   static uint8_t* cacheClear(void) {
     cacheFlush();
-    cacheBlockNumber_ = 0XFFFFFFFF;
-    return cacheBuffer_.data;
+    cacheInvalidate();
+    return cacheBuffer_->data;
   }
+  /** \return The number of FAT block accesses found in the cache. */
+  static uint32_t fatCacheHits(void) {return cacheHits_[1];}
+  /** \return The number of FAT block accesses that read the SD. */
+  static uint32_t fatCacheMisses(void) {return cacheMisses_[1];}
+  /** \return The number of data and directory block accesses found
+   *  in the cache. */
+  static uint32_t dataCacheHits(void) {return cacheHits_[0];}
+  /** \return The number of data and directory block accesses that
+   *  read the SD or evicted a block. */
+  static uint32_t dataCacheMisses(void) {return cacheMisses_[0];}
+  /** Set the cache hit and miss counters to zero. */
+  static void cacheClearStats(void);
   /**
    * Initialize a FAT volume.  Try partition one first then try super
    * floppy format.
@@ -489,17 +593,39 @@ class SdVolume {
   private:
   // Allow SdFile access to SdVolume private data.
   friend class SdFile;
+  // LogFile writes its blocks with streamWrite()
+  friend class LogFile;
 
   // value for action argument in cacheRawBlock to indicate read from cache
   static uint8_t const CACHE_FOR_READ = 0;
   // value for action argument in cacheRawBlock to indicate cache dirty
   static uint8_t const CACHE_FOR_WRITE = 1;
+  // option for action argument - whole block will be written, don't read it
+  static uint8_t const CACHE_OPTION_NO_READ = 2;
+  // cacheRawBlock action for a new block that will be written
+  static uint8_t const CACHE_RESERVE_FOR_WRITE =
+    CACHE_FOR_WRITE | CACHE_OPTION_NO_READ;
 
-  static cache_t cacheBuffer_;        // 512 byte cache for device blocks
-  static uint32_t cacheBlockNumber_;  // Logical number of block in the cache
+  // cache blocks 0 to SD_CACHE_FAT_BLOCKS - 1 hold FAT blocks, the
+  // others hold data and directory blocks.  Each group is replaced LRU.
+  static cache_t cacheBlocks_[SD_CACHE_BLOCKS];    // 512 byte blocks
+  static uint32_t cacheNumbers_[SD_CACHE_BLOCKS];  // block number or invalid
+  static uint32_t cacheMirror_[SD_CACHE_BLOCKS];   // mirror FAT block
+  static uint8_t cacheDirty_[SD_CACHE_BLOCKS];     // write block if true
+  static uint8_t cacheAge_[SD_CACHE_BLOCKS];       // 0 for most recent use
+  static uint8_t cacheCurrent_;       // index of cacheBuffer_
+  static cache_t* cacheBuffer_;       // last block from cacheRawBlock()
+  static uint32_t cacheBlockNumber_;  // Logical number of cacheBuffer_ block
+  static uint32_t cacheHits_[2];      // data hits, FAT hits
+  static uint32_t cacheMisses_[2];    // data misses, FAT misses
   static Sd2Card* sdCard_;            // Sd2Card object for cache
-  static uint8_t cacheDirty_;         // cacheFlush() will write block if true
-  static uint32_t cacheMirrorBlock_;  // block number for mirror FAT
+
+  // multiple block sequence in progress, values for streamMode_
+  static uint8_t const STREAM_NONE = 0;
+  static uint8_t const STREAM_READ = 1;
+  static uint8_t const STREAM_WRITE = 2;
+  static uint8_t streamMode_;         // sequence in progress
+  static uint32_t streamBlock_;       // next block of the sequence
 //
   uint32_t allocSearchStart_;   // start cluster for alloc search
   uint8_t blocksPerCluster_;    // cluster size in blocks
@@ -512,6 +638,41 @@ class SdVolume {
   uint8_t fatType_;             // volume type (12, 16, OR 32)
   uint16_t rootDirEntryCount_;  // number of entries in FAT16 root dir
   uint32_t rootDirStart_;       // root start block for FAT16, cluster for FAT32
+  uint32_t fsInfoBlock_;        // FAT32 FSINFO block, zero if none
+  uint32_t fsInfoNextFree_;     // next free hint in the FSINFO block
+  uint8_t fsInfoFreeCount_;     // FSINFO has a free count
+  uint8_t fsInfoChanged_;       // clusters were allocated or freed
+
+  // free cluster map, values for entries that are not a count
+  static uint8_t const FREE_MAP_MANY = 0XFE;     // at least this many
+  static uint8_t const FREE_MAP_UNKNOWN = 0XFF;  // not counted yet
+#if SD_FREE_MAP_SIZE
+  static uint8_t freeMap_[SD_FREE_MAP_SIZE];  // free clusters in a group
+  static uint8_t freeMapShift_;               // FAT blocks per group, log2
+#endif  // SD_FREE_MAP_SIZE
+
+  // directory entries found by name, replaced LRU
+  struct dirCache_t {
+    uint32_t dir;       // first cluster of directory, zero for FAT16 root
+    uint32_t block;     // block of entry, zero if not used
+    uint8_t index;      // index of entry in block
+    uint8_t age;        // 0 for most recent use
+    uint8_t name[11];   // 8.3 name
+  };
+#if SD_DIR_CACHE_SIZE
+  static dirCache_t dirCache_[SD_DIR_CACHE_SIZE];
+#endif  // SD_DIR_CACHE_SIZE
+
+  // name index values for entries without a name
+  static uint8_t const DIR_HASH_FREE = 0;     // entry and all following free
+  static uint8_t const DIR_HASH_DELETED = 1;  // deleted entry
+#if SD_DIR_INDEX_SIZE
+  static uint8_t dirIndexUsed_;     // index holds entries of dirIndexDir_
+  static uint32_t dirIndexDir_;     // first cluster of indexed directory
+  static uint16_t dirIndexCount_;   // entries indexed from start of directory
+  static uint8_t dirIndexHash_[SD_DIR_INDEX_SIZE];        // hash of name
+  static uint32_t dirIndexBlock_[SD_DIR_INDEX_SIZE/16];   // directory block
+#endif  // SD_DIR_INDEX_SIZE
   //----------------------------------------------------------------------------
   uint8_t allocContiguous(uint32_t count, uint32_t* curCluster);
   uint8_t blockOfCluster(uint32_t position) const {
@@ -520,9 +681,21 @@ class SdVolume {
            return dataStartBlock_ + ((cluster - 2) << clusterSizeShift_);}
   uint32_t blockNumber(uint32_t cluster, uint32_t position) const {
            return clusterStartBlock(cluster) + blockOfCluster(position);}
+  static cache_t* cacheBlock(uint32_t blockNumber, uint8_t action,
+                             uint8_t fat);
+  static cache_t* cacheFatBlock(uint32_t blockNumber, uint8_t action) {
+    return cacheBlock(blockNumber, action, 1);
+  }
+  static uint8_t cacheFind(uint32_t blockNumber);
   static uint8_t cacheFlush(void);
+  static void cacheInvalidate(void);
+  static void cacheInvalidate(uint32_t blockNumber);
   static uint8_t cacheRawBlock(uint32_t blockNumber, uint8_t action);
-  static void cacheSetDirty(void) {cacheDirty_ |= CACHE_FOR_WRITE;}
+  static void cacheSetDirty(void) {
+    cacheDirty_[cacheCurrent_] |= CACHE_FOR_WRITE;
+  }
+  static void cacheUse(uint8_t i);
+  static uint8_t cacheWrite(uint8_t i);
   static uint8_t cacheZeroBlock(uint32_t blockNumber);
   uint8_t chainSize(uint32_t beginCluster, uint32_t* size) const;
   uint8_t fatGet(uint32_t cluster, uint32_t* value) const;
@@ -530,18 +703,36 @@ class SdVolume {
   uint8_t fatPutEOC(uint32_t cluster) {
     return fatPut(cluster, 0x0FFFFFFF);
   }
+  static uint8_t dirCacheFind(uint32_t dir, const uint8_t* name,
+                              uint32_t* block, uint8_t* index);
+  static void dirCacheAdd(uint32_t dir, const uint8_t* name,
+                          uint32_t block, uint8_t index);
+  static void dirCacheInvalidate(void);
+  static uint8_t dirHash(const uint8_t* name);
+  static void dirIndexAdd(uint16_t n, const uint8_t* name);
+  static void dirIndexUpdate(uint32_t block, uint8_t index,
+                             const uint8_t* name);
+  static void dirIndexUse(uint32_t dir);
+  uint8_t fatBlockShift(void) const {return fatType_ == 16 ? 8 : 7;}
   uint8_t freeChain(uint32_t cluster);
+  void freeMapUpdate(uint32_t cluster, uint8_t freed);
+  uint8_t fsInfoSync(void);
   uint8_t isEOC(uint32_t cluster) const {
     return  cluster >= (fatType_ == 16 ? FAT16EOC_MIN : FAT32EOC_MIN);
   }
   uint8_t readBlock(uint32_t block, uint8_t* dst) {
-    return sdCard_->readBlock(block, dst);}
+    return streamStop() && sdCard_->readBlock(block, dst);}
   uint8_t readData(uint32_t block, uint16_t offset,
     uint16_t count, uint8_t* dst) {
-      return sdCard_->readData(block, offset, count, dst);
+      return streamStop() && sdCard_->readData(block, offset, count, dst);
   }
   uint8_t writeBlock(uint32_t block, const uint8_t* dst) {
-    return sdCard_->writeBlock(block, dst);
+    return streamStop() && sdCard_->writeBlock(block, dst);
   }
+  static uint8_t streamPrefetch(uint32_t block);
+  static uint8_t streamRead(uint32_t block, uint8_t* dst);
+  static uint8_t streamStop(void);
+  static uint8_t streamWrite(uint32_t block, const uint8_t* src,
+                             uint32_t eraseCount);
 };
 #endif  // SdFat_h
@@ -60,7 +60,7 @@ uint8_t SdFile::addDirCluster(void) {
 // return pointer to cached entry or null for failure
 dir_t* SdFile::cacheDirEntry(uint8_t action) {
   if (!SdVolume::cacheRawBlock(dirBlock_, action)) return NULL;
-  return SdVolume::cacheBuffer_.dir + dirIndex_;
+  return SdVolume::cacheBuffer_->dir + dirIndex_;
 }
 //------------------------------------------------------------------------------
 /**
@@ -314,7 +314,7 @@ uint8_t SdFile::makeDir(SdFile* dir, const char* dirName) {
   if (!SdVolume::cacheRawBlock(block, SdVolume::CACHE_FOR_WRITE)) return false;
 
   // copy '.' to block
-  memcpy(&SdVolume::cacheBuffer_.dir[0], &d, sizeof(d));
+  memcpy(&SdVolume::cacheBuffer_->dir[0], &d, sizeof(d));
 
   // make entry for '..'
   d.name[1] = '.';
@@ -326,7 +326,7 @@ uint8_t SdFile::makeDir(SdFile* dir, const char* dirName) {
     d.firstClusterHigh = dir->firstCluster_ >> 16;
   }
   // copy '..' to block
-  memcpy(&SdVolume::cacheBuffer_.dir[1], &d, sizeof(d));
+  memcpy(&SdVolume::cacheBuffer_->dir[1], &d, sizeof(d));
 
   // set position after '..'
   curPosition_ = 2 * sizeof(d);
@@ -389,17 +389,68 @@ uint8_t SdFile::open(SdFile* dirFile, const char* fileName, uint8_t oflag) {
   if (isOpen())return false;
 
   if (!make83Name(fileName, dname)) return false;
+  if (!dirFile->isDir()) return false;
   vol_ = dirFile->vol_;
+
+  // try the entries found by earlier opens
+  if (SdVolume::dirCacheFind(dirFile->firstCluster_, dname,
+                             &dirBlock_, &dirIndex_)) {
+    // don't open existing file if O_CREAT and O_EXCL
+    if ((oflag & (O_CREAT | O_EXCL)) == (O_CREAT | O_EXCL)) return false;
+    return openCachedEntry(dirIndex_, oflag);
+  }
   dirFile->rewind();
 
   // bool for empty entry found
   uint8_t emptyFound = false;
 
+  // bool for free entry found, no entries follow
+  uint8_t endFound = false;
+
+#if SD_DIR_INDEX_SIZE
+  // only read the indexed entries with a matching hash
+  SdVolume::dirIndexUse(dirFile->firstCluster_);
+  uint8_t hash = SdVolume::dirHash(dname);
+  uint16_t n;
+  for (n = 0; n < SdVolume::dirIndexCount_; n++) {
+    uint8_t h = SdVolume::dirIndexHash_[n];
+    uint32_t block = SdVolume::dirIndexBlock_[n >> 4];
+    if (h == SdVolume::DIR_HASH_FREE || h == SdVolume::DIR_HASH_DELETED) {
+      // remember first empty slot
+      if (!emptyFound) {
+        emptyFound = true;
+        dirIndex_ = 0XF & n;
+        dirBlock_ = block;
+      }
+      // done if no entries follow
+      if (h == SdVolume::DIR_HASH_FREE) {
+        endFound = true;
+        break;
+      }
+    } else if (h == hash) {
+      if (!SdVolume::cacheRawBlock(block, SdVolume::CACHE_FOR_READ)) {
+        return false;
+      }
+      if (!memcmp(dname, SdVolume::cacheBuffer_->dir[0XF & n].name, 11)) {
+        if ((oflag & (O_CREAT | O_EXCL)) == (O_CREAT | O_EXCL)) return false;
+        if (!openCachedEntry(0XF & n, oflag)) return false;
+        SdVolume::dirCacheAdd(dirFile->firstCluster_, dname,
+                              dirBlock_, dirIndex_);
+        return true;
+      }
+    }
+  }
+  // continue after the indexed entries
+  if (!endFound && n && !dirFile->seekSet(32UL * n)) return false;
+#endif  // SD_DIR_INDEX_SIZE
+
   // search for file
-  while (dirFile->curPosition_ < dirFile->fileSize_) {
-    uint8_t index = 0XF & (dirFile->curPosition_ >> 5);
+  while (!endFound && dirFile->curPosition_ < dirFile->fileSize_) {
+    uint16_t entry = dirFile->curPosition_ >> 5;
+    uint8_t index = 0XF & entry;
     p = dirFile->readDirCache();
     if (p == NULL) return false;
+    SdVolume::dirIndexAdd(entry, p->name);
 
     if (p->name[0] == DIR_NAME_FREE || p->name[0] == DIR_NAME_DELETED) {
       // remember first empty slot
@@ -415,7 +466,10 @@ uint8_t SdFile::open(SdFile* dirFile, const char* fileName, uint8_t oflag) {
       if ((oflag & (O_CREAT | O_EXCL)) == (O_CREAT | O_EXCL)) return false;
 
       // open found file
-      return openCachedEntry(0XF & index, oflag);
+      if (!openCachedEntry(index, oflag)) return false;
+      SdVolume::dirCacheAdd(dirFile->firstCluster_, dname,
+                            dirBlock_, dirIndex_);
+      return true;
     }
   }
   // only create file if O_CREAT and O_WRITE
@@ -433,7 +487,7 @@ uint8_t SdFile::open(SdFile* dirFile, const char* fileName, uint8_t oflag) {
 
     // use first entry in cluster
     dirIndex_ = 0;
-    p = SdVolume::cacheBuffer_.dir;
+    p = SdVolume::cacheBuffer_->dir;
   }
   // initialize as empty file
   memset(p, 0, sizeof(dir_t));
@@ -456,7 +510,10 @@ uint8_t SdFile::open(SdFile* dirFile, const char* fileName, uint8_t oflag) {
   if (!SdVolume::cacheFlush()) return false;
 
   // open entry in cache
-  return openCachedEntry(dirIndex_, oflag);
+  if (!openCachedEntry(dirIndex_, oflag)) return false;
+  SdVolume::dirIndexUpdate(dirBlock_, dirIndex_, dname);
+  SdVolume::dirCacheAdd(dirFile->firstCluster_, dname, dirBlock_, dirIndex_);
+  return true;
 }
 //------------------------------------------------------------------------------
 /**
@@ -501,7 +558,7 @@ uint8_t SdFile::open(SdFile* dirFile, uint16_t index, uint8_t oflag) {
 // open a cached directory entry. Assumes vol_ is initializes
 uint8_t SdFile::openCachedEntry(uint8_t dirIndex, uint8_t oflag) {
   // location of entry in cache
-  dir_t* p = SdVolume::cacheBuffer_.dir + dirIndex;
+  dir_t* p = SdVolume::cacheBuffer_->dir + dirIndex;
 
   // write or truncate is an error for a directory or read-only file
   if (p->attributes & (DIR_ATT_READ_ONLY | DIR_ATT_DIRECTORY)) {
@@ -643,6 +700,28 @@ void SdFile::printTwoDigits(uint8_t v) {
   Serial.print(str);
 }
 //------------------------------------------------------------------------------
+// Find the block for curPosition_.  Follows the cluster chain at the start
+// of a cluster, so it must be called once for each block.
+uint8_t SdFile::positionBlock(uint32_t* block) {
+  if (type_ == FAT_FILE_TYPE_ROOT16) {
+    *block = vol_->rootDirStart() + (curPosition_ >> 9);
+  } else {
+    uint8_t blockOfCluster = vol_->blockOfCluster(curPosition_);
+    if ((curPosition_ & 0X1FF) == 0 && blockOfCluster == 0) {
+      // start of new cluster
+      if (curPosition_ == 0) {
+        // use first cluster in file
+        curCluster_ = firstCluster_;
+      } else {
+        // get next cluster from FAT
+        if (!vol_->fatGet(curCluster_, &curCluster_)) return false;
+      }
+    }
+    *block = vol_->clusterStartBlock(curCluster_) + blockOfCluster;
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
 /**
  * Read data from a file starting at the current position.
  *
@@ -668,25 +747,11 @@ int16_t SdFile::read(void* buf, uint16_t nbyte) {
 
   // amount left to read
   uint16_t toRead = nbyte;
+  uint32_t start = curPosition_;
   while (toRead > 0) {
     uint32_t block;  // raw device block number
     uint16_t offset = curPosition_ & 0X1FF;  // offset in block
-    if (type_ == FAT_FILE_TYPE_ROOT16) {
-      block = vol_->rootDirStart() + (curPosition_ >> 9);
-    } else {
-      uint8_t blockOfCluster = vol_->blockOfCluster(curPosition_);
-      if (offset == 0 && blockOfCluster == 0) {
-        // start of new cluster
-        if (curPosition_ == 0) {
-          // use first cluster in file
-          curCluster_ = firstCluster_;
-        } else {
-          // get next cluster from FAT
-          if (!vol_->fatGet(curCluster_, &curCluster_)) return -1;
-        }
-      }
-      block = vol_->clusterStartBlock(curCluster_) + blockOfCluster;
-    }
+    if (!positionBlock(&block)) return -1;
     uint16_t n = toRead;
 
     // amount to be read from current block
@@ -694,19 +759,100 @@ int16_t SdFile::read(void* buf, uint16_t nbyte) {
 
     // no buffering needed if n == 512 or user requests no buffering
     if ((unbufferedRead() || n == 512) &&
-      block != SdVolume::cacheBlockNumber_) {
-      if (!vol_->readData(block, offset, n, dst)) return -1;
+      SdVolume::cacheFind(block) == SD_CACHE_BLOCKS) {
+      if (n == 512) {
+        // whole block - continue a multiple block read of a contiguous run
+        if (!SdVolume::streamRead(block, dst)) return -1;
+      } else {
+        if (!vol_->readData(block, offset, n, dst)) return -1;
+      }
       dst += n;
     } else {
       // read block to cache and copy data to caller
       if (!SdVolume::cacheRawBlock(block, SdVolume::CACHE_FOR_READ)) return -1;
-      uint8_t* src = SdVolume::cacheBuffer_.data + offset;
+      uint8_t* src = SdVolume::cacheBuffer_->data + offset;
       uint8_t* end = src + n;
       while (src != end) *dst++ = *src++;
     }
     curPosition_ += n;
     toRead -= n;
   }
+  // a new block was read, start the next one - errors in starting it are
+  // returned by the next read
+  if (readAhead() && nbyte &&
+    (!(start & 0X1FF) || (start >> 9) != (curPosition_ >> 9))) {
+    readAheadStart(false);
+  }
+  return nbyte;
+}
+//------------------------------------------------------------------------------
+// Start a multiple block read at the first block after curPosition_ that
+// isn't cached, so the card reads it while the caller uses the current block.
+// If the FAT shares a one block cache, a FAT lookup for the next cluster is
+// skipped while the current block is in use.
+uint8_t SdFile::readAheadStart(uint8_t keepBlock) {
+  if (curPosition_ >= fileSize_) return true;
+  uint32_t pos = curPosition_;
+  uint32_t cluster = curCluster_;
+  if (pos & 0X1FF) {
+    // the block for pos if it isn't cached, else the next block
+    uint32_t block = vol_->blockNumber(cluster, pos);
+    if (SdVolume::cacheFind(block) == SD_CACHE_BLOCKS) {
+      return SdVolume::streamPrefetch(block);
+    }
+    pos = (pos | 0X1FF) + 1;
+    if (pos >= fileSize_) return true;
+    keepBlock = true;
+  }
+  uint8_t blockOfCluster = vol_->blockOfCluster(pos);
+  if (blockOfCluster == 0) {
+    // start of next cluster
+    if (pos == 0) {
+      cluster = firstCluster_;
+    } else {
+      if (keepBlock && SD_CACHE_FAT_BLOCKS == 0) return true;
+      if (!vol_->fatGet(curCluster_, &cluster)) return false;
+    }
+  }
+  return SdVolume::streamPrefetch(vol_->blockNumber(cluster, pos));
+}
+//------------------------------------------------------------------------------
+/**
+ * Read data from a file without copying it.
+ *
+ * \param[out] ptr Location of the data in the block cache.  The data is
+ * valid until the next call that accesses the SD.
+ *
+ * \param[in] nbyte Maximum number of bytes to read.
+ *
+ * \return The number of bytes read is returned.  It is less than \a nbyte
+ * at the end of a block or the end of the file, zero at end of file.
+ * If an error occurs, readPtr() returns -1.
+ */
+int16_t SdFile::readPtr(const uint8_t** ptr, uint16_t nbyte) {
+  // error if not open or write only
+  if (!isOpen() || !(flags_ & O_READ)) return -1;
+
+  // max bytes left in file
+  if (nbyte > (fileSize_ - curPosition_)) nbyte = fileSize_ - curPosition_;
+  if (nbyte == 0) return 0;
+
+  uint32_t block;
+  uint16_t offset = curPosition_ & 0X1FF;
+  if (!positionBlock(&block)) return -1;
+
+  // only to the end of the block
+  if (nbyte > (512 - offset)) nbyte = 512 - offset;
+
+  if (!SdVolume::cacheRawBlock(block, SdVolume::CACHE_FOR_READ)) return -1;
+  *ptr = SdVolume::cacheBuffer_->data + offset;
+  curPosition_ += nbyte;
+
+  // start the next block if this one is new or used up, keep the block
+  // at *ptr in the cache
+  if (readAhead() && (offset == 0 || !(curPosition_ & 0X1FF))) {
+    readAheadStart(true);
+  }
   return nbyte;
 }
 //------------------------------------------------------------------------------
@@ -754,7 +900,7 @@ dir_t* SdFile::readDirCache(void) {
   curPosition_ += 31;
 
   // return pointer to entry
-  return (SdVolume::cacheBuffer_.dir + i);
+  return (SdVolume::cacheBuffer_->dir + i);
 }
 //------------------------------------------------------------------------------
 /**
@@ -781,6 +927,7 @@ uint8_t SdFile::remove(void) {
 
   // mark entry deleted
   d->name[0] = DIR_NAME_DELETED;
+  SdVolume::dirIndexUpdate(dirBlock_, dirIndex_, d->name);
 
   // set this SdFile closed
   type_ = FAT_FILE_TYPE_CLOSED;
@@ -848,7 +995,11 @@ uint8_t SdFile::rmDir(void) {
   // convert empty directory to normal file for remove
   type_ = FAT_FILE_TYPE_NORMAL;
   flags_ |= O_WRITE;
-  return remove();
+  if (!remove()) return false;
+
+  // entries found in the directory are gone
+  SdVolume::dirCacheInvalidate();
+  return true;
 }
 //------------------------------------------------------------------------------
 /** Recursively delete a directory and all contained files.
@@ -896,8 +1047,8 @@ uint8_t SdFile::rmRfStar(void) {
       if (!f.remove()) return false;
     }
     // position to next entry if required
-    if (curPosition_ != (32*(index + 1))) {
-      if (!seekSet(32*(index + 1))) return false;
+    if (curPosition_ != (32UL*(index + 1))) {
+      if (!seekSet(32UL*(index + 1))) return false;
     }
   }
   // don't try to delete root
@@ -925,7 +1076,7 @@ uint8_t SdFile::seekSet(uint32_t pos) {
     // set position to start of file
     curCluster_ = 0;
     curPosition_ = 0;
-    return true;
+    return readAhead() ? readAheadStart(false) : true;
   }
   // calculate cluster index for cur and new position
   uint32_t nCur = (curPosition_ - 1) >> (vol_->clusterSizeShift_ + 9);
@@ -942,7 +1093,27 @@ uint8_t SdFile::seekSet(uint32_t pos) {
     if (!vol_->fatGet(curCluster_, &curCluster_)) return false;
   }
   curPosition_ = pos;
-  return true;
+  return readAhead() ? readAheadStart(false) : true;
+}
+//------------------------------------------------------------------------------
+/**
+ * Read ahead for files that are read in order, like images and sound.
+ *
+ * When a read() reaches the end of a block, or after seekSet(), a multiple
+ * block read is started at the next block.  The card finds the block while
+ * the caller uses the current one, so the next read doesn't wait for the
+ * card's access time.  Reading or writing other blocks cancels the
+ * sequence.
+ *
+ * \return The value one, true, is returned for success and
+ * the value zero, false, is returned for failure.
+ * Reasons for failure include this SdFile is not an open file
+ * or an I/O error.
+ */
+uint8_t SdFile::setReadAhead(void) {
+  if (!isFile()) return false;
+  flags_ |= F_FILE_READ_AHEAD;
+  return readAheadStart(false);
 }
 //------------------------------------------------------------------------------
 /**
@@ -977,6 +1148,7 @@ uint8_t SdFile::sync(void) {
     // clear directory dirty
     flags_ &= ~F_FILE_DIR_DIRTY;
   }
+  if (!vol_->fsInfoSync()) return false;
   return SdVolume::cacheFlush();
 }
 //------------------------------------------------------------------------------
@@ -1170,24 +1342,30 @@ size_t SdFile::write(const void* buf, uint16_t nbyte) {
     if (n == 512) {
       // full block - don't need to use cache
       // invalidate cache if block is in cache
-      if (SdVolume::cacheBlockNumber_ == block) {
-        SdVolume::cacheBlockNumber_ = 0XFFFFFFFF;
+      SdVolume::cacheInvalidate(block);
+      // continue a multiple block write of a contiguous run, pre-erase
+      // the whole blocks of this call for a new sequence, but never beyond
+      // this cluster: the blocks after it may belong to another file and
+      // a pre-erased block that isn't written has undefined contents
+      uint32_t eraseCount = nToWrite >> 9;
+      uint8_t clusterLeft = vol_->blocksPerCluster() - blockOfCluster;
+      if (eraseCount > clusterLeft) eraseCount = clusterLeft;
+      if (!SdVolume::streamWrite(block, src, eraseCount)) {
+        goto writeErrorReturn;
       }
-      if (!vol_->writeBlock(block, src)) goto writeErrorReturn;
       src += 512;
     } else {
       if (blockOffset == 0 && curPosition_ >= fileSize_) {
         // start of new block don't need to read into cache
-        if (!SdVolume::cacheFlush()) goto writeErrorReturn;
-        SdVolume::cacheBlockNumber_ = block;
-        SdVolume::cacheSetDirty();
+        if (!SdVolume::cacheRawBlock(block,
+          SdVolume::CACHE_RESERVE_FOR_WRITE)) goto writeErrorReturn;
       } else {
         // rewrite part of block
         if (!SdVolume::cacheRawBlock(block, SdVolume::CACHE_FOR_WRITE)) {
           goto writeErrorReturn;
         }
       }
-      uint8_t* dst = SdVolume::cacheBuffer_.data + blockOffset;
+      uint8_t* dst = SdVolume::cacheBuffer_->data + blockOffset;
       uint8_t* end = dst + n;
       while (dst != end) *dst++ = *src++;
     }
@@ -17,15 +17,38 @@
  * along with the Arduino SdFat Library.  If not, see
  * <http://www.gnu.org/licenses/>.
  */
+#include <string.h>
 #include <SdFat.h>
 //------------------------------------------------------------------------------
 // raw block cache
+cache_t  SdVolume::cacheBlocks_[SD_CACHE_BLOCKS];    // 512 byte blocks
+uint32_t SdVolume::cacheNumbers_[SD_CACHE_BLOCKS];  // set by cacheInvalidate()
+uint32_t SdVolume::cacheMirror_[SD_CACHE_BLOCKS];   // mirror blocks for FAT
+uint8_t  SdVolume::cacheDirty_[SD_CACHE_BLOCKS];    // cacheWrite() if true
+uint8_t  SdVolume::cacheAge_[SD_CACHE_BLOCKS];      // LRU order in group
+uint8_t  SdVolume::cacheCurrent_ = SD_CACHE_FAT_BLOCKS;
+cache_t* SdVolume::cacheBuffer_ = &SdVolume::cacheBlocks_[SD_CACHE_FAT_BLOCKS];
 // init cacheBlockNumber_to invalid SD block number
 uint32_t SdVolume::cacheBlockNumber_ = 0XFFFFFFFF;
-cache_t  SdVolume::cacheBuffer_;     // 512 byte cache for Sd2Card
+uint32_t SdVolume::cacheHits_[2];
+uint32_t SdVolume::cacheMisses_[2];
 Sd2Card* SdVolume::sdCard_;          // pointer to SD card object
-uint8_t  SdVolume::cacheDirty_ = 0;  // cacheFlush() will write block if true
-uint32_t SdVolume::cacheMirrorBlock_ = 0;  // mirror  block for second FAT
+uint8_t  SdVolume::streamMode_ = SdVolume::STREAM_NONE;
+uint32_t SdVolume::streamBlock_;     // next block of multiple block sequence
+#if SD_FREE_MAP_SIZE
+uint8_t  SdVolume::freeMap_[SD_FREE_MAP_SIZE];
+uint8_t  SdVolume::freeMapShift_;
+#endif  // SD_FREE_MAP_SIZE
+#if SD_DIR_CACHE_SIZE
+SdVolume::dirCache_t SdVolume::dirCache_[SD_DIR_CACHE_SIZE];
+#endif  // SD_DIR_CACHE_SIZE
+#if SD_DIR_INDEX_SIZE
+uint8_t  SdVolume::dirIndexUsed_ = false;
+uint32_t SdVolume::dirIndexDir_;
+uint16_t SdVolume::dirIndexCount_;
+uint8_t  SdVolume::dirIndexHash_[SD_DIR_INDEX_SIZE];
+uint32_t SdVolume::dirIndexBlock_[SD_DIR_INDEX_SIZE/16];
+#endif  // SD_DIR_INDEX_SIZE
 //------------------------------------------------------------------------------
 // find a contiguous group of clusters
 uint8_t SdVolume::allocContiguous(uint32_t count, uint32_t* curCluster) {
@@ -55,6 +78,16 @@ uint8_t SdVolume::allocContiguous(uint32_t count, uint32_t* curCluster) {
   // last cluster of FAT
   uint32_t fatEnd = clusterCount_ + 1;
 
+#if SD_FREE_MAP_SIZE
+  // clusters in a group of the free map minus one
+  uint8_t mapShift = fatBlockShift() + freeMapShift_;
+  uint32_t mapMask = (1UL << mapShift) - 1;
+
+  // free clusters found in the current group, if scanned from its start
+  uint32_t mapFree = 0;
+  uint8_t mapCounting = false;
+#endif  // SD_FREE_MAP_SIZE
+
   // search the FAT for free clusters
   for (uint32_t n = 0;; n++, endCluster++) {
     // can't find space checked all clusters
@@ -64,9 +97,38 @@ uint8_t SdVolume::allocContiguous(uint32_t count, uint32_t* curCluster) {
     if (endCluster > fatEnd) {
       bgnCluster = endCluster = 2;
     }
+#if SD_FREE_MAP_SIZE
+    uint8_t* map = &freeMap_[endCluster >> mapShift];
+    if (*map == 0) {
+      // no free cluster in this group - skip to the next one
+      uint32_t next = (endCluster | mapMask) + 1;
+      n += next - endCluster - 1;
+      endCluster = next - 1;
+      bgnCluster = next;
+      mapCounting = false;
+      continue;
+    }
+    if ((endCluster & mapMask) == 0 || endCluster == 2) {
+      // start of group
+      mapFree = 0;
+      mapCounting = true;
+    }
+#endif  // SD_FREE_MAP_SIZE
     uint32_t f;
     if (!fatGet(endCluster, &f)) return false;
 
+#if SD_FREE_MAP_SIZE
+    if (f == 0) mapFree++;
+    if (mapCounting &&
+      ((endCluster & mapMask) == mapMask || endCluster == fatEnd)) {
+      // whole group scanned - remember the count
+      if (*map == FREE_MAP_UNKNOWN) {
+        *map = mapFree < FREE_MAP_MANY ? mapFree : FREE_MAP_MANY;
+      }
+      mapCounting = false;
+    }
+#endif  // SD_FREE_MAP_SIZE
+
     if (f != 0) {
       // cluster in use try next cluster as bgnCluster
       bgnCluster = endCluster + 1;
@@ -96,43 +158,205 @@ uint8_t SdVolume::allocContiguous(uint32_t count, uint32_t* curCluster) {
   return true;
 }
 //------------------------------------------------------------------------------
+// Find or load a block.  FAT blocks go to the FAT group of the cache,
+// others to the data group.  Replace the least recently used block of
+// the group if blockNumber is not in the cache.
+cache_t* SdVolume::cacheBlock(uint32_t blockNumber, uint8_t action,
+                              uint8_t fat) {
+  uint8_t i = cacheFind(blockNumber);
+  if (i < SD_CACHE_BLOCKS) {
+    cacheHits_[fat]++;
+  } else {
+    cacheMisses_[fat]++;
+    uint8_t first = fat && SD_CACHE_FAT_BLOCKS ? 0 : SD_CACHE_FAT_BLOCKS;
+    uint8_t last = fat && SD_CACHE_FAT_BLOCKS ?
+                     SD_CACHE_FAT_BLOCKS : SD_CACHE_BLOCKS;
+    // use an invalid block or the oldest one
+    i = first;
+    for (uint8_t j = first; j < last; j++) {
+      if (cacheNumbers_[j] == 0XFFFFFFFF) {
+        i = j;
+        break;
+      }
+      if (cacheAge_[j] > cacheAge_[i]) i = j;
+    }
+    if (!cacheWrite(i)) return 0;
+    cacheNumbers_[i] = 0XFFFFFFFF;
+    if (i == cacheCurrent_) cacheBlockNumber_ = 0XFFFFFFFF;
+    if (action & CACHE_OPTION_NO_READ) {
+      // block will be overwritten
+    } else if (fat) {
+      if (!streamStop()) return 0;
+      if (!sdCard_->readBlock(blockNumber, cacheBlocks_[i].data)) return 0;
+    } else {
+      // data blocks are usually read in order, continue a sequence
+      if (!streamRead(blockNumber, cacheBlocks_[i].data)) return 0;
+    }
+    cacheNumbers_[i] = blockNumber;
+    if (i == cacheCurrent_) cacheBlockNumber_ = blockNumber;
+  }
+  cacheDirty_[i] |= action & CACHE_FOR_WRITE;
+  cacheUse(i);
+  return &cacheBlocks_[i];
+}
+//------------------------------------------------------------------------------
+void SdVolume::cacheClearStats(void) {
+  for (uint8_t i = 0; i < 2; i++) {
+    cacheHits_[i] = 0;
+    cacheMisses_[i] = 0;
+  }
+}
+//------------------------------------------------------------------------------
+// return index of cache block for blockNumber or SD_CACHE_BLOCKS
+uint8_t SdVolume::cacheFind(uint32_t blockNumber) {
+  uint8_t i = 0;
+  while (i < SD_CACHE_BLOCKS && cacheNumbers_[i] != blockNumber) i++;
+  return i;
+}
+//------------------------------------------------------------------------------
+// write all dirty blocks and end a multiple block sequence
 uint8_t SdVolume::cacheFlush(void) {
-  if (cacheDirty_) {
-    if (!sdCard_->writeBlock(cacheBlockNumber_, cacheBuffer_.data)) {
+  for (uint8_t i = 0; i < SD_CACHE_BLOCKS; i++) {
+    if (!cacheWrite(i)) return false;
+  }
+  return streamStop();
+}
+//------------------------------------------------------------------------------
+// forget all cached blocks without writing them
+void SdVolume::cacheInvalidate(void) {
+  for (uint8_t i = 0; i < SD_CACHE_BLOCKS; i++) {
+    cacheNumbers_[i] = 0XFFFFFFFF;
+    cacheMirror_[i] = 0;
+    cacheDirty_[i] = 0;
+    cacheAge_[i] = i < SD_CACHE_FAT_BLOCKS ? i : i - SD_CACHE_FAT_BLOCKS;
+  }
+  cacheBlockNumber_ = 0XFFFFFFFF;
+}
+//------------------------------------------------------------------------------
+// forget blockNumber if it is in the cache, used if the block is written
+// without the cache
+void SdVolume::cacheInvalidate(uint32_t blockNumber) {
+  uint8_t i = cacheFind(blockNumber);
+  if (i < SD_CACHE_BLOCKS) {
+    cacheNumbers_[i] = 0XFFFFFFFF;
+    cacheMirror_[i] = 0;
+    cacheDirty_[i] = 0;
+    if (i == cacheCurrent_) cacheBlockNumber_ = 0XFFFFFFFF;
+  }
+}
+//------------------------------------------------------------------------------
+// cache a data or directory block and make it the current block cacheBuffer_
+uint8_t SdVolume::cacheRawBlock(uint32_t blockNumber, uint8_t action) {
+  cache_t* pc = cacheBlock(blockNumber, action, 0);
+  if (!pc) return false;
+  cacheCurrent_ = pc - cacheBlocks_;
+  cacheBuffer_ = pc;
+  cacheBlockNumber_ = blockNumber;
+  return true;
+}
+//------------------------------------------------------------------------------
+// make block i the most recently used block of its group
+void SdVolume::cacheUse(uint8_t i) {
+  uint8_t first = i < SD_CACHE_FAT_BLOCKS ? 0 : SD_CACHE_FAT_BLOCKS;
+  uint8_t last = i < SD_CACHE_FAT_BLOCKS ? SD_CACHE_FAT_BLOCKS : SD_CACHE_BLOCKS;
+  for (uint8_t j = first; j < last; j++) {
+    if (cacheAge_[j] < cacheAge_[i]) cacheAge_[j]++;
+  }
+  cacheAge_[i] = 0;
+}
+//------------------------------------------------------------------------------
+// write cache block i if it is dirty
+uint8_t SdVolume::cacheWrite(uint8_t i) {
+  if (cacheDirty_[i]) {
+    if (i >= SD_CACHE_FAT_BLOCKS && !cacheMirror_[i]) {
+      // data block - file data is usually written in block order, so it
+      // may continue the sequence of the previous block
+      if (!streamWrite(cacheNumbers_[i], cacheBlocks_[i].data, 1)) {
+        return false;
+      }
+      cacheDirty_[i] = 0;
+      return true;
+    }
+    if (!streamStop()) return false;
+    if (!sdCard_->writeBlock(cacheNumbers_[i], cacheBlocks_[i].data)) {
       return false;
     }
     // mirror FAT tables
-    if (cacheMirrorBlock_) {
-      if (!sdCard_->writeBlock(cacheMirrorBlock_, cacheBuffer_.data)) {
+    if (cacheMirror_[i]) {
+      if (!sdCard_->writeBlock(cacheMirror_[i], cacheBlocks_[i].data)) {
         return false;
       }
-      cacheMirrorBlock_ = 0;
+      cacheMirror_[i] = 0;
     }
-    cacheDirty_ = 0;
+    cacheDirty_[i] = 0;
   }
   return true;
 }
 //------------------------------------------------------------------------------
-uint8_t SdVolume::cacheRawBlock(uint32_t blockNumber, uint8_t action) {
-  if (cacheBlockNumber_ != blockNumber) {
-    if (!cacheFlush()) return false;
-    if (!sdCard_->readBlock(blockNumber, cacheBuffer_.data)) return false;
-    cacheBlockNumber_ = blockNumber;
+// Start a multiple block read sequence at block, so the card reads it before
+// streamRead() is called for it.  Nothing is done if the block is cached or
+// is the next block of the sequence.
+uint8_t SdVolume::streamPrefetch(uint32_t block) {
+  if (cacheFind(block) != SD_CACHE_BLOCKS) return true;
+  if (streamMode_ == STREAM_READ && block == streamBlock_) return true;
+  if (!streamStop()) return false;
+  if (!sdCard_->readStart(block)) return false;
+  streamMode_ = STREAM_READ;
+  streamBlock_ = block;
+  return true;
+}
+//------------------------------------------------------------------------------
+// read a block with a multiple block read sequence, continue the
+// sequence if block follows the last block read
+uint8_t SdVolume::streamRead(uint32_t block, uint8_t* dst) {
+  if (streamMode_ != STREAM_READ || block != streamBlock_) {
+    if (!streamStop()) return false;
+    if (!sdCard_->readStart(block)) return false;
+    streamMode_ = STREAM_READ;
+  }
+  if (!sdCard_->readData(dst)) {
+    streamStop();
+    return false;
+  }
+  streamBlock_ = block + 1;
+  return true;
+}
+//------------------------------------------------------------------------------
+// end a multiple block sequence - must be called before other card commands
+uint8_t SdVolume::streamStop(void) {
+  uint8_t mode = streamMode_;
+  streamMode_ = STREAM_NONE;
+  if (mode == STREAM_READ) return sdCard_->readStop();
+  if (mode == STREAM_WRITE) return sdCard_->writeStop();
+  return true;
+}
+//------------------------------------------------------------------------------
+// write a block with a multiple block write sequence, continue the
+// sequence if block follows the last block written.  eraseCount is
+// the number of blocks to pre-erase for a new sequence.
+uint8_t SdVolume::streamWrite(uint32_t block, const uint8_t* src,
+                              uint32_t eraseCount) {
+  if (streamMode_ != STREAM_WRITE || block != streamBlock_) {
+    if (!streamStop()) return false;
+    if (!sdCard_->writeStart(block, eraseCount)) return false;
+    streamMode_ = STREAM_WRITE;
+  }
+  if (!sdCard_->writeData(src)) {
+    streamStop();
+    return false;
   }
-  cacheDirty_ |= action;
+  streamBlock_ = block + 1;
   return true;
 }
 //------------------------------------------------------------------------------
 // cache a zero block for blockNumber
 uint8_t SdVolume::cacheZeroBlock(uint32_t blockNumber) {
-  if (!cacheFlush()) return false;
+  if (!cacheRawBlock(blockNumber, CACHE_RESERVE_FOR_WRITE)) return false;
 
-  // loop take less flash than memset(cacheBuffer_.data, 0, 512);
+  // loop take less flash than memset(cacheBuffer_->data, 0, 512);
   for (uint16_t i = 0; i < 512; i++) {
-    cacheBuffer_.data[i] = 0;
+    cacheBuffer_->data[i] = 0;
   }
-  cacheBlockNumber_ = blockNumber;
-  cacheSetDirty();
   return true;
 }
 //------------------------------------------------------------------------------
@@ -147,18 +371,126 @@ uint8_t SdVolume::chainSize(uint32_t cluster, uint32_t* size) const {
   return true;
 }
 //------------------------------------------------------------------------------
+// remember the location of a directory entry found by name
+void SdVolume::dirCacheAdd(uint32_t dir, const uint8_t* name,
+                           uint32_t block, uint8_t index) {
+#if SD_DIR_CACHE_SIZE
+  // use the entry for the name or the least recently used entry
+  uint8_t i = 0;
+  for (uint8_t j = 0; j < SD_DIR_CACHE_SIZE; j++) {
+    dirCache_t* c = &dirCache_[j];
+    if (c->block && c->dir == dir && !memcmp(c->name, name, 11)) {
+      i = j;
+      break;
+    }
+    if (c->age > dirCache_[i].age) i = j;
+  }
+  dirCache_[i].dir = dir;
+  dirCache_[i].block = block;
+  dirCache_[i].index = index;
+  memcpy(dirCache_[i].name, name, 11);
+  // make it the most recent entry
+  for (uint8_t j = 0; j < SD_DIR_CACHE_SIZE; j++) {
+    if (dirCache_[j].age < dirCache_[i].age) dirCache_[j].age++;
+  }
+  dirCache_[i].age = 0;
+#endif  // SD_DIR_CACHE_SIZE
+}
+//------------------------------------------------------------------------------
+// Find a remembered directory entry.  The entry's block is checked so a
+// removed or replaced entry is not returned.  The block is left in the cache.
+uint8_t SdVolume::dirCacheFind(uint32_t dir, const uint8_t* name,
+                               uint32_t* block, uint8_t* index) {
+#if SD_DIR_CACHE_SIZE
+  for (uint8_t i = 0; i < SD_DIR_CACHE_SIZE; i++) {
+    dirCache_t* c = &dirCache_[i];
+    if (!c->block || c->dir != dir || memcmp(c->name, name, 11)) continue;
+    if (!cacheRawBlock(c->block, CACHE_FOR_READ)) return false;
+    if (memcmp(cacheBuffer_->dir[c->index].name, name, 11)) {
+      // entry has changed
+      c->block = 0;
+      return false;
+    }
+    *block = c->block;
+    *index = c->index;
+    dirCacheAdd(dir, name, *block, *index);
+    return true;
+  }
+#endif  // SD_DIR_CACHE_SIZE
+  return false;
+}
+//------------------------------------------------------------------------------
+// forget all directory entries and the name index
+void SdVolume::dirCacheInvalidate(void) {
+#if SD_DIR_CACHE_SIZE
+  for (uint8_t i = 0; i < SD_DIR_CACHE_SIZE; i++) {
+    dirCache_[i].block = 0;
+    dirCache_[i].age = i;
+  }
+#endif  // SD_DIR_CACHE_SIZE
+#if SD_DIR_INDEX_SIZE
+  dirIndexUsed_ = false;
+#endif  // SD_DIR_INDEX_SIZE
+}
+//------------------------------------------------------------------------------
+// Hash of a directory entry name for the name index.  Uses the long file
+// name checksum, values for free and deleted entries are reserved.
+uint8_t SdVolume::dirHash(const uint8_t* name) {
+  if (name[0] == DIR_NAME_FREE) return DIR_HASH_FREE;
+  if (name[0] == DIR_NAME_DELETED) return DIR_HASH_DELETED;
+  uint8_t sum = 0;
+  for (uint8_t i = 0; i < 11; i++) {
+    sum = ((sum & 1) << 7) + (sum >> 1) + name[i];
+  }
+  return sum > DIR_HASH_DELETED ? sum : sum + 2;
+}
+//------------------------------------------------------------------------------
+// Add entry n of the indexed directory, found in the current cache block.
+// Only the next entry after the indexed ones is added.
+void SdVolume::dirIndexAdd(uint16_t n, const uint8_t* name) {
+#if SD_DIR_INDEX_SIZE
+  if (!dirIndexUsed_ || n != dirIndexCount_ || n >= SD_DIR_INDEX_SIZE) return;
+  dirIndexHash_[n] = dirHash(name);
+  dirIndexBlock_[n >> 4] = cacheBlockNumber_;
+  dirIndexCount_++;
+#endif  // SD_DIR_INDEX_SIZE
+}
+//------------------------------------------------------------------------------
+// update the index for a directory entry that was created or removed
+void SdVolume::dirIndexUpdate(uint32_t block, uint8_t index,
+                              const uint8_t* name) {
+#if SD_DIR_INDEX_SIZE
+  if (!dirIndexUsed_) return;
+  for (uint16_t n = index; n < dirIndexCount_; n += 16) {
+    if (dirIndexBlock_[n >> 4] == block) {
+      dirIndexHash_[n] = dirHash(name);
+      return;
+    }
+  }
+#endif  // SD_DIR_INDEX_SIZE
+}
+//------------------------------------------------------------------------------
+// start a new index if dir is not the indexed directory
+void SdVolume::dirIndexUse(uint32_t dir) {
+#if SD_DIR_INDEX_SIZE
+  if (dirIndexUsed_ && dirIndexDir_ == dir) return;
+  dirIndexUsed_ = true;
+  dirIndexDir_ = dir;
+  dirIndexCount_ = 0;
+#endif  // SD_DIR_INDEX_SIZE
+}
+//------------------------------------------------------------------------------
 // Fetch a FAT entry
 uint8_t SdVolume::fatGet(uint32_t cluster, uint32_t* value) const {
   if (cluster > (clusterCount_ + 1)) return false;
   uint32_t lba = fatStartBlock_;
   lba += fatType_ == 16 ? cluster >> 8 : cluster >> 7;
-  if (lba != cacheBlockNumber_) {
-    if (!cacheRawBlock(lba, CACHE_FOR_READ)) return false;
-  }
+  cache_t* pc = cacheFatBlock(lba, CACHE_FOR_READ);
+  if (!pc) return false;
   if (fatType_ == 16) {
-    *value = cacheBuffer_.fat16[cluster & 0XFF];
+    *value = pc->fat16[cluster & 0XFF];
   } else {
-    *value = cacheBuffer_.fat32[cluster & 0X7F] & FAT32MASK;
+    *value = pc->fat32[cluster & 0X7F] & FAT32MASK;
   }
   return true;
 }
@@ -174,29 +506,37 @@ uint8_t SdVolume::fatPut(uint32_t cluster, uint32_t value) {
   // calculate block address for entry
   uint32_t lba = fatStartBlock_;
   lba += fatType_ == 16 ? cluster >> 8 : cluster >> 7;
+  cache_t* pc = cacheFatBlock(lba, CACHE_FOR_WRITE);
+  if (!pc) return false;
 
-  if (lba != cacheBlockNumber_) {
-    if (!cacheRawBlock(lba, CACHE_FOR_READ)) return false;
-  }
   // store entry
+  uint32_t old;
   if (fatType_ == 16) {
-    cacheBuffer_.fat16[cluster & 0XFF] = value;
+    old = pc->fat16[cluster & 0XFF];
+    pc->fat16[cluster & 0XFF] = value;
   } else {
-    cacheBuffer_.fat32[cluster & 0X7F] = value;
+    old = pc->fat32[cluster & 0X7F] & FAT32MASK;
+    pc->fat32[cluster & 0X7F] = value;
+  }
+  // cluster allocated or freed
+  if ((old == 0) != (value == 0)) {
+    fsInfoChanged_ = true;
+#if SD_FREE_MAP_SIZE
+    freeMapUpdate(cluster, value == 0);
+#endif  // SD_FREE_MAP_SIZE
   }
-  cacheSetDirty();
-
   // mirror second FAT
-  if (fatCount_ > 1) cacheMirrorBlock_ = lba + blocksPerFat_;
+  if (fatCount_ > 1) cacheMirror_[pc - cacheBlocks_] = lba + blocksPerFat_;
   return true;
 }
 //------------------------------------------------------------------------------
 // free a cluster chain
 uint8_t SdVolume::freeChain(uint32_t cluster) {
-  // clear free cluster location
-  allocSearchStart_ = 2;
-
   do {
+    // start the next search at the lowest cluster freed, not at cluster
+    // two, so the FSINFO hint stays useful after a remove
+    if (cluster < allocSearchStart_) allocSearchStart_ = cluster;
+
     uint32_t next;
     if (!fatGet(cluster, &next)) return false;
 
@@ -209,6 +549,41 @@ uint8_t SdVolume::freeChain(uint32_t cluster) {
   return true;
 }
 //------------------------------------------------------------------------------
+#if SD_FREE_MAP_SIZE
+// keep the free count of the cluster's group, if it is known
+void SdVolume::freeMapUpdate(uint32_t cluster, uint8_t freed) {
+  uint8_t* map = &freeMap_[cluster >> (fatBlockShift() + freeMapShift_)];
+  if (*map == FREE_MAP_UNKNOWN) return;
+  if (freed) {
+    if (*map < FREE_MAP_MANY) (*map)++;
+  } else {
+    // a group with many free clusters must be counted again
+    if (*map == FREE_MAP_MANY) {
+      *map = FREE_MAP_UNKNOWN;
+    } else if (*map) {
+      (*map)--;
+    }
+  }
+}
+#endif  // SD_FREE_MAP_SIZE
+//------------------------------------------------------------------------------
+// Store the next free cluster hint in the FAT32 FSINFO block.  The block is
+// only written if the hint moved to another FAT block, or to invalidate the
+// free count the first time clusters are allocated or freed.
+uint8_t SdVolume::fsInfoSync(void) {
+  if (!fsInfoBlock_) return true;
+  if ((allocSearchStart_ >> 7) == (fsInfoNextFree_ >> 7) &&
+    !(fsInfoChanged_ && fsInfoFreeCount_)) return true;
+
+  if (!cacheRawBlock(fsInfoBlock_, CACHE_FOR_WRITE)) return false;
+  // the free count isn't maintained
+  cacheBuffer_->fsinfo.freeCount = 0XFFFFFFFF;
+  cacheBuffer_->fsinfo.nextFree = allocSearchStart_;
+  fsInfoNextFree_ = allocSearchStart_;
+  fsInfoFreeCount_ = false;
+  return true;
+}
+//------------------------------------------------------------------------------
 /**
  * Initialize a FAT volume.
  *
@@ -226,13 +601,16 @@ uint8_t SdVolume::freeChain(uint32_t cluster) {
  */
 uint8_t SdVolume::init(Sd2Card* dev, uint8_t part) {
   uint32_t volumeStartBlock = 0;
+  // end a sequence of a previous init, the card may have been reset
+  if (sdCard_) streamStop();
   sdCard_ = dev;
+  cacheInvalidate();
   // if part == 0 assume super floppy with FAT boot sector in block zero
   // if part > 0 assume mbr volume with partition table
   if (part) {
     if (part > 4)return false;
     if (!cacheRawBlock(volumeStartBlock, CACHE_FOR_READ)) return false;
-    part_t* p = &cacheBuffer_.mbr.part[part-1];
+    part_t* p = &cacheBuffer_->mbr.part[part-1];
     if ((p->boot & 0X7F) !=0  ||
       p->totalSectors < 100 ||
       p->firstSector == 0) {
@@ -242,7 +620,7 @@ uint8_t SdVolume::init(Sd2Card* dev, uint8_t part) {
     volumeStartBlock = p->firstSector;
   }
   if (!cacheRawBlock(volumeStartBlock, CACHE_FOR_READ)) return false;
-  bpb_t* bpb = &cacheBuffer_.fbs.bpb;
+  bpb_t* bpb = &cacheBuffer_->fbs.bpb;
   if (bpb->bytesPerSector != 512 ||
     bpb->fatCount == 0 ||
     bpb->reservedSectorCount == 0 ||
@@ -251,6 +629,7 @@ uint8_t SdVolume::init(Sd2Card* dev, uint8_t part) {
       return false;
   }
   fatCount_ = bpb->fatCount;
+  uint16_t fsInfo = bpb->fat32FSInfo;
   blocksPerCluster_ = bpb->sectorsPerCluster;
 
   // determine shift that is same as multiply by blocksPerCluster_
@@ -291,5 +670,39 @@ uint8_t SdVolume::init(Sd2Card* dev, uint8_t part) {
     rootDirStart_ = bpb->fat32RootCluster;
     fatType_ = 32;
   }
+#if SD_FREE_MAP_SIZE
+  // groups of FAT blocks so the map covers the FAT
+  freeMapShift_ = 0;
+  while (((clusterCount_ + 1) >> (fatBlockShift() + freeMapShift_))
+    >= SD_FREE_MAP_SIZE) {
+    freeMapShift_++;
+  }
+  for (uint16_t i = 0; i < SD_FREE_MAP_SIZE; i++) {
+    freeMap_[i] = FREE_MAP_UNKNOWN;
+  }
+#endif  // SD_FREE_MAP_SIZE
+
+  // directory entries of another volume may be cached
+  dirCacheInvalidate();
+
+  // start the free cluster search at the FSINFO hint
+  allocSearchStart_ = 2;
+  fsInfoBlock_ = 0;
+  fsInfoChanged_ = false;
+  if (fatType_ == 32 && fsInfo != 0 && fsInfo != 0XFFFF) {
+    if (!cacheRawBlock(volumeStartBlock + fsInfo, CACHE_FOR_READ)) {
+      return false;
+    }
+    fsinfo_t* fsi = &cacheBuffer_->fsinfo;
+    if (fsi->leadSignature == FSINFO_LEAD_SIG &&
+      fsi->structSignature == FSINFO_STRUCT_SIG) {
+      fsInfoBlock_ = volumeStartBlock + fsInfo;
+      fsInfoNextFree_ = fsi->nextFree;
+      fsInfoFreeCount_ = fsi->freeCount != 0XFFFFFFFF;
+      if (fsi->nextFree >= 2 && fsi->nextFree <= clusterCount_ + 1) {
+        allocSearchStart_ = fsi->nextFree;
+      }
+    }
+  }
   return true;
 }
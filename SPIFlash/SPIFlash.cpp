@@ -149,20 +149,26 @@ void SPIFlash::writeByte(long addr, uint8_t byt) {
   unselect();
 }
 
-/// write 1-256 bytes to flash memory
+/// write any number of bytes to flash memory
 /// WARNING: you can only write to previously erased memory locations (see datasheet)
 ///          use the block erase commands to first clear memory (write 0xFFs)
-/// WARNING: if you write beyond a page boundary (or more than 256bytes),
-///          the bytes will wrap around and start overwriting at the beginning of that same page
-///          see datasheet for more details
-void SPIFlash::writeBytes(long addr, const void* buf, uint8_t len) {
-  command(SPIFLASH_BYTEPAGEPROGRAM, true);  // Byte/Page Program
-  SPI.transfer(addr >> 16);
-  SPI.transfer(addr >> 8);
-  SPI.transfer(addr);
-  for (uint8_t i = 0; i < len; i++)
-    SPI.transfer(((byte*) buf)[i]);
-  unselect();
+/// a page program wraps around at the 256 byte page boundary, so the data is split there
+/// into one program per page; each program waits for the previous one to complete
+void SPIFlash::writeBytes(long addr, const void* buf, word len) {
+  const byte* p = (const byte*) buf;
+  while (len)
+  {
+    word n = SPIFLASH_PAGESIZE - (addr & (SPIFLASH_PAGESIZE-1));
+    if (n > len) n = len;
+    command(SPIFLASH_BYTEPAGEPROGRAM, true);  // Byte/Page Program
+    SPI.transfer(addr >> 16);
+    SPI.transfer(addr >> 8);
+    SPI.transfer(addr);
+    for (word i = 0; i < n; i++)
+      SPI.transfer(p[i]);
+    unselect();
+    addr += n; p += n; len -= n;
+  }
 }
 
 /// erase entire flash memory array
@@ -194,6 +200,42 @@ void SPIFlash::blockErase32K(long addr) {
   unselect();
 }
 
+/// erase a 64Kbyte block
+void SPIFlash::blockErase64K(long addr) {
+  command(SPIFLASH_BLOCKERASE_64K, true); // Block Erase
+  SPI.transfer(addr >> 16);
+  SPI.transfer(addr >> 8);
+  SPI.transfer(addr);
+  unselect();
+}
+
+/// size of the largest erase block (64K, 32K or 4K) that starts at address
+/// (4K aligned) and does not go beyond end
+long SPIFlash::eraseBlockSize(long addr, long end) {
+  if ((addr & 0xFFFF) == 0 && end - addr >= 0x10000) return 0x10000;
+  if ((addr & 0x7FFF) == 0 && end - addr >= 0x8000) return 0x8000;
+  return 0x1000;
+}
+
+/// erase the range addr..addr+len-1 with as few block erase commands as possible
+/// the range is extended to whole 4K blocks, so up to 4K before and after it are erased too
+/// returns the number of erase commands; the last erase may still be running (see busy())
+word SPIFlash::eraseRange(long addr, long len) {
+  long end = (addr + len + 0xFFF) & ~0xFFFL;
+  word count = 0;
+  addr &= ~0xFFFL;
+  while (addr < end)
+  {
+    long size = eraseBlockSize(addr, end);
+    if (size == 0x10000) blockErase64K(addr);
+    else if (size == 0x8000) blockErase32K(addr);
+    else blockErase4K(addr);
+    addr += size;
+    count++;
+  }
+  return count;
+}
+
 void SPIFlash::sleep() {
   command(SPIFLASH_SLEEP); // Block Erase
   unselect();
@@ -208,3 +250,61 @@ void SPIFlash::wakeup() {
 void SPIFlash::end() {
   SPI.end();
 }
+
+/// Writer for sequential data, see SPIFlash.h
+SPIFlashWriter::SPIFlashWriter(SPIFlash& flash) : _flash(flash) {
+  begin(0);
+}
+
+/// start writing at addr (the previous data should be flushed)
+void SPIFlashWriter::begin(long addr) {
+  _addr = addr;
+  _fill = 0;
+  _programs = 0;
+}
+
+/// write len bytes; full pages are programmed right away from buf,
+/// the rest is kept in the buffer until it is full or reaches a page boundary
+void SPIFlashWriter::write(const void* buf, word len) {
+  const byte* p = (const byte*) buf;
+  while (len)
+  {
+    word page = SPIFLASH_PAGESIZE - ((_addr + _fill) & (SPIFLASH_PAGESIZE-1));
+    if (_fill == 0 && len >= page)
+    {
+      // a complete page (rest): program it directly, no copy
+      program(p, page);
+      p += page; len -= page;
+      continue;
+    }
+    word n = SPIFLASH_WRITER_BUF - _fill;
+    if (n > page) n = page;
+    if (n > len) n = len;
+    memcpy(_buf + _fill, p, n);
+    _fill += n; p += n; len -= n;
+    if (_fill == SPIFLASH_WRITER_BUF || n == page) flush();
+  }
+}
+
+void SPIFlashWriter::write(byte b) {
+  write(&b, 1);
+}
+
+/// program the buffered bytes
+void SPIFlashWriter::flush() {
+  if (_fill) program(_buf, _fill);
+}
+
+/// true when the last program is complete and the next one can start without waiting
+boolean SPIFlashWriter::ready() {
+  return !_flash.busy();
+}
+
+/// start one page program at _addr (never crosses a page boundary) and leave without waiting for it
+/// buf is either the buffer or, when the buffer is empty, the caller's data
+void SPIFlashWriter::program(const byte* buf, word len) {
+  _flash.writeBytes(_addr, buf, len);
+  _addr += len;
+  _fill = 0;
+  _programs++;
+}
@@ -66,6 +66,15 @@
                                               // Example for Atmel-Adesto 4Mbit AT25DF041A: 0x1F44 (page 27: http://www.adestotech.com/sites/default/files/datasheets/doc3668.pdf)
                                               // Example for Winbond 4Mbit W25X40CL: 0xEF30 (page 14: http://www.winbond.com/NR/rdonlyres/6E25084C-0BFE-4B25-903D-AE10221A0929/0/W25X40CL.pdf)
 
+#define SPIFLASH_PAGESIZE         256         // a page program wraps around at this boundary
+#ifndef SPIFLASH_WRITER_BUF                   // SPIFlashWriter buffer for small writes (1..256 bytes)
+#if defined(RAMEND) && RAMEND < 0x1000
+#define SPIFLASH_WRITER_BUF       64          // 2K RAM boards (ATmega328P, 32u4): up to 4 programs per page
+#else
+#define SPIFLASH_WRITER_BUF       SPIFLASH_PAGESIZE // one program per page
+#endif
+#endif
+
 class SPIFlash {
 public:
   SPIFlash(byte slaveSelectPin, uint16_t jedecID=0);
@@ -75,11 +84,14 @@ public:
   byte readByte(long addr);
   void readBytes(long addr, void* buf, word len);
   void writeByte(long addr, byte byt);
-  void writeBytes(long addr, const void* buf, byte len);
+  void writeBytes(long addr, const void* buf, word len);
   boolean busy();
   void chipErase();
   void blockErase4K(long address);
   void blockErase32K(long address);
+  void blockErase64K(long address);
+  word eraseRange(long address, long len);
+  static long eraseBlockSize(long address, long end);
   word readDeviceId();
   void sleep();
   void wakeup();
@@ -91,4 +103,29 @@ protected:
   uint16_t _jedecID;
 };
 
+/// Sequential writer for logs and images: write() takes any length, the data goes into
+/// page programs that never cross a page boundary. Small writes are collected in a buffer.
+/// A program is started as soon as a page (or the buffer) is full and is not waited for:
+/// the caller prepares the next data while the chip is programming, the wait for busy()
+/// only happens when the next program is started.
+/// The written range must be erased before, see SPIFlash::eraseRange().
+class SPIFlashWriter {
+public:
+  SPIFlashWriter(SPIFlash& flash);
+  void begin(long addr);
+  void write(const void* buf, word len);
+  void write(byte b);
+  void flush();
+  boolean ready();
+  long position() { return _addr + _fill; }
+  word programs() { return _programs; }
+protected:
+  void program(const byte* buf, word len);
+  SPIFlash& _flash;
+  long _addr;            // flash address of _buf[0]
+  word _fill;            // bytes in _buf
+  word _programs;        // page programs started since begin()
+  byte _buf[SPIFLASH_WRITER_BUF];
+};
+
 #endif
\ No newline at end of file
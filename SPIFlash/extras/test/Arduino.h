@@ -0,0 +1,27 @@
+// Host build shim for the SPIFlash NOR flash model test (see norflash.cpp).
+// Only what SPIFlash.cpp uses is declared here.
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LOW    0
+#define HIGH   1
+#define INPUT  0
+#define OUTPUT 1
+
+typedef uint8_t byte;
+typedef uint16_t word;
+typedef bool boolean;
+
+#define noInterrupts()
+#define interrupts()
+
+// provided by the test
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+
+#endif
@@ -0,0 +1,27 @@
+// Host build shim for the SPIFlash NOR flash model test (see norflash.cpp).
+// SPI.transfer() goes to the flash model.
+
+#ifndef _SPI_H_INCLUDED
+#define _SPI_H_INCLUDED
+
+#include "Arduino.h"
+
+#define SPI_MODE0 0x00
+#define MSBFIRST 1
+#define SPI_CLOCK_DIV2 0x04
+
+uint8_t flashTransfer(uint8_t data); // provided by the test
+
+class SPIClass {
+public:
+  static uint8_t transfer(uint8_t data) { return flashTransfer(data); }
+  static void setDataMode(uint8_t) {}
+  static void setBitOrder(uint8_t) {}
+  static void setClockDivider(uint8_t) {}
+  static void begin() {}
+  static void end() {}
+};
+
+extern SPIClass SPI;
+
+#endif
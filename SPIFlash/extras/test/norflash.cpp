@@ -0,0 +1,271 @@
+/*
+ * SPIFlash - host-side NOR flash model and regression test.
+ *
+ * Builds SPIFlash.cpp for the host with SPI.transfer() going to a model of a
+ * 256 byte/page SPI NOR flash chip (4K/32K/64K block erase, like the W25X40CL):
+ * - a page program needs WEL, only clears bits (1 -> 0) and wraps around at the
+ *   page boundary like the real chip; programming a bit that isn't erased, a
+ *   program without write enable and a command while the chip is busy are
+ *   counted as violations
+ * - erase and program keep the chip busy for a number of status reads
+ * It checks writeBytes(), eraseRange() and SPIFlashWriter (data read back, no
+ * wrap, no violation, number of programs and erases) and that the model itself
+ * catches a missing erase and a wrapping page program.
+ * The exit status is nonzero if any check fails.
+ *
+ * Build and run from this directory:
+ *   g++ -O2 -DARDUINO=105 -I. -I../.. -o norflash norflash.cpp ../../SPIFlash.cpp && ./norflash
+ * add -DSPIFLASH_WRITER_BUF=64 to check the small writer buffer used on 2K RAM boards.
+ */
+
+#include "Arduino.h"
+#include "SPIFlash.h"
+
+#include <stdio.h>
+#include <vector>
+
+SPIClass SPI;
+
+// ----- NOR flash model -----
+
+#define FLASH_SIZE  0x100000L // 8 Mbit
+#define FLASH_CS    8
+#define BUSY_PROGRAM 3        // status reads until a page program is complete
+#define BUSY_ERASE   20       // status reads until a block erase is complete
+
+struct NorFlash {
+  std::vector<uint8_t> mem;
+  std::vector<uint8_t> cmd;   // bytes received since the chip was selected
+  bool selected;
+  bool wel;                   // write enable latch
+  int busy;                   // status reads left until the chip is ready
+  long programs, erases, wraps, violations, busyPolls;
+  long maxProgram;            // longest page program (bytes)
+
+  NorFlash() : mem(FLASH_SIZE, 0x00), selected(false), wel(false), busy(0) { clearStats(); }
+
+  void clearStats() { programs = erases = wraps = violations = busyPolls = maxProgram = 0; }
+
+  long address() { return ((long) cmd[1] << 16 | (long) cmd[2] << 8 | cmd[3]) & (FLASH_SIZE - 1); }
+
+  void select() { selected = true; cmd.clear(); }
+
+  uint8_t transfer(uint8_t data) {
+    if (!selected) { violations++; return 0xFF; }
+    cmd.push_back(data);
+    size_t n = cmd.size();
+    if (n == 1 && busy && data != SPIFLASH_STATUSREAD) violations++;
+    switch (cmd[0]) {
+      case SPIFLASH_STATUSREAD:
+        if (n == 2) {
+          if (busy) { busy--; busyPolls++; return 0x03; }
+          return wel ? 0x02 : 0x00;
+        }
+        break;
+      case SPIFLASH_IDREAD:
+        if (n == 2) return 0xEF;
+        if (n == 3) return 0x30;
+        break;
+      case SPIFLASH_ARRAYREADLOWFREQ:
+        if (n > 4) return mem[(address() + n - 5) & (FLASH_SIZE - 1)];
+        break;
+      case SPIFLASH_ARRAYREAD:
+        if (n > 5) return mem[(address() + n - 6) & (FLASH_SIZE - 1)];
+        break;
+    }
+    return 0xFF;
+  }
+
+  void deselect() {
+    selected = false;
+    if (cmd.empty()) return;
+    switch (cmd[0]) {
+      case SPIFLASH_WRITEENABLE:
+        wel = true;
+        break;
+      case SPIFLASH_WRITEDISABLE:
+        wel = false;
+        break;
+      case SPIFLASH_BYTEPAGEPROGRAM:
+        if (cmd.size() > 4) program(address(), &cmd[4], cmd.size() - 4);
+        break;
+      case SPIFLASH_BLOCKERASE_4K:  erase(0x1000); break;
+      case SPIFLASH_BLOCKERASE_32K: erase(0x8000); break;
+      case SPIFLASH_BLOCKERASE_64K: erase(0x10000); break;
+      case SPIFLASH_CHIPERASE:
+        if (!wel) { violations++; break; }
+        memset(&mem[0], 0xFF, FLASH_SIZE);
+        erases++; wel = false; busy = BUSY_ERASE;
+        break;
+    }
+  }
+
+  // the address counter wraps around inside the page; only the last 256 bytes are programmed
+  void program(long addr, const uint8_t* data, long len) {
+    if (!wel) { violations++; return; }
+    programs++;
+    if (len > maxProgram) maxProgram = len;
+    if ((addr & 0xFF) + len > 256) wraps++;
+    long skip = len > 256 ? len - 256 : 0;
+    for (long i = skip; i < len; i++) {
+      long a = (addr & ~0xFFL) | ((addr + i) & 0xFF);
+      if (data[i] & ~mem[a]) violations++; // can't turn a 0 into a 1
+      mem[a] &= data[i];
+    }
+    wel = false; busy = BUSY_PROGRAM;
+  }
+
+  void erase(long size) {
+    if (cmd.size() < 4 || !wel) { violations++; return; }
+    long addr = address() & ~(size - 1); // the chip ignores the low address bits
+    memset(&mem[addr], 0xFF, size);
+    erases++; wel = false; busy = BUSY_ERASE;
+  }
+};
+
+static NorFlash chip;
+
+uint8_t flashTransfer(uint8_t data) { return chip.transfer(data); }
+void pinMode(uint8_t pin, uint8_t mode) {}
+void digitalWrite(uint8_t pin, uint8_t val) {
+  if (pin != FLASH_CS) return;
+  if (val == LOW) chip.select(); else if (chip.selected) chip.deselect();
+}
+
+// ----- checks -----
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+  if (!ok) { printf("FAIL: %s\n", what); failures++; }
+}
+
+static uint8_t pattern(long addr) { return (uint8_t) (addr * 7 + (addr >> 8) * 13 + 1); }
+
+// bytes addr..addr+len-1 hold the pattern
+static bool verify(SPIFlash& flash, long addr, long len) {
+  std::vector<uint8_t> buf(len);
+  flash.readBytes(addr, &buf[0], len);
+  for (long i = 0; i < len; i++)
+    if (buf[i] != pattern(addr + i)) { printf("  mismatch at 0x%05lX\n", addr + i); return false; }
+  return true;
+}
+
+static long pagesTouched(long addr, long len) { return ((addr + len - 1) >> 8) - (addr >> 8) + 1; }
+
+// the model itself: a program onto unerased memory and a wrapping program must be noticed
+static void testModel(SPIFlash& flash) {
+  memset(&chip.mem[0], 0x00, FLASH_SIZE);
+  chip.clearStats();
+  uint8_t ff = 0xFF;
+  flash.writeByte(0x100, ff);
+  check(chip.violations == 1, "model: program onto unerased memory is a violation");
+
+  flash.blockErase4K(0);
+  chip.clearStats();
+  uint8_t data[16];
+  for (int i = 0; i < 16; i++) data[i] = i;
+  flash.command(SPIFLASH_BYTEPAGEPROGRAM, true); // raw page program across 0x100
+  SPI.transfer(0); SPI.transfer(0); SPI.transfer(0xF8);
+  for (int i = 0; i < 16; i++) SPI.transfer(data[i]);
+  digitalWrite(FLASH_CS, HIGH);
+  check(chip.wraps == 1, "model: page program across the page boundary wraps");
+  check(flash.readByte(0x00) == 8 && flash.readByte(0x100) == 0xFF, "model: wrapped bytes land at the page start");
+}
+
+static void testWriteBytes(SPIFlash& flash) {
+  static const long cases[][2] = { { 0x1F0, 700 }, { 0x2000, 256 }, { 0x30FF, 2 }, { 0x4001, 255 }, { 0x5080, 1000 } };
+  for (unsigned c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+    long addr = cases[c][0], len = cases[c][1];
+    flash.eraseRange(addr, len);
+    std::vector<uint8_t> buf(len);
+    for (long i = 0; i < len; i++) buf[i] = pattern(addr + i);
+    chip.clearStats();
+    flash.writeBytes(addr, &buf[0], len);
+    char what[80];
+    snprintf(what, sizeof(what), "writeBytes(0x%lX, %ld) reads back", addr, len);
+    check(verify(flash, addr, len), what);
+    check(chip.wraps == 0 && chip.violations == 0, "writeBytes: no wrap, no violation");
+    check(chip.programs == pagesTouched(addr, len), "writeBytes: one program per page");
+  }
+}
+
+static void testEraseRange(SPIFlash& flash) {
+  // { addr, len, erase commands, first and last erased address }
+  static const long cases[][5] = {
+    { 0x0000, 0x1000,  1, 0x00000, 0x00FFF },
+    { 0x1234, 0x20000, 11, 0x01000, 0x21FFF }, // 7 x 4K, 32K, 64K, 2 x 4K
+    { 0x10000, 0x10000, 1, 0x10000, 0x1FFFF },
+    { 0x18000, 0x18000, 2, 0x18000, 0x2FFFF },
+    { 0x0FFF, 2,       2, 0x00000, 0x01FFF },
+  };
+  for (unsigned c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+    long addr = cases[c][0], len = cases[c][1];
+    memset(&chip.mem[0], 0x00, FLASH_SIZE);
+    chip.clearStats();
+    word count = flash.eraseRange(addr, len);
+    long first = addr & ~0xFFFL, end = (addr + len + 0xFFF) & ~0xFFFL, expected = cases[c][2];
+    char what[80];
+    snprintf(what, sizeof(what), "eraseRange(0x%lX, 0x%lX): %ld erases", addr, len, expected);
+    check(count == expected && chip.erases == expected && chip.violations == 0, what);
+    bool ok = (first == cases[c][3] && end - 1 == cases[c][4]);
+    for (long a = 0; a < FLASH_SIZE && ok; a++)
+      ok = (chip.mem[a] == 0xFF) == (a >= first && a < end);
+    snprintf(what, sizeof(what), "eraseRange(0x%lX, 0x%lX) erases exactly 0x%lX..0x%lX", addr, len, cases[c][3], cases[c][4]);
+    check(ok, what);
+  }
+}
+
+static void testWriter(SPIFlash& flash, long addr, long total, bool erase) {
+  if (erase) flash.eraseRange(addr, total);
+  else memset(&chip.mem[0], 0x00, FLASH_SIZE);
+  while (flash.busy());
+  chip.clearStats();
+  SPIFlashWriter writer(flash);
+  writer.begin(addr);
+  srand(1);
+  long done = 0;
+  while (done < total) {
+    long n = rand() % 300 + 1;
+    if (rand() % 4 == 0) n = rand() % 8 + 1; // mostly small records
+    if (n > total - done) n = total - done;
+    uint8_t rec[300];
+    for (long i = 0; i < n; i++) rec[i] = pattern(addr + done + i);
+    writer.write(rec, (word) n);
+    done += n;
+  }
+  writer.flush();
+  check(writer.position() == addr + total, "writer: position() after flush");
+  if (!erase) {
+    check(chip.violations > 0, "writer: writing without erase is caught by the model");
+    return;
+  }
+  char what[80];
+  snprintf(what, sizeof(what), "writer at 0x%lX, %ld bytes reads back", addr, total);
+  check(verify(flash, addr, total), what);
+  check(chip.wraps == 0 && chip.violations == 0, "writer: no wrap, no violation");
+  check(writer.programs() == chip.programs, "writer: programs() counts the page programs");
+  long pages = pagesTouched(addr, total);
+  if (SPIFLASH_WRITER_BUF >= SPIFLASH_PAGESIZE)
+    check(chip.programs == pages, "writer: one program per page");
+  else
+    check(chip.programs <= pages * ((SPIFLASH_PAGESIZE + SPIFLASH_WRITER_BUF - 1) / SPIFLASH_WRITER_BUF + 1), "writer: programs per page bounded by the buffer size");
+  printf("writer: %ld bytes from 0x%05lX, buffer %d: %ld programs for %ld pages, %ld busy polls\n",
+         total, addr, SPIFLASH_WRITER_BUF, chip.programs, pages, chip.busyPolls);
+}
+
+int main() {
+  SPIFlash flash(FLASH_CS, 0xEF30);
+  check(flash.initialize(), "initialize() reads the JEDEC ID");
+
+  testModel(flash);
+  testWriteBytes(flash);
+  testEraseRange(flash);
+  testWriter(flash, 0x10010, 20000, true);
+  testWriter(flash, 0x20000, 4096, true);
+  testWriter(flash, 0x30000, 1000, false);
+
+  if (failures) printf("%d check(s) failed\n", failures);
+  else printf("all checks passed\n");
+  return failures ? 1 : 0;
+}
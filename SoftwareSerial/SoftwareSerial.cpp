@@ -133,9 +133,17 @@ const int XMIT_START_ADJUSTMENT = 6;
 // Statics
 //
 SoftwareSerial *SoftwareSerial::active_object = 0;
-char SoftwareSerial::_receive_buffer[_SS_MAX_RX_BUFF]; 
-volatile uint8_t SoftwareSerial::_receive_buffer_tail = 0;
-volatile uint8_t SoftwareSerial::_receive_buffer_head = 0;
+SoftwareSerial *SoftwareSerial::concurrent_list = 0;
+SoftwareSerial *SoftwareSerial::tx_object = 0;
+uint8_t *SoftwareSerial::_transmit_buffer = 0;
+volatile uint8_t SoftwareSerial::_transmit_buffer_tail = 0;
+volatile uint8_t SoftwareSerial::_transmit_buffer_head = 0;
+volatile uint16_t SoftwareSerial::_tx_frame = 0;
+volatile uint8_t SoftwareSerial::_tx_bits = 0;
+volatile uint8_t SoftwareSerial::_tx_level = 1;
+uint8_t SoftwareSerial::_timer2_tccr2a = 0;
+uint8_t SoftwareSerial::_timer2_tccr2b = 0;
+uint8_t SoftwareSerial::_timer2_ocr2a = 0;
 
 //
 // Debugging
@@ -162,6 +170,7 @@ inline void DebugPulse(uint8_t pin, uint8_t count)
 
 /* static */ 
 inline void SoftwareSerial::tunedDelay(uint16_t delay) { 
+#if defined(__AVR__)
   uint8_t tmp=0;
 
   asm volatile("sbiw    %0, 0x01 \n\t"
@@ -172,6 +181,10 @@ inline void SoftwareSerial::tunedDelay(uint16_t delay) {
     : "+r" (delay), "+a" (tmp)
     : "0" (delay)
     );
+#else
+  // host build (extras/test): the loop above takes 7 cycles a pass
+  hostDelayCycles(7UL * (delay + 1));
+#endif
 }
 
 // This function sets the current object as the "listening"
@@ -183,6 +196,7 @@ bool SoftwareSerial::listen()
     _buffer_overflow = false;
     uint8_t oldSREG = SREG;
     cli();
+    unlink();
     _receive_buffer_head = _receive_buffer_tail = 0;
     active_object = this;
     SREG = oldSREG;
@@ -192,6 +206,150 @@ bool SoftwareSerial::listen()
   return false;
 }
 
+// Add this object to the set of ports that receive at the same time.
+// Rather than sampling a whole byte inside the pin change interrupt
+// (which is what listen() does, and why only one port can listen),
+// the interrupt just timestamps each edge and works out which bits
+// have elapsed since the previous one.  A byte whose last bits are
+// high produces no closing edge; it is completed by the next start
+// bit or, failing that, the next time available(), read() or peek()
+// is called.  Returns false if the baud rate is too fast for this mode.
+bool SoftwareSerial::listenConcurrent()
+{
+  if (!_bit_time || _bit_time < 1000000L / _SS_MAX_CONCURRENT_BAUD)
+    return false;
+
+  if (!_concurrent)
+  {
+    uint8_t oldSREG = SREG;
+    cli();
+    if (active_object == this)
+      active_object = 0;
+    _rx_bit = _SS_RX_IDLE;
+    _rx_level = _inverse_logic ? !rx_pin_read() : rx_pin_read() != 0;
+    _next_concurrent = concurrent_list;
+    concurrent_list = this;
+    _concurrent = true;
+    SREG = oldSREG;
+  }
+
+  return true;
+}
+
+// Remove this object from the concurrent list (interrupts must be off)
+void SoftwareSerial::unlink()
+{
+  if (!_concurrent)
+    return;
+
+  for (SoftwareSerial **p = &concurrent_list; *p; p = &(*p)->_next_concurrent)
+  {
+    if (*p == this)
+    {
+      *p = _next_concurrent;
+      break;
+    }
+  }
+  _concurrent = false;
+}
+
+// Save a received byte, or note the overflow if the buffer is full
+void SoftwareSerial::store(uint8_t d)
+{
+  // if buffer full, set the overflow flag and return
+  if ((_receive_buffer_tail + 1) % _SS_MAX_RX_BUFF != _receive_buffer_head) 
+  {
+    // save new data in buffer: tail points to where byte goes
+    _receive_buffer[_receive_buffer_tail] = d; // save new byte
+    _receive_buffer_tail = (_receive_buffer_tail + 1) % _SS_MAX_RX_BUFF;
+  } 
+  else 
+  {
+#if _DEBUG // for scope: pulse pin as overflow indictator
+    DebugPulse(_DEBUG_PIN1, 1);
+#endif
+    _buffer_overflow = true;
+    ++_overflow_count;
+  }
+}
+
+//
+// Edge-timestamp decoder (concurrent receive)
+//
+
+// Assign the current line level to every bit whose center has passed
+// by 'now'.  Bit 0 is the start bit, 1-8 the data (LSB first) and 9 the
+// stop bit.  Called with interrupts disabled.
+void SoftwareSerial::rx_sample(uint16_t now)
+{
+  while (_rx_bit != _SS_RX_IDLE && (int16_t)(now - _rx_next_sample) >= 0)
+  {
+    if (_rx_bit == 0)
+    {
+      if (_rx_level) // start bit too short to be real: a glitch
+      {
+        _rx_bit = _SS_RX_IDLE;
+        return;
+      }
+    }
+    else if (_rx_bit <= 8)
+    {
+      if (_rx_level)
+        _rx_byte |= 1 << (_rx_bit - 1);
+    }
+    else
+    {
+      if (_rx_level) // valid stop bit
+        store(_rx_byte);
+      _rx_bit = _SS_RX_IDLE;
+      return;
+    }
+    ++_rx_bit;
+    _rx_next_sample += _bit_time;
+  }
+}
+
+// Pin change handler for a concurrent port
+void SoftwareSerial::rx_edge()
+{
+  uint8_t level = _inverse_logic ? !rx_pin_read() : rx_pin_read() != 0;
+  if (level == _rx_level)
+    return; // some other pin on this PCINT group changed
+
+  uint16_t now = micros();
+  rx_sample(now);
+  _rx_level = level;
+
+  if (_rx_bit == _SS_RX_IDLE && !level)
+  {
+    // Falling edge while idle: start bit
+    _rx_byte = 0;
+    _rx_bit = 0;
+    _rx_next_sample = now + (_bit_time >> 1);
+  }
+}
+
+// Deferred step: finish any byte still waiting for its trailing bits
+void SoftwareSerial::rx_poll()
+{
+  if (!_concurrent)
+    return;
+
+  uint8_t oldSREG = SREG;
+  cli();
+  rx_sample(micros());
+  SREG = oldSREG;
+}
+
+uint16_t SoftwareSerial::overflowCount()
+{
+  uint8_t oldSREG = SREG;
+  cli();
+  uint16_t count = _overflow_count;
+  SREG = oldSREG;
+  return count;
+}
+
 //
 // The receive routine called by the interrupt handler
 //
@@ -243,20 +401,7 @@ void SoftwareSerial::recv()
     if (_inverse_logic)
       d = ~d;
 
-    // if buffer full, set the overflow flag and return
-    if ((_receive_buffer_tail + 1) % _SS_MAX_RX_BUFF != _receive_buffer_head) 
-    {
-      // save new data in buffer: tail points to where byte goes
-      _receive_buffer[_receive_buffer_tail] = d; // save new byte
-      _receive_buffer_tail = (_receive_buffer_tail + 1) % _SS_MAX_RX_BUFF;
-    } 
-    else 
-    {
-#if _DEBUG // for scope: pulse pin as overflow indictator
-      DebugPulse(_DEBUG_PIN1, 1);
-#endif
-      _buffer_overflow = true;
-    }
+    store(d);
   }
 
 #if GCC_VERSION < 40302
@@ -295,12 +440,73 @@ uint8_t SoftwareSerial::rx_pin_read()
 /* static */
 inline void SoftwareSerial::handle_interrupt()
 {
+  // Concurrent ports first: they only need a timestamp, whereas the
+  // exclusive listener below holds the CPU for a whole byte.
+  for (SoftwareSerial *p = concurrent_list; p; p = p->_next_concurrent)
+    p->rx_edge();
+
   if (active_object)
   {
     active_object->recv();
   }
 }
 
+// Timer2 compare handler for background transmit: one call per bit.
+// The pin is written first, with a level worked out on the previous
+// call, so every edge sits a fixed number of cycles after the compare
+// match no matter which branch below is taken.  Edges can still be
+// late by however long another ISR (or a cli() section) holds off this
+// one, but the timer itself keeps running, so the delay never carries
+// over into the following bits.  A UART receiver samples mid-bit and
+// tolerates an edge arriving up to about a third of a bit late (35 us
+// at 9600 baud, 8 us at 38400).  The millis() ISR takes about 6 us and
+// the receive ISR of a listenConcurrent() port about 10 us, so together
+// they can hold an edge back by 13 us: fine up to 19200 baud, but at
+// 38400 an edge that coincides with both may be sampled late.  The
+// receive ISR of a port in listen() mode is far longer: it samples a whole byte with interrupts
+// off (about 1 ms at 9600 baud), so ticks are lost and the byte being
+// sent is garbled whenever such a port receives during a background
+// write.  Receive with listenConcurrent() while writing in background.
+// extras/test/txtiming.cpp runs these cases against a model of Timer2.
+void SoftwareSerial::handle_tx_interrupt()
+{
+#if defined(TIMSK2) && defined(OCIE2A)
+  SoftwareSerial *p = tx_object;
+  if (!p)
+    return;
+
+  p->tx_pin_write((_tx_level ^ p->_inverse_logic) ? HIGH : LOW);
+
+  if (_tx_bits)
+  {
+    _tx_level = _tx_frame & 1;
+    _tx_frame >>= 1;
+    --_tx_bits;
+  }
+  else if (_transmit_buffer_head != _transmit_buffer_tail)
+  {
+    // Next byte: start bit now, then 8 data bits and the stop bit.
+    // The extra 1 above the stop bit is left in _tx_frame once the
+    // stop bit is on the line (see below).
+    _tx_frame = 0x300 | _transmit_buffer[_transmit_buffer_head];
+    _transmit_buffer_head = (_transmit_buffer_head + 1) % _SS_MAX_TX_BUFF;
+    _tx_bits = 9;
+    _tx_level = 0;
+  }
+  else if (_tx_frame)
+  {
+    // Stop bit just went out and nothing is queued: keep ticking for
+    // one more bit time so isWriting() stays true until it has ended
+    _tx_frame = 0;
+  }
+  else
+  {
+    // Stop bit is complete: go idle
+    TIMSK2 &= ~_BV(OCIE2A);
+  }
+#endif
+}
+
 #if defined(PCINT0_vect)
 ISR(PCINT0_vect)
 {
@@ -338,7 +544,16 @@ SoftwareSerial::SoftwareSerial(uint8_t receivePin, uint8_t transmitPin, bool inv
   _rx_delay_stopbit(0),
   _tx_delay(0),
   _buffer_overflow(false),
-  _inverse_logic(inverse_logic)
+  _inverse_logic(inverse_logic),
+  _concurrent(false),
+  _receive_buffer_tail(0),
+  _receive_buffer_head(0),
+  _overflow_count(0),
+  _bit_time(0),
+  _rx_bit(_SS_RX_IDLE),
+  _next_concurrent(0),
+  _tx_ocr(0),
+  _tx_clock(0)
 {
   setTX(transmitPin);
   setRX(receivePin);
@@ -379,6 +594,7 @@ void SoftwareSerial::setRX(uint8_t rx)
 void SoftwareSerial::begin(long speed)
 {
   _rx_delay_centering = _rx_delay_intrabit = _rx_delay_stopbit = _tx_delay = 0;
+  _bit_time = 0;
 
   for (unsigned i=0; i<sizeof(table)/sizeof(table[0]); ++i)
   {
@@ -389,10 +605,38 @@ void SoftwareSerial::begin(long speed)
       _rx_delay_intrabit = pgm_read_word(&table[i].rx_delay_intrabit);
       _rx_delay_stopbit = pgm_read_word(&table[i].rx_delay_stopbit);
       _tx_delay = pgm_read_word(&table[i].tx_delay);
+      _bit_time = (1000000L + speed / 2) / speed;
       break;
     }
   }
 
+  // Pick the smallest Timer2 prescaler that fits one bit period in
+  // 8 bits, provided the resulting rate is within 2% of 'speed'
+  _tx_ocr = _tx_clock = 0;
+  if (_tx_delay && speed <= _SS_MAX_BACKGROUND_BAUD)
+  {
+    static const uint16_t prescalers[] = { 1, 8, 32, 64, 128, 256, 1024 };
+    for (uint8_t i=0; i<sizeof(prescalers)/sizeof(prescalers[0]); ++i)
+    {
+      unsigned long ticks = (F_CPU / prescalers[i] + speed / 2) / speed;
+      if (ticks > 256)
+        continue;
+      long error = (long)(ticks * prescalers[i] * speed) - (long)F_CPU;
+      if (labs(error) <= (long)(F_CPU / 50))
+      {
+        _tx_ocr = ticks - 1;
+        _tx_clock = i + 1;
+      }
+      break;
+    }
+  }
+  if (tx_object == this)
+  {
+    uint8_t *buffer = _transmit_buffer;
+    setBackground(0);
+    setBackground(buffer);
+  }
+
   // Set up RX interrupts, but only if we have a valid RX baud rate
   if (_rx_delay_stopbit)
   {
@@ -409,13 +653,120 @@ void SoftwareSerial::begin(long speed)
   pinMode(_DEBUG_PIN2, OUTPUT);
 #endif
 
-  listen();
+  if (_concurrent)
+  {
+    // Already receiving concurrently; just pick up the new bit time
+    uint8_t oldSREG = SREG;
+    cli();
+    unlink();
+    SREG = oldSREG;
+    if (!listenConcurrent())
+      listen();
+  }
+  else
+    listen();
 }
 
 void SoftwareSerial::end()
 {
+  setBackground(0);
+
   if (digitalPinToPCMSK(_receivePin))
     *digitalPinToPCMSK(_receivePin) &= ~_BV(digitalPinToPCMSKbit(_receivePin));
+
+  uint8_t oldSREG = SREG;
+  cli();
+  unlink();
+  if (active_object == this)
+    active_object = 0;
+  SREG = oldSREG;
+}
+
+// The TIMER2 COMPA handler in SoftwareSerial.h replaces this when the
+// sketch defines SS_TX_TIMER2.
+uint8_t *_SoftwareSerialTxBuffer() __attribute__((weak));
+uint8_t *_SoftwareSerialTxBuffer()
+{
+  return 0;
+}
+
+// Queue writes for this port in a _SS_MAX_TX_BUFF byte buffer and clock
+// them out from the Timer2 compare interrupt, so write() returns at once
+// (unless the queue is full) and interrupts stay enabled between bits.
+// Only one port can do this at a time; returns false if another port has
+// the timer, the baud rate is unsupported, the board has no Timer2 or the
+// sketch hasn't #defined SS_TX_TIMER2 to compile in the interrupt handler
+// and buffer (see SoftwareSerial.h).  writeInBackground(false) waits for
+// queued data to go out and gives Timer2 back.
+bool SoftwareSerial::writeInBackground(bool enable)
+{
+  if (!enable)
+    return setBackground(0);
+  uint8_t *buffer = _SoftwareSerialTxBuffer();
+  return buffer && setBackground(buffer);
+}
+
+// Take Timer2 for this port with 'buffer' as the queue, or with a null
+// buffer release it again.  TCCR2A, TCCR2B and OCR2A are saved when the
+// timer is taken and restored when it is released, so PWM on the Timer2
+// pins works again afterwards.
+bool SoftwareSerial::setBackground(uint8_t *buffer)
+{
+#if defined(TIMSK2) && defined(OCIE2A)
+  if (!buffer)
+  {
+    if (tx_object == this)
+    {
+      while (TIMSK2 & _BV(OCIE2A))
+        ;
+      uint8_t oldSREG = SREG;
+      cli();
+      TCCR2A = _timer2_tccr2a;
+      TCCR2B = _timer2_tccr2b;
+      OCR2A = _timer2_ocr2a;
+      tx_object = 0;
+      _transmit_buffer = 0;
+      SREG = oldSREG;
+    }
+    return true;
+  }
+
+  if (tx_object == this)
+    return true;
+  if (tx_object || !_tx_clock)
+    return false;
+
+  uint8_t oldSREG = SREG;
+  cli();
+  TIMSK2 &= ~_BV(OCIE2A);
+  _timer2_tccr2a = TCCR2A;
+  _timer2_tccr2b = TCCR2B;
+  _timer2_ocr2a = OCR2A;
+  TCCR2A = _BV(WGM21); // CTC mode, top = OCR2A
+  TCCR2B = _tx_clock;
+  OCR2A = _tx_ocr;
+  _transmit_buffer = buffer;
+  _transmit_buffer_head = _transmit_buffer_tail = 0;
+  _tx_frame = 0;
+  _tx_bits = 0;
+  _tx_level = 1;
+  tx_object = this;
+  SREG = oldSREG;
+  return true;
+#else
+  return !buffer;
+#endif
+}
+
+// True while background data is queued or still being shifted out,
+// up to the end of the last stop bit
+bool SoftwareSerial::isWriting()
+{
+#if defined(TIMSK2) && defined(OCIE2A)
+  return tx_object == this && (TIMSK2 & _BV(OCIE2A));
+#else
+  return false;
+#endif
 }
 
 
@@ -425,6 +776,8 @@ int SoftwareSerial::read()
   if (!isListening())
     return -1;
 
+  rx_poll();
+
   // Empty buffer?
   if (_receive_buffer_head == _receive_buffer_tail)
     return -1;
@@ -440,6 +793,8 @@ int SoftwareSerial::available()
   if (!isListening())
     return 0;
 
+  rx_poll();
+
   return (_receive_buffer_tail + _SS_MAX_RX_BUFF - _receive_buffer_head) % _SS_MAX_RX_BUFF;
 }
 
@@ -450,6 +805,31 @@ size_t SoftwareSerial::write(uint8_t b)
     return 0;
   }
 
+#if defined(TIMSK2) && defined(OCIE2A)
+  if (tx_object == this)
+  {
+    uint8_t next = (_transmit_buffer_tail + 1) % _SS_MAX_TX_BUFF;
+    while (next == _transmit_buffer_head)
+      ; // queue full: wait for the interrupt to make room
+    _transmit_buffer[_transmit_buffer_tail] = b;
+
+    uint8_t oldSREG = SREG;
+    cli();
+    _transmit_buffer_tail = next;
+    if (!(TIMSK2 & _BV(OCIE2A)))
+    {
+      // Idle: restart the bit clock.  The first tick re-asserts the
+      // idle level and loads this byte, so the previous stop bit is
+      // always at least one full bit long.
+      TCNT2 = 0;
+      TIFR2 = _BV(OCF2A);
+      TIMSK2 |= _BV(OCIE2A);
+    }
+    SREG = oldSREG;
+    return 1;
+  }
+#endif
+
   uint8_t oldSREG = SREG;
   cli();  // turn off interrupts for a clean txmit
 
@@ -509,6 +889,8 @@ int SoftwareSerial::peek()
   if (!isListening())
     return -1;
 
+  rx_poll();
+
   // Empty buffer?
   if (_receive_buffer_head == _receive_buffer_tail)
     return -1;
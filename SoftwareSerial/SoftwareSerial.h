@@ -39,7 +39,11 @@ http://arduiniana.org.
 * Definitions
 ******************************************************************************/
 
-#define _SS_MAX_RX_BUFF 64 // RX buffer size
+#define _SS_MAX_RX_BUFF 64 // RX buffer size (per instance)
+#define _SS_MAX_CONCURRENT_BAUD 19200 // fastest rate for listenConcurrent()
+#define _SS_RX_IDLE 0xFF // decoder state: waiting for a start bit
+#define _SS_MAX_TX_BUFF 32 // background TX buffer size (SS_TX_TIMER2 only)
+#define _SS_MAX_BACKGROUND_BAUD 38400 // fastest rate for writeInBackground()
 #ifndef GCC_VERSION
 #define GCC_VERSION (__GNUC__ * 10000 + __GNUC_MINOR__ * 100 + __GNUC_PATCHLEVEL__)
 #endif
@@ -61,19 +65,52 @@ private:
 
   uint16_t _buffer_overflow:1;
   uint16_t _inverse_logic:1;
+  uint16_t _concurrent:1;
+
+  char _receive_buffer[_SS_MAX_RX_BUFF]; 
+  volatile uint8_t _receive_buffer_tail;
+  volatile uint8_t _receive_buffer_head;
+  volatile uint16_t _overflow_count;
+
+  // edge-timestamp decoder state (concurrent receive)
+  uint16_t _bit_time;               // bit width in microseconds
+  volatile uint16_t _rx_next_sample; // micros() of next bit center
+  volatile uint8_t _rx_bit;         // next bit to sample, or _SS_RX_IDLE
+  volatile uint8_t _rx_byte;
+  volatile uint8_t _rx_level;       // logical line level since last edge
+  SoftwareSerial *_next_concurrent;
+
+  // Timer2 settings for this baud rate (background transmit)
+  uint8_t _tx_ocr;
+  uint8_t _tx_clock;                // clock select bits, 0 if unsupported
 
   // static data
-  static char _receive_buffer[_SS_MAX_RX_BUFF]; 
-  static volatile uint8_t _receive_buffer_tail;
-  static volatile uint8_t _receive_buffer_head;
   static SoftwareSerial *active_object;
+  static SoftwareSerial *concurrent_list;
+  static SoftwareSerial *tx_object;
+  static uint8_t *_transmit_buffer; // set while writing in background
+  static volatile uint8_t _transmit_buffer_tail;
+  static volatile uint8_t _transmit_buffer_head;
+  static volatile uint16_t _tx_frame; // bits still to send, LSB next,
+                                      // then a 1 until the stop bit ends
+  static volatile uint8_t _tx_bits;
+  static volatile uint8_t _tx_level;  // logical level for the next tick
+  static uint8_t _timer2_tccr2a;      // Timer2 settings from before
+  static uint8_t _timer2_tccr2b;      // background transmit took the
+  static uint8_t _timer2_ocr2a;       // timer, put back when it's done
 
   // private methods
   void recv();
+  void store(uint8_t d);
+  void rx_edge();
+  void rx_sample(uint16_t now);
+  void rx_poll();
+  void unlink();
   uint8_t rx_pin_read();
   void tx_pin_write(uint8_t pin_state);
   void setTX(uint8_t transmitPin);
   void setRX(uint8_t receivePin);
+  bool setBackground(uint8_t *buffer);
 
   // private static method for timing
   static inline void tunedDelay(uint16_t delay);
@@ -84,9 +121,13 @@ public:
   ~SoftwareSerial();
   void begin(long speed);
   bool listen();
+  bool listenConcurrent();
   void end();
-  bool isListening() { return this == active_object; }
+  bool isListening() { return this == active_object || _concurrent; }
   bool overflow() { bool ret = _buffer_overflow; _buffer_overflow = false; return ret; }
+  uint16_t overflowCount();
+  bool writeInBackground(bool enable = true);
+  bool isWriting();
   int peek();
 
   virtual size_t write(uint8_t byte);
@@ -98,8 +139,35 @@ public:
 
   // public only for easy access by interrupt handlers
   static inline void handle_interrupt();
+  static void handle_tx_interrupt();
 };
 
+// Background transmit runs off the Timer2 compare A interrupt, which
+// IRremote, NewPing and tone() also use.  So that the library doesn't
+// claim the vector (or the transmit buffer) for every sketch, the
+// handler is only compiled in when the sketch asks for it, and
+// writeInBackground() returns false without it:
+//   #define SS_TX_TIMER2
+//   #include <SoftwareSerial.h>
+// Define it in one source file only (normally the .ino).
+// While a port writes in background, Timer2 runs in CTC mode as its bit
+// clock, so analogWrite() on the Timer2 pins (3 and 11, 9 and 10 on the
+// Mega) doesn't work.  writeInBackground(false) and end() put back the
+// Timer2 settings from before.
+#if defined(SS_TX_TIMER2) && defined(TIMER2_COMPA_vect)
+#include <avr/interrupt.h>
+ISR(TIMER2_COMPA_vect)
+{
+  SoftwareSerial::handle_tx_interrupt();
+}
+// gives writeInBackground() its transmit buffer
+uint8_t *_SoftwareSerialTxBuffer()
+{
+  static uint8_t buffer[_SS_MAX_TX_BUFF];
+  return buffer;
+}
+#endif
+
 // Arduino 0012 workaround
 #undef int
 #undef char
@@ -0,0 +1,51 @@
+/*
+  Software serial background write
+ 
+ Sends a status line once a second without stalling the sketch.
+ 
+ Normally write() holds interrupts off for the whole of each byte
+ (about 1 ms at 9600 baud). With writeInBackground(), bytes are
+ queued and a Timer2 interrupt clocks each bit out, so write()
+ returns at once and other interrupts run between bits.
+ 
+ Timer2 is also used by tone(), IRremote and NewPing, and by PWM on
+ pins 3 and 11 (9 and 10 on the Mega), so those can't be used at
+ the same time. Boards without Timer2 (e.g. Leonardo) fall back to
+ the normal blocking write().
+ 
+ The circuit: 
+ * RX is digital pin 10 (connect to TX of other device)
+ * TX is digital pin 11 (connect to RX of other device)
+ 
+ This example code is in the public domain.
+ 
+ */
+
+// Must come before the #include so the Timer2 handler gets built
+#define SS_TX_TIMER2
+#include <SoftwareSerial.h>
+
+SoftwareSerial mySerial(10, 11); // RX, TX
+
+unsigned long lastReport;
+unsigned long loops;
+
+void setup()
+{
+  mySerial.begin(9600);
+  if (!mySerial.writeInBackground())
+    mySerial.println("background write not available");
+}
+
+void loop()
+{
+  ++loops;
+
+  if (millis() - lastReport >= 1000) {
+    lastReport = millis();
+    // Returns after queueing; the sketch keeps counting meanwhile
+    mySerial.print("loops/s: ");
+    mySerial.println(loops);
+    loops = 0;
+  }
+}
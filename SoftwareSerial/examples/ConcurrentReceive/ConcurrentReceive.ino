@@ -0,0 +1,66 @@
+/*
+  Software serial concurrent receive
+ 
+ Receives from three software serial ports at the same time
+ and sends everything to the hardware serial port.
+ 
+ Unlike listen(), which lets only one port receive at a time,
+ listenConcurrent() keeps all of the ports receiving into their
+ own buffers. This works at up to 19200 baud. Don't mix the two:
+ a port in the old listen() mode blocks interrupts for a whole
+ byte, which upsets the timing of the concurrent ports.
+ 
+ The circuit: 
+ * GPS TX attached to digital pin 10
+ * RS-485 transceiver RO attached to digital pin 11
+ * Modem TX attached to digital pin 12
+ 
+ This example code is in the public domain.
+ 
+ */
+
+#include <SoftwareSerial.h>
+
+SoftwareSerial gps(10, 7);
+SoftwareSerial bus(11, 8);
+SoftwareSerial modem(12, 9);
+
+void setup()
+{
+  Serial.begin(115200);
+
+  gps.begin(9600);
+  bus.begin(19200);
+  modem.begin(9600);
+
+  gps.listenConcurrent();
+  bus.listenConcurrent();
+  modem.listenConcurrent();
+}
+
+void relay(SoftwareSerial &port, char tag)
+{
+  if (port.available() > 0) {
+    Serial.write(tag);
+    Serial.write(':');
+    while (port.available() > 0)
+      Serial.write(port.read());
+    Serial.println();
+  }
+}
+
+void loop()
+{
+  relay(gps, 'G');
+  relay(bus, 'B');
+  relay(modem, 'M');
+
+  if (gps.overflow() || bus.overflow() || modem.overflow()) {
+    Serial.print("overflows G/B/M: ");
+    Serial.print(gps.overflowCount());
+    Serial.print('/');
+    Serial.print(bus.overflowCount());
+    Serial.print('/');
+    Serial.println(modem.overflowCount());
+  }
+}
@@ -0,0 +1,54 @@
+// Host build shim for the SoftwareSerial timing model (see txtiming.cpp).
+// Only what SoftwareSerial.cpp uses is declared here, with the pin map
+// of the ATmega328P.
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+
+#ifndef F_CPU
+#define F_CPU 16000000L
+#endif
+
+#define LOW    0
+#define HIGH   1
+#define INPUT  0
+#define OUTPUT 1
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+// pins 0-7 are port D, 8-13 port B, 14-19 port C
+#define PB 2
+#define PC 3
+#define PD 4
+#define digitalPinToPort(p) ((p) <= 7 ? PD : (p) <= 13 ? PB : PC)
+#define digitalPinToBitMask(p) \
+  _BV((p) <= 7 ? (p) : (p) <= 13 ? (p) - 8 : (p) - 14)
+#define portOutputRegister(port) \
+  ((port) == PD ? &PORTD : (port) == PB ? &PORTB : &PORTC)
+#define portInputRegister(port) \
+  ((port) == PD ? &PIND : (port) == PB ? &PINB : &PINC)
+#define digitalPinToPCICR(p) ((p) <= 21 ? (&PCICR) : 0)
+#define digitalPinToPCICRbit(p) ((p) <= 7 ? 2 : (p) <= 13 ? 0 : 1)
+#define digitalPinToPCMSK(p) \
+  ((p) <= 7 ? (&PCMSK2) : (p) <= 13 ? (&PCMSK0) : (&PCMSK1))
+#define digitalPinToPCMSKbit(p) \
+  ((p) <= 7 ? (p) : (p) <= 13 ? (p) - 8 : (p) - 14)
+
+// provided by the model
+unsigned long micros(void);
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+void hostDelayCycles(unsigned long cycles);
+
+#include "Stream.h"
+
+#endif
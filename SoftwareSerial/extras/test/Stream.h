@@ -0,0 +1,36 @@
+// Host build shim for the SoftwareSerial timing model (see txtiming.cpp).
+
+#ifndef Stream_h
+#define Stream_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+class Print {
+ private:
+  int write_error;
+ protected:
+  void setWriteError(int err = 1) { write_error = err; }
+ public:
+  Print() : write_error(0) {}
+  virtual ~Print() {}
+  int getWriteError() { return write_error; }
+  virtual size_t write(uint8_t) = 0;
+  size_t write(const char* str) { return write((const uint8_t*) str, strlen(str)); }
+  virtual size_t write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while (size--) n += write(*buffer++);
+    return n;
+  }
+};
+
+class Stream : public Print {
+ public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  virtual void flush() = 0;
+};
+
+#endif
@@ -0,0 +1,13 @@
+// Host build shim for the SoftwareSerial timing model (see txtiming.cpp).
+// The model calls the interrupt routines itself when SREG allows it.
+
+#ifndef _AVR_INTERRUPT_H_
+#define _AVR_INTERRUPT_H_
+
+#include <avr/io.h>
+
+#define ISR(vector) extern "C" void vector(void)
+#define cli() (SREG &= ~0x80)
+#define sei() (SREG |= 0x80)
+
+#endif
@@ -0,0 +1,43 @@
+// Host build shim for the SoftwareSerial timing model (see txtiming.cpp).
+// The ATmega328P registers used by SoftwareSerial, read and written by the
+// model of Timer2 and the pins.
+
+#ifndef _AVR_IO_H_
+#define _AVR_IO_H_
+
+#include <stdint.h>
+
+#define _BV(bit) (1 << (bit))
+
+extern volatile uint8_t SREG;
+extern volatile uint8_t PORTB, PINB, DDRB, PORTC, PINC, DDRC, PORTD, PIND, DDRD;
+extern volatile uint8_t PCICR, PCMSK0, PCMSK1, PCMSK2;
+extern volatile uint8_t TCCR2A, TCCR2B, OCR2A, TCNT2, TIFR2;
+
+// Reading TIMSK2 from the sketch lets a few cycles pass in the model, so
+// the loops that wait for the interrupt to switch itself off end.
+void hostRegisterPoll();
+struct SimTIMSK2 {
+  uint8_t value;
+  operator uint8_t() { hostRegisterPoll(); return value; }
+  SimTIMSK2& operator=(uint8_t v) { value = v; return *this; }
+  SimTIMSK2& operator&=(uint8_t v) { value &= v; return *this; }
+  SimTIMSK2& operator|=(uint8_t v) { value |= v; return *this; }
+};
+// a macro, as SoftwareSerial.cpp checks for it with defined()
+extern SimTIMSK2 sim_TIMSK2;
+#define TIMSK2 sim_TIMSK2
+
+// TCCR2A, TCCR2B
+#define WGM21  1
+#define WGM22  3
+// TIMSK2, TIFR2
+#define OCIE2A 1
+#define OCF2A  1
+
+#define PCINT0_vect       sim_PCINT0_vect
+#define PCINT1_vect       sim_PCINT1_vect
+#define PCINT2_vect       sim_PCINT2_vect
+#define TIMER2_COMPA_vect sim_TIMER2_COMPA_vect
+
+#endif
@@ -0,0 +1,21 @@
+// Host build shim for the SoftwareSerial timing model (see txtiming.cpp).
+
+#ifndef _AVR_PGMSPACE_H_
+#define _AVR_PGMSPACE_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+#define pgm_read_word(addr) pgm_read_bytes_<uint16_t>(addr)
+#define pgm_read_dword(addr) pgm_read_bytes_<uint32_t>(addr)
+
+// low bytes of the field, like the AVR (and the host) is little endian
+template <class T> static inline T pgm_read_bytes_(const void *addr)
+{
+  T v;
+  memcpy(&v, addr, sizeof v);
+  return v;
+}
+
+#endif
@@ -0,0 +1,505 @@
+/*
+ * SoftwareSerial - host-side timing model of background transmit.
+ *
+ * Builds SoftwareSerial.cpp for the host against a cycle-counted model of a
+ * 16 MHz ATmega328P (avr/io.h in this directory):
+ * - Timer2 in CTC mode sets its compare flag every (OCR2A + 1) * prescaler
+ *   cycles; a flag that is still pending when the next match comes is a lost
+ *   tick, as on the chip
+ * - pin change interrupts follow the RX lines, which carry random bytes
+ * - the interrupt routines of the library run when SREG allows it, in vector
+ *   order, each for an estimated number of cycles (the *_CYCLES defines);
+ *   the exclusive receive routine runs for as long as its tunedDelay() calls
+ * - the millis() interrupt, every 1024 us
+ * The TX pin is decoded by a UART receiver that samples in the middle of each
+ * bit.  For each case it prints the bytes garbled, the ticks lost and how
+ * late the latest edge was against the compare match, in us and as a share of
+ * a bit.  It checks that background writes arrive intact alone and, up to
+ * 19200 baud, next to millis() and a listenConcurrent() port (38400 is only
+ * reported), that the concurrent port still receives, that they are garbled
+ * next to a receiving listen() port (see handle_tx_interrupt()), and that
+ * the Timer2 registers are put back afterwards.  The exit status is nonzero if any
+ * check fails.
+ *
+ * Build and run from this directory:
+ *   g++ -O2 -Wall -I. -I../.. -o txtiming txtiming.cpp ../../SoftwareSerial.cpp && ./txtiming
+ * add -DNO_SS_TX_TIMER2 to check that writeInBackground() returns false
+ * without the Timer2 handler.
+ */
+
+#ifndef NO_SS_TX_TIMER2
+#define SS_TX_TIMER2
+#endif
+#include "Arduino.h"
+#include "SoftwareSerial.h"
+
+#include <stdio.h>
+#include <vector>
+
+extern "C" void sim_PCINT0_vect(void);
+extern "C" void sim_PCINT1_vect(void);
+extern "C" void sim_PCINT2_vect(void);
+#ifdef SS_TX_TIMER2
+extern "C" void sim_TIMER2_COMPA_vect(void);
+#endif
+
+// ----- simulated ATmega328P -----
+
+volatile uint8_t SREG;
+volatile uint8_t PORTB, PINB, DDRB, PORTC, PINC, DDRC, PORTD, PIND, DDRD;
+volatile uint8_t PCICR, PCMSK0, PCMSK1, PCMSK2;
+volatile uint8_t TCCR2A, TCCR2B, OCR2A, TCNT2, TIFR2;
+SimTIMSK2 sim_TIMSK2;
+
+typedef unsigned long long cycles_t;
+static const cycles_t NEVER = ~0ULL;
+
+// estimated cycles of the interrupt routines, counted by hand, not measured
+#define ISR_RESPONSE       7   // finish instruction, push PC, jump
+#define TX_PIN_CYCLES      30  // TIMER2 COMPA prologue up to the pin write
+#define TX_ISR_CYCLES      90  // the whole TIMER2 COMPA routine
+#define MILLIS_ISR_CYCLES  90  // TIMER0 OVF (millis)
+#define PCINT_ISR_CYCLES   60  // PCINT routine without the ports
+#define RX_EDGE_CYCLES     150 // rx_edge() of a concurrent port, with micros()
+
+static cycles_t now;
+static bool inIsr;
+
+// Timer2: the counter held t2BaseCount at t2Base
+static cycles_t t2Base;
+static uint8_t t2BaseCount;
+static bool t2Pending;
+static cycles_t t2MatchAt;
+static long t2Lost;
+
+// TIMER0 OVF for millis()
+static bool millisOn;
+static cycles_t t0Next;
+static bool t0Pending;
+
+static uint8_t pcPending;       // PCIF bits
+static int concurrentPorts;     // ports on the concurrent list
+
+struct Edge {
+  cycles_t at;
+  uint8_t level;
+};
+
+// an RX line driven by the model
+struct Line {
+  uint8_t pin;
+  std::vector<Edge> edges;
+  size_t next;
+  std::vector<uint8_t> bytes;
+};
+
+static std::vector<Line> lines;
+
+// the TX pin watched by the decoder
+static uint8_t txPin;
+static std::vector<Edge> txEdges;
+static cycles_t txLateMax;
+
+static volatile uint8_t *pinPort(uint8_t pin) { return portInputRegister(digitalPinToPort(pin)); }
+
+unsigned long micros(void) { return now / (F_CPU / 1000000L); }
+void pinMode(uint8_t pin, uint8_t mode) {}
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+  volatile uint8_t *port = portOutputRegister(digitalPinToPort(pin));
+  if (val) *port |= digitalPinToBitMask(pin);
+  else *port &= ~digitalPinToBitMask(pin);
+}
+
+static uint8_t txLevel()
+{
+  return (*portOutputRegister(digitalPinToPort(txPin)) & digitalPinToBitMask(txPin)) != 0;
+}
+
+static unsigned t2Prescaler()
+{
+  static const unsigned prescalers[8] = { 0, 1, 8, 32, 64, 128, 256, 1024 };
+  return prescalers[TCCR2B & 7];
+}
+
+static bool t2Ctc() { return (TCCR2A & 3) == _BV(WGM21) && !(TCCR2B & _BV(WGM22)); }
+
+// the counter now
+static uint8_t t2Count()
+{
+  unsigned p = t2Prescaler();
+  if (!p || !t2Ctc()) return t2BaseCount;
+  return (t2BaseCount + (now - t2Base) / p) % (OCR2A + 1);
+}
+
+// first compare match after 'after'; only CTC mode is modelled
+static cycles_t t2NextMatch(cycles_t after)
+{
+  unsigned p = t2Prescaler();
+  if (!p || !t2Ctc() || t2BaseCount > OCR2A) return NEVER;
+  cycles_t period = (cycles_t) (OCR2A + 1) * p;
+  cycles_t first = t2Base + (cycles_t) (OCR2A - t2BaseCount) * p;
+  if (first > after) return first;
+  return first + ((after - first) / period + 1) * period;
+}
+
+// set PCIF of the pin's group if its pin change interrupt is on
+static void pinChange(uint8_t pin)
+{
+  uint8_t group = digitalPinToPCICRbit(pin);
+  if ((PCICR & _BV(group)) && (*digitalPinToPCMSK(pin) & _BV(digitalPinToPCMSKbit(pin))))
+    pcPending |= _BV(group);
+}
+
+// move time on to the next event, but not past 'limit'
+static void step(cycles_t limit)
+{
+  cycles_t at = limit;
+  cycles_t match = t2NextMatch(now);
+  if (match < at) at = match;
+  if (millisOn && t0Next < at) at = t0Next;
+  for (size_t i = 0; i < lines.size(); i++)
+    if (lines[i].next < lines[i].edges.size() && lines[i].edges[lines[i].next].at < at)
+      at = lines[i].edges[lines[i].next].at;
+  if (at <= now) at = now + 1;
+
+  now = at;
+  if (match == at)
+  {
+    if (t2Pending && (TIMSK2.value & _BV(OCIE2A))) t2Lost++;
+    t2Pending = true;
+    t2MatchAt = at;
+  }
+  if (millisOn && t0Next == at)
+  {
+    t0Pending = true;
+    t0Next += 1024 * (F_CPU / 1000000L);
+  }
+  for (size_t i = 0; i < lines.size(); i++)
+  {
+    Line &l = lines[i];
+    while (l.next < l.edges.size() && l.edges[l.next].at == at)
+    {
+      volatile uint8_t *pin = pinPort(l.pin);
+      if (l.edges[l.next].level) *pin |= digitalPinToBitMask(l.pin);
+      else *pin &= ~digitalPinToBitMask(l.pin);
+      pinChange(l.pin);
+      l.next++;
+    }
+  }
+}
+
+static void advance(cycles_t to)
+{
+  while (now < to)
+    step(to);
+}
+
+void hostDelayCycles(unsigned long cycles) { advance(now + cycles); }
+
+static bool interruptPending()
+{
+  return pcPending || (t2Pending && (TIMSK2.value & _BV(OCIE2A))) || t0Pending;
+}
+
+// run the first pending interrupt routine in vector order
+static void dispatch()
+{
+  inIsr = true;
+  SREG &= ~0x80;
+  if (pcPending)
+  {
+    uint8_t group = pcPending & _BV(0) ? 0 : pcPending & _BV(1) ? 1 : 2;
+    pcPending &= ~_BV(group);
+    advance(now + ISR_RESPONSE + PCINT_ISR_CYCLES + concurrentPorts * RX_EDGE_CYCLES);
+    if (group == 0) sim_PCINT0_vect();
+    else if (group == 1) sim_PCINT1_vect();
+    else sim_PCINT2_vect();
+  }
+  else if (t2Pending && (TIMSK2.value & _BV(OCIE2A)))
+  {
+    t2Pending = false;
+    cycles_t match = t2MatchAt;
+    cycles_t entry = now;
+    advance(now + ISR_RESPONSE + TX_PIN_CYCLES);
+    uint8_t level = txLevel();
+#ifdef SS_TX_TIMER2
+    sim_TIMER2_COMPA_vect();
+#endif
+    if (txLevel() != level)
+    {
+      Edge e = { now, txLevel() };
+      txEdges.push_back(e);
+      if (entry - match > txLateMax) txLateMax = entry - match;
+    }
+    advance(now + TX_ISR_CYCLES - TX_PIN_CYCLES);
+  }
+  else
+  {
+    t0Pending = false;
+    advance(now + ISR_RESPONSE + MILLIS_ISR_CYCLES);
+  }
+  SREG |= 0x80;
+  inIsr = false;
+}
+
+// let time pass up to 'until', running interrupts as they come
+static void run(cycles_t until)
+{
+  while (now < until)
+  {
+    if ((SREG & 0x80) && interruptPending())
+      dispatch();
+    else
+      step(until);
+  }
+}
+
+// a polling loop in the sketch: one pass is about 4 cycles
+void hostRegisterPoll()
+{
+  if (!inIsr)
+    run(now + 4);
+}
+
+// Call into the library from the sketch.  The model keeps TCNT2 and TIFR2
+// itself, so writes to them are picked up here.
+template <class F> static void sketch(F f)
+{
+  uint8_t count = t2Count(), a = TCCR2A, b = TCCR2B, ocr = OCR2A;
+  TCNT2 = count;
+  TIFR2 = 0;
+  f();
+  if (TCNT2 != count || TCCR2A != a || TCCR2B != b || OCR2A != ocr)
+  {
+    t2Base = now;
+    t2BaseCount = TCNT2;
+  }
+  if (TIFR2 & _BV(OCF2A))
+    t2Pending = false;
+}
+
+static void reset()
+{
+  now = 0;
+  SREG = 0x80;
+  PORTB = PINB = DDRB = PORTC = PINC = DDRC = PORTD = PIND = DDRD = 0xFF;
+  PCICR = PCMSK0 = PCMSK1 = PCMSK2 = 0;
+  TCCR2A = TCCR2B = OCR2A = TCNT2 = TIFR2 = 0;
+  TIMSK2 = 0;
+  t2Base = 0;
+  t2BaseCount = 0;
+  t2Pending = t0Pending = false;
+  t2Lost = 0;
+  millisOn = false;
+  t0Next = 1024 * (F_CPU / 1000000L);
+  pcPending = 0;
+  concurrentPorts = 0;
+  lines.clear();
+  txEdges.clear();
+  txLateMax = 0;
+}
+
+// ----- checks -----
+
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+  if (!ok)
+  {
+    printf("FAIL: %s\n", what);
+    failures++;
+  }
+}
+
+#ifdef SS_TX_TIMER2
+// random bytes on a line from 'start' for 'duration', one stop bit apart
+static void addTraffic(uint8_t pin, long baud, cycles_t start, cycles_t duration)
+{
+  Line l;
+  l.pin = pin;
+  l.next = 0;
+  double bit = (double) F_CPU / baud;
+  double t = start;
+  uint8_t level = 1;
+  while (t + 10 * bit < start + duration)
+  {
+    uint8_t b = rand();
+    l.bytes.push_back(b);
+    uint16_t frame = (0x200 | b << 1);  // start bit, data, stop bit
+    for (int i = 0; i < 10; i++, frame >>= 1)
+    {
+      if ((frame & 1) != level)
+      {
+        level = frame & 1;
+        Edge e = { (cycles_t) (t + i * bit), level };
+        l.edges.push_back(e);
+      }
+    }
+    t += 11 * bit;
+  }
+  lines.push_back(l);
+}
+
+// UART receiver: sample each bit in its middle after the start edge
+static std::vector<int> decode(const std::vector<Edge> &edges, long baud)
+{
+  std::vector<int> bytes;
+  double bit = (double) F_CPU / baud;
+  size_t i = 0;
+  uint8_t level = 1;
+  cycles_t idleFrom = 0;
+  while (i < edges.size())
+  {
+    if (edges[i].level || edges[i].at < idleFrom)
+    {
+      level = edges[i++].level;
+      continue;
+    }
+    cycles_t start = edges[i].at;
+    int b = 0;
+    size_t j = i;
+    for (int k = 1; k <= 9; k++)
+    {
+      cycles_t at = start + (cycles_t) ((k + 0.5) * bit);
+      while (j < edges.size() && edges[j].at <= at)
+        level = edges[j++].level;
+      if (k <= 8 && level)
+        b |= 1 << (k - 1);
+      if (k == 9 && !level)
+        b = -1;  // framing error
+    }
+    bytes.push_back(b);
+    idleFrom = start + (cycles_t) (9.5 * bit);
+    i++;
+  }
+  return bytes;
+}
+
+enum Load { QUIET, CONCURRENT, EXCLUSIVE };
+
+// Send 'count' random bytes in background at 'baud' while port 2 receives
+// 9600 baud traffic as set by 'load'; returns the bytes garbled.
+static long backgroundWrite(long baud, Load load, int count)
+{
+  static const char *names[] = { "alone", "millis + listenConcurrent()", "millis + listen()" };
+  reset();
+  SoftwareSerial tx(4, 5), rx(8, 9);
+  txPin = 5;
+  double bit = (double) F_CPU / baud;
+  cycles_t duration = (cycles_t) ((count + 20) * 10 * bit);
+  sketch([&] { tx.begin(baud); });
+  if (load != QUIET)
+  {
+    millisOn = true;
+    sketch([&] { rx.begin(9600); });
+    if (load == CONCURRENT)
+    {
+      sketch([&] { rx.listenConcurrent(); });
+      concurrentPorts = 1;
+    }
+    addTraffic(8, 9600, now + 1000, duration);
+  }
+  bool on = false;
+  sketch([&] { on = tx.writeInBackground(); });
+  check(on, "writeInBackground() takes Timer2");
+  if (!on)
+    return count;
+
+  std::vector<uint8_t> sent, received;
+  bool writing;
+  while ((int) sent.size() < count)
+  {
+    // 16 bytes at a time, so write() never waits for room in the queue
+    for (int i = 0; i < 16 && (int) sent.size() < count; i++)
+    {
+      uint8_t b = rand();
+      sent.push_back(b);
+      sketch([&] { tx.write(b); });
+    }
+    writing = true;
+    for (int i = 0; writing && i < 1000; i++)
+    {
+      run(now + (cycles_t) bit);
+      sketch([&] { writing = tx.isWriting(); });
+    }
+    check(!writing, "isWriting() ends");
+    sketch([&] { int c; while ((c = rx.read()) >= 0) received.push_back(c); });
+  }
+  sketch([&] { tx.writeInBackground(false); });
+
+  std::vector<int> got = decode(txEdges, baud);
+  long bad = 0;
+  for (int i = 0; i < count; i++)
+    if (i >= (int) got.size() || got[i] != sent[i])
+      bad++;
+  double lateUs = (double) txLateMax / (F_CPU / 1000000L);
+  printf("%5ld baud, %-28s %3ld of %d bytes garbled, %4ld ticks lost, latest edge %5.1f us (%2.0f%% of a bit)\n",
+         baud, names[load], bad, count, t2Lost, lateUs, 100 * txLateMax / bit);
+
+  if (load == CONCURRENT)
+  {
+    // the receiving port must keep working too
+    run(lines[0].edges.back().at + 20 * F_CPU / 9600);
+    sketch([&] { int c; while ((c = rx.read()) >= 0) received.push_back(c); });
+    check(received == lines[0].bytes, "listenConcurrent() port receives while writing in background");
+  }
+  return bad;
+}
+
+// PWM settings of Timer2 come back after background writes
+static void timer2Restore()
+{
+  reset();
+  TCCR2A = 0xA3; // fast PWM on OC2A and OC2B, as analogWrite() leaves it
+  TCCR2B = 0x04;
+  OCR2A = 0x40;
+  SoftwareSerial tx(4, 5);
+  txPin = 5;
+  sketch([&] { tx.begin(9600); });
+  sketch([&] { check(tx.writeInBackground(), "writeInBackground() at 9600"); });
+  check(TCCR2A == _BV(WGM21), "Timer2 in CTC mode while writing in background");
+  sketch([&] { tx.write('x'); });
+  sketch([&] { tx.begin(19200); }); // new baud rate, keeps the saved settings
+  run(now + 20 * 16 * 1000);
+  sketch([&] { tx.writeInBackground(false); });
+  check(TCCR2A == 0xA3 && TCCR2B == 0x04 && OCR2A == 0x40, "Timer2 settings restored by writeInBackground(false)");
+
+  sketch([&] { tx.writeInBackground(); });
+  sketch([&] { tx.end(); });
+  check(TCCR2A == 0xA3 && TCCR2B == 0x04 && OCR2A == 0x40, "Timer2 settings restored by end()");
+}
+#endif
+
+int main()
+{
+#ifdef SS_TX_TIMER2
+  srand(1);
+  static const long bauds[] = { 9600, 19200, 38400 };
+  for (int i = 0; i < 3; i++)
+  {
+    long baud = bauds[i];
+    check(backgroundWrite(baud, QUIET, 300) == 0, "background write alone");
+    // above _SS_MAX_CONCURRENT_BAUD only reported, see handle_tx_interrupt()
+    long bad = backgroundWrite(baud, CONCURRENT, 300);
+    check(bad == 0 || baud > _SS_MAX_CONCURRENT_BAUD, "background write next to millis() and listenConcurrent()");
+    check(backgroundWrite(baud, EXCLUSIVE, 300) > 0, "model: a receiving listen() port garbles background writes");
+  }
+  timer2Restore();
+#else
+  reset();
+  SoftwareSerial tx(4, 5);
+  sketch([&] { tx.begin(9600); });
+  bool on = true;
+  sketch([&] { on = tx.writeInBackground(); });
+  check(!on && !(TIMSK2.value & _BV(OCIE2A)), "writeInBackground() is false without SS_TX_TIMER2");
+  printf("without SS_TX_TIMER2: writeInBackground() returns %s\n", on ? "true" : "false");
+#endif
+
+  if (failures)
+    printf("%d check(s) failed\n", failures);
+  else
+    printf("all checks passed\n");
+  return failures ? 1 : 0;
+}